@@ -0,0 +1,1447 @@
+#include "murmur_hash.h"
+#include "fast_hash.h"
+#include "tree_hash.h"
+#include "hash.h"
+#include "flat_hash.h"
+#include "split_hash.h"
+#include "concurrent_hash.h"
+#include "frozen_hash.h"
+#include "grouped_hash.h"
+#include "lru_cache.h"
+#include "clock_cache.h"
+#include "priority_queue.h"
+#include "timer_wheel.h"
+#include "string_stream.h"
+#include "rope_buffer.h"
+#include "log_sink.h"
+#include "string_reader.h"
+#include "sjson.h"
+#include "vector_math.h"
+#include "soa_array.h"
+#include "array.h"
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+/// Micro benchmarks for the foundation collections. Run all benchmarks with
+/// `rake bench` or pass the names of the benchmarks to run on the command line.
+/// Pass `-n <count>` to change the problem size (for example `-n 100000000`
+/// to run the hash benchmarks up to 100M entries).
+
+namespace {
+	using namespace foundation;
+
+	double seconds()
+	{
+		using namespace std::chrono;
+		return duration_cast<duration<double> >(steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Small and fast xorshift generator, so the benchmarks are reproducible.
+	struct Random {
+		uint64_t state;
+		Random(uint64_t seed = 0x9e3779b97f4a7c15ull) : state(seed) {}
+		uint64_t next() {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return state;
+		}
+	};
+
+	void report(const char *name, uint32_t n, double t)
+	{
+		printf("  %-40s %10.2f ms %10.2f ns/op\n", name, t * 1e3, t * 1e9 / n);
+	}
+
+	// Prevents the optimizer from removing computations whose results are unused.
+	volatile uint64_t sink;
+
+	struct Timeout {
+		uint64_t expires;
+		uint64_t id;
+		bool operator<(const Timeout &o) const {return expires < o.expires;}
+	};
+
+	// Schedules n timeouts, cancels every tenth one and then expires all of
+	// them in order, using a sorted Array, a PriorityQueue and a TimerWheel.
+	void bench_timers(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("timers (n = %u)\n", n);
+
+		Array<Timeout> timeouts(a);
+		array::resize(timeouts, n);
+		Random r;
+		for (uint32_t i=0; i<n; ++i) {
+			timeouts[i].expires = 1 + r.next() % (n * 4ull);
+			timeouts[i].id = i;
+		}
+
+		// The sorted array keeps the earliest timeout last so it can be
+		// expired with pop_back().
+		if (n <= 200000) {
+			double t0 = seconds();
+			Array<Timeout> sorted(a);
+			for (uint32_t i=0; i<n; ++i) {
+				uint32_t lo = 0, hi = array::size(sorted);
+				while (lo < hi) {
+					const uint32_t mid = (lo + hi) / 2;
+					if (timeouts[i].expires < sorted[mid].expires)
+						lo = mid + 1;
+					else
+						hi = mid;
+				}
+				array::push_back(sorted, timeouts[i]);
+				memmove(&sorted[lo + 1], &sorted[lo], (array::size(sorted) - lo - 1) * sizeof(Timeout));
+				sorted[lo] = timeouts[i];
+			}
+			for (uint32_t i=0; i<n; i += 10) {
+				for (uint32_t j=0; j<array::size(sorted); ++j) {
+					if (sorted[j].id == i) {
+						memmove(&sorted[j], &sorted[j+1], (array::size(sorted) - j - 1) * sizeof(Timeout));
+						array::pop_back(sorted);
+						break;
+					}
+				}
+			}
+			uint64_t sum = 0;
+			while (array::any(sorted)) {
+				sum += array::back(sorted).id;
+				array::pop_back(sorted);
+			}
+			sink = sum;
+			report("sorted Array", n, seconds() - t0);
+		} else
+			printf("  %-40s skipped (quadratic)\n", "sorted Array");
+
+		// The priority queue cancels lazily: cancelled ids are flagged and
+		// skipped when they reach the top.
+		{
+			double t0 = seconds();
+			PriorityQueue<Timeout> q(a);
+			Array<char> cancelled(a);
+			array::resize(cancelled, n);
+			memset(array::begin(cancelled), 0, n);
+			for (uint32_t i=0; i<n; ++i)
+				priority_queue::push(q, timeouts[i]);
+			for (uint32_t i=0; i<n; i += 10)
+				cancelled[i] = 1;
+			uint64_t sum = 0;
+			while (!priority_queue::empty(q)) {
+				if (!cancelled[priority_queue::top(q).id])
+					sum += priority_queue::top(q).id;
+				priority_queue::pop(q);
+			}
+			sink = sum;
+			report("PriorityQueue push", n, seconds() - t0);
+		}
+
+		{
+			double t0 = seconds();
+			PriorityQueue<Timeout> q(a);
+			priority_queue::push(q, array::begin(timeouts), n);
+			uint64_t sum = 0;
+			while (!priority_queue::empty(q)) {
+				sum += priority_queue::top(q).id;
+				priority_queue::pop(q);
+			}
+			sink = sum;
+			report("PriorityQueue batch push", n, seconds() - t0);
+		}
+
+		{
+			double t0 = seconds();
+			TimerWheel w(a);
+			Array<timer_wheel::Handle> handles(a);
+			array::resize(handles, n);
+			for (uint32_t i=0; i<n; ++i)
+				handles[i] = timer_wheel::schedule(w, timeouts[i].expires, timeouts[i].id);
+			for (uint32_t i=0; i<n; i += 10)
+				timer_wheel::cancel(w, handles[i]);
+			Array<uint64_t> expired(a);
+			array::reserve(expired, n);
+			timer_wheel::advance(w, n * 4ull + 1, expired);
+			uint64_t sum = 0;
+			for (uint32_t i=0; i<array::size(expired); ++i)
+				sum += expired[i];
+			sink = sum;
+			report("TimerWheel", n, seconds() - t0);
+		}
+	}
+
+	// Times insert, lookup of present keys and lookup of missing keys for a
+	// hash type H with the hash:: interface.
+	template <typename H> void bench_hash_ops(const char *name, const Array<uint64_t> &keys, uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		char label[64];
+		H h(a);
+
+		double t0 = seconds();
+		for (uint32_t i=0; i<n; ++i)
+			hash::set(h, keys[i], i);
+		snprintf(label, sizeof(label), "%s insert", name);
+		report(label, n, seconds() - t0);
+
+		// Look up in a different order than inserted, so lookups don't walk
+		// memory sequentially.
+		uint64_t sum = 0;
+		t0 = seconds();
+		for (uint32_t i=0; i<n; ++i)
+			sum += hash::get(h, keys[(i * 7919ull) % n], 0u);
+		snprintf(label, sizeof(label), "%s lookup", name);
+		report(label, n, seconds() - t0);
+
+		t0 = seconds();
+		for (uint32_t i=0; i<n; ++i)
+			sum += hash::has(h, ~keys[i]);
+		snprintf(label, sizeof(label), "%s miss", name);
+		report(label, n, seconds() - t0);
+		sink = sum;
+	}
+
+	void random_keys(Array<uint64_t> &keys, uint32_t n)
+	{
+		Random r;
+		array::resize(keys, n);
+		for (uint32_t i=0; i<n; ++i)
+			keys[i] = r.next() & ~(1ull << 63);
+	}
+
+	// Compares Hash and FlatHash for sizes from 1K up to n entries.
+	void bench_flat_hash(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		Array<uint64_t> keys(a);
+		random_keys(keys, n);
+		for (uint32_t size = 1000; size <= n; size *= 10) {
+			printf("flat_hash (n = %u)\n", size);
+			bench_hash_ops< Hash<uint32_t> >("Hash", keys, size);
+			bench_hash_ops< FlatHash<uint32_t> >("FlatHash", keys, size);
+		}
+	}
+
+	// Measures the worst case latency of a single hash::set() while inserting
+	// n entries, with and without incremental rehashing.
+	void bench_hash_latency(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		Array<uint64_t> keys(a);
+		random_keys(keys, n);
+		printf("hash_latency (n = %u)\n", n);
+
+		const uint32_t steps[] = {0, 8};
+		for (uint32_t s=0; s<2; ++s) {
+			Hash<uint32_t> h(a);
+			hash::set_incremental_rehash(h, steps[s]);
+			double worst = 0;
+			const double t0 = seconds();
+			for (uint32_t i=0; i<n; ++i) {
+				const double t = seconds();
+				hash::set(h, keys[i], i);
+				const double dt = seconds() - t;
+				if (dt > worst)
+					worst = dt;
+			}
+			const double total = seconds() - t0;
+			printf("  %-40s %10.2f ms total %10.3f ms worst insert\n",
+				steps[s] ? "Hash incremental rehash" : "Hash", total * 1e3, worst * 1e3);
+		}
+	}
+
+	// Compares individual hash::get() calls with hash::get_many() on a table
+	// with n entries.
+	void bench_hash_batch(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		Array<uint64_t> keys(a);
+		random_keys(keys, n);
+		printf("hash_batch (n = %u)\n", n);
+
+		Hash<uint32_t> h(a);
+		Array<uint32_t> values(a);
+		array::resize(values, n);
+		for (uint32_t i=0; i<n; ++i)
+			values[i] = i;
+
+		// Both inserts start from a table reserved for n entries, so only the
+		// inserts are compared and not the growing.
+		hash::reserve(h, n * 2 + 10);
+		double t0 = seconds();
+		for (uint32_t i=0; i<n; ++i)
+			hash::set(h, keys[i], i);
+		report("set", n, seconds() - t0);
+		hash::clear(h);
+
+		hash::reserve(h, n * 2 + 10);
+		t0 = seconds();
+		hash::set_many(h, array::begin(keys), array::begin(values), n);
+		report("set_many", n, seconds() - t0);
+
+		Array<uint64_t> lookup(a);
+		array::resize(lookup, n);
+		for (uint32_t i=0; i<n; ++i)
+			lookup[i] = keys[(i * 7919ull) % n];
+
+		uint64_t sum = 0;
+		t0 = seconds();
+		for (uint32_t i=0; i<n; ++i)
+			sum += hash::get(h, lookup[i], 0u);
+		report("get", n, seconds() - t0);
+
+		t0 = seconds();
+		hash::get_many(h, array::begin(lookup), n, array::begin(values), 0u);
+		report("get_many", n, seconds() - t0);
+		for (uint32_t i=0; i<n; ++i)
+			sum += values[i];
+		sink = sum;
+	}
+
+	// Hashes n string keys of 8 to 40 bytes one at a time and with
+	// murmur_hash_64_batch(), then inserts them with set() and set_many().
+	void bench_murmur_batch(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("murmur_batch (n = %u)\n", n);
+
+		const uint32_t stride = 48;
+		Array<char> strings(a);
+		array::resize(strings, n * stride);
+		Array<const void *> keys(a);
+		Array<uint32_t> lens(a);
+		array::resize(keys, n);
+		array::resize(lens, n);
+		Random r;
+		for (uint32_t i=0; i<n; ++i) {
+			char *s = array::begin(strings) + i * stride;
+			const uint32_t len = 8 + r.next() % 33;
+			for (uint32_t j=0; j<len; ++j)
+				s[j] = 'a' + r.next() % 26;
+			keys[i] = s;
+			lens[i] = len;
+		}
+
+		Array<uint64_t> hashes(a);
+		array::resize(hashes, n);
+		double t0 = seconds();
+		for (uint32_t i=0; i<n; ++i)
+			hashes[i] = murmur_hash_64(keys[i], lens[i], 0);
+		report("murmur_hash_64", n, seconds() - t0);
+
+		t0 = seconds();
+		murmur_hash_64_batch(array::begin(keys), array::begin(lens), 0, array::begin(hashes), n);
+		report("murmur_hash_64_batch", n, seconds() - t0);
+
+		Array<uint32_t> values(a);
+		array::resize(values, n);
+		for (uint32_t i=0; i<n; ++i)
+			values[i] = i;
+
+		{
+			Hash<uint32_t> h(a);
+			hash::reserve(h, n * 2 + 10);
+			t0 = seconds();
+			for (uint32_t i=0; i<n; ++i)
+				hash::set(h, murmur_hash_64(keys[i], lens[i], 0), i);
+			report("murmur_hash_64 + set", n, seconds() - t0);
+		}
+		{
+			Hash<uint32_t> h(a);
+			hash::reserve(h, n * 2 + 10);
+			t0 = seconds();
+			murmur_hash_64_batch(array::begin(keys), array::begin(lens), 0, array::begin(hashes), n);
+			hash::set_many(h, array::begin(hashes), array::begin(values), n);
+			report("murmur_hash_64_batch + set_many", n, seconds() - t0);
+		}
+	}
+
+	template <uint32_t SIZE> struct Blob {
+		uint32_t data[SIZE / 4];
+	};
+
+	template <typename H, typename T> void bench_layout(const char *name, const Array<uint64_t> &keys, uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		const uint32_t before = a.total_allocated();
+		{
+			H h(a);
+			T value;
+			memset(&value, 0, sizeof(value));
+			for (uint32_t i=0; i<n; ++i) {
+				value.data[0] = i;
+				hash::set(h, keys[i], value);
+			}
+			const uint32_t bytes = a.total_allocated() - before;
+
+			uint64_t sum = 0;
+			const double t0 = seconds();
+			for (uint32_t i=0; i<n; ++i)
+				sum += hash::has(h, keys[(i * 7919ull) % n]);
+			for (uint32_t i=0; i<n; ++i)
+				sum += hash::has(h, ~keys[i]);
+			const double t = seconds() - t0;
+			sink = sum;
+			printf("  %-40s %10.2f ns/lookup %10.1f MB\n", name, t * 1e9 / (2 * n), bytes / (1024.0 * 1024.0));
+		}
+	}
+
+	// Compares the interleaved Hash layout with the SplitHash layout for 16 and
+	// 64 byte values.
+	void bench_split_hash(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		Array<uint64_t> keys(a);
+		random_keys(keys, n);
+		printf("split_hash (n = %u, hit + miss lookups)\n", n);
+		bench_layout< Hash< Blob<16> >, Blob<16> >("Hash 16 byte values", keys, n);
+		bench_layout< SplitHash< Blob<16> >, Blob<16> >("SplitHash 16 byte values", keys, n);
+		bench_layout< Hash< Blob<64> >, Blob<64> >("Hash 64 byte values", keys, n);
+		bench_layout< SplitHash< Blob<64> >, Blob<64> >("SplitHash 64 byte values", keys, n);
+	}
+
+	// Runs ops operations on each of num_threads threads, 95 % lookups and 5 %
+	// inserts of random keys in [0, n), and returns the elapsed time.
+	template <typename F> double run_read_mostly(uint32_t num_threads, uint32_t n, uint32_t ops, F f)
+	{
+		std::thread threads[64];
+		const double t0 = seconds();
+		for (uint32_t t=0; t<num_threads; ++t) {
+			threads[t] = std::thread([=]() {
+				Random r(t + 1);
+				uint64_t sum = 0;
+				for (uint32_t i=0; i<ops; ++i) {
+					const uint64_t x = r.next();
+					sum += f(x % n, x % 100 < 5);
+				}
+				sink = sum;
+			});
+		}
+		for (uint32_t t=0; t<num_threads; ++t)
+			threads[t].join();
+		return seconds() - t0;
+	}
+
+	// Read-heavy (95/5) scaling of ConcurrentHash compared with a Hash
+	// protected by a single mutex.
+	void bench_concurrent_hash(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		const uint32_t ops = 1000000;
+		uint32_t max_threads = std::thread::hardware_concurrency();
+		if (max_threads < 4)
+			max_threads = 4;
+		if (max_threads > 64)
+			max_threads = 64;
+		printf("concurrent_hash (n = %u, 95%% reads, %u hardware threads)\n", n, std::thread::hardware_concurrency());
+
+		for (uint32_t threads = 1; threads <= max_threads; threads *= 2) {
+			char label[64];
+			{
+				Hash<uint32_t> h(a);
+				std::mutex m;
+				for (uint32_t i=0; i<n; ++i)
+					hash::set(h, i, i);
+				const double t = run_read_mostly(threads, n, ops, [&h, &m](uint64_t key, bool write) -> uint64_t {
+					std::lock_guard<std::mutex> guard(m);
+					if (write) {
+						hash::set(h, key, uint32_t(key));
+						return 0;
+					}
+					return hash::get(h, key, 0u);
+				});
+				snprintf(label, sizeof(label), "mutex Hash, %u threads", threads);
+				printf("  %-40s %10.2f Mops/s\n", label, threads * ops / t * 1e-6);
+			}
+			{
+				ConcurrentHash<uint32_t> h(a);
+				for (uint32_t i=0; i<n; ++i)
+					hash::set(h, i, i);
+				const double t = run_read_mostly(threads, n, ops, [&h](uint64_t key, bool write) -> uint64_t {
+					if (write) {
+						hash::set(h, key, uint32_t(key));
+						return 0;
+					}
+					return hash::get(h, key, 0u);
+				});
+				snprintf(label, sizeof(label), "ConcurrentHash, %u threads", threads);
+				printf("  %-40s %10.2f Mops/s\n", label, threads * ops / t * 1e-6);
+			}
+		}
+	}
+
+	// Lookup cost and memory use of a FrozenHash compared with the Hash it was
+	// built from.
+	void bench_frozen_hash(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		Array<uint64_t> keys(a);
+		random_keys(keys, n);
+		printf("frozen_hash (n = %u, hit + miss lookups)\n", n);
+
+		Hash<uint32_t> h(a);
+		for (uint32_t i=0; i<n; ++i)
+			hash::set(h, keys[i], i);
+
+		FrozenHash<uint32_t> fh(a);
+		double t0 = seconds();
+		frozen_hash::build(fh, h);
+		printf("  %-40s %10.2f ns/key\n", "FrozenHash build", (seconds() - t0) * 1e9 / n);
+
+		// Look the keys up in random order, so the Hash entries (which are
+		// stored in insertion order) are not read sequentially.
+		Array<uint64_t> lookup(keys);
+		Random r(1);
+		for (uint32_t i=n; i>1; --i) {
+			const uint32_t j = uint32_t(r.next() % i);
+			const uint64_t tmp = lookup[i-1];
+			lookup[i-1] = lookup[j];
+			lookup[j] = tmp;
+		}
+
+		uint64_t sum = 0;
+		t0 = seconds();
+		for (uint32_t i=0; i<n; ++i)
+			sum += hash::get(h, lookup[i], 0u) + hash::has(h, ~lookup[i]);
+		double t = seconds() - t0;
+		const double hash_bytes = array::size(h._hash) * sizeof(uint32_t)
+			+ array::size(h._data) * sizeof(Hash<uint32_t>::Entry);
+		printf("  %-40s %10.2f ns/lookup %10.1f MB\n", "Hash", t * 1e9 / (2 * n), hash_bytes / (1024.0 * 1024.0));
+
+		t0 = seconds();
+		for (uint32_t i=0; i<n; ++i)
+			sum += hash::get(fh, lookup[i], 0u) + hash::has(fh, ~lookup[i]);
+		t = seconds() - t0;
+		printf("  %-40s %10.2f ns/lookup %10.1f MB\n", "FrozenHash", t * 1e9 / (2 * n), frozen_hash::data_size(fh) / (1024.0 * 1024.0));
+		sink = sum;
+	}
+
+	// Inverted index workload: n values spread over keys with 1000 values each,
+	// inserted interleaved. Compares multi_hash on a Hash with GroupedHash.
+	void bench_grouped_hash(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		const uint32_t per_key = 1000;
+		const uint32_t num_keys = n / per_key;
+		printf("grouped_hash (n = %u, %u keys with %u values each)\n", n, num_keys, per_key);
+
+		{
+			Hash<uint32_t> h(a);
+			double t0 = seconds();
+			for (uint32_t i=0; i<per_key; ++i)
+				for (uint32_t k=0; k<num_keys; ++k)
+					multi_hash::insert(h, k, i);
+			report("multi_hash insert", n, seconds() - t0);
+
+			uint64_t sum = 0;
+			t0 = seconds();
+			for (uint32_t k=0; k<num_keys; ++k) {
+				const Hash<uint32_t>::Entry *e = multi_hash::find_first(h, k);
+				while (e) {
+					sum += e->value;
+					e = multi_hash::find_next(h, e);
+				}
+			}
+			report("multi_hash get all values", n, seconds() - t0);
+
+			t0 = seconds();
+			for (uint32_t k=0; k<num_keys; ++k)
+				multi_hash::remove_all(h, k);
+			report("multi_hash remove_all", n, seconds() - t0);
+			sink = sum;
+		}
+		{
+			GroupedHash<uint32_t> h(a);
+			double t0 = seconds();
+			for (uint32_t i=0; i<per_key; ++i)
+				for (uint32_t k=0; k<num_keys; ++k)
+					grouped_hash::insert(h, k, i);
+			report("GroupedHash insert", n, seconds() - t0);
+
+			uint64_t sum = 0;
+			t0 = seconds();
+			for (uint32_t k=0; k<num_keys; ++k) {
+				uint32_t count;
+				const uint32_t *v = grouped_hash::get(h, k, &count);
+				for (uint32_t i=0; i<count; ++i)
+					sum += v[i];
+			}
+			report("GroupedHash get all values", n, seconds() - t0);
+
+			t0 = seconds();
+			for (uint32_t k=0; k<num_keys; ++k)
+				grouped_hash::remove_all(h, k);
+			report("GroupedHash remove_all", n, seconds() - t0);
+			sink = sum;
+		}
+	}
+
+	struct IsExpired {
+		bool operator()(uint64_t, uint32_t value) const {return value % 3 == 0;}
+	};
+
+	// Expires a third of the entries of a hash, with hash::remove() for each
+	// entry and with a single hash::remove_if().
+	void bench_hash_remove_if(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		Array<uint64_t> keys(a);
+		random_keys(keys, n);
+		printf("hash_remove_if (n = %u, removing 1/3 of the entries)\n", n);
+
+		{
+			Hash<uint32_t> h(a);
+			for (uint32_t i=0; i<n; ++i)
+				hash::set(h, keys[i], i);
+			const double t0 = seconds();
+			for (uint32_t i=0; i<n; i += 3)
+				hash::remove(h, keys[i]);
+			report("hash::remove", n / 3, seconds() - t0);
+		}
+		{
+			Hash<uint32_t> h(a);
+			for (uint32_t i=0; i<n; ++i)
+				hash::set(h, keys[i], i);
+			const double t0 = seconds();
+			hash::remove_if(h, IsExpired());
+			report("hash::remove_if", n / 3, seconds() - t0);
+		}
+	}
+
+	// Runs get() and put() on a miss for skewed random keys: 90 % of the
+	// lookups go to 10 % of the keys.
+	template <typename C> void run_cache(const char *name, C &c, uint32_t n, uint32_t num_keys)
+	{
+		Random r(7);
+		const double t0 = seconds();
+		for (uint32_t i=0; i<n; ++i) {
+			const uint64_t x = r.next();
+			const uint64_t key = x % 10 ? x % (num_keys / 10) : x % num_keys;
+			if (!cache::get(c, key))
+				cache::put(c, key, Blob<32>());
+		}
+		const double t = seconds() - t0;
+		printf("  %-40s %10.2f ns/op %8.1f %% hits\n", name, t * 1e9 / n, 100.0 * cache::hits(c) / n);
+	}
+
+	void bench_cache(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		const uint32_t capacity = 100000;
+		printf("cache (n = %u, capacity %u, 32 byte values)\n", n, capacity);
+		{
+			LruCache< Blob<32> > c(a, capacity, ~0ull);
+			run_cache("LruCache", c, n, capacity * 16);
+		}
+		{
+			ClockCache< Blob<32> > c(a, capacity, ~0ull);
+			run_cache("ClockCache", c, n, capacity * 16);
+		}
+	}
+
+	typedef uint64_t (*HashFunction)(const void *key, uint32_t len, uint64_t seed);
+
+	struct NamedHashFunction {
+		const char *name;
+		HashFunction f;
+	};
+
+	const NamedHashFunction HASH_FUNCTIONS[] = {
+		{"murmur_hash_64", murmur_hash_64},
+		{"wy_hash_64", wy_hash_64},
+		{"wide_hash_64", wide_hash_64},
+	};
+	const uint32_t NUM_HASH_FUNCTIONS = sizeof(HASH_FUNCTIONS) / sizeof(HASH_FUNCTIONS[0]);
+
+	// Returns the worst avalanche bias over all input/output bit pairs: the
+	// largest deviation from flipping an output bit half of the time when an
+	// input bit is flipped, scaled so that 0 is perfect and 1 is never/always.
+	// Keys longer than 32 bytes only flip 256 input bits, spread evenly over
+	// the key and over the bit positions within a byte.
+	double avalanche_bias(HashFunction f, uint32_t len, uint32_t trials)
+	{
+		const uint32_t MAX_BITS = 256;
+		const uint32_t num_bits = len * 8 < MAX_BITS ? len * 8 : MAX_BITS;
+		uint32_t flips[MAX_BITS][64];
+		memset(flips, 0, sizeof(flips));
+		Allocator &a = memory_globals::default_allocator();
+		Array<unsigned char> key(a);
+		array::resize(key, len);
+		Random r(len);
+		for (uint32_t t=0; t<trials; ++t) {
+			for (uint32_t i=0; i<len; ++i)
+				key[i] = (unsigned char)r.next();
+			const uint64_t h = f(array::begin(key), len, 0);
+			for (uint32_t b=0; b<num_bits; ++b) {
+				const uint32_t bit = len * 8 <= MAX_BITS ? b : (uint32_t)((uint64_t)b * len / MAX_BITS * 8 + b % 8);
+				key[bit / 8] ^= 1 << (bit % 8);
+				const uint64_t d = h ^ f(array::begin(key), len, 0);
+				key[bit / 8] ^= 1 << (bit % 8);
+				for (uint32_t o=0; o<64; ++o)
+					flips[b][o] += (d >> o) & 1;
+			}
+		}
+		double worst = 0;
+		for (uint32_t b=0; b<num_bits; ++b) {
+			for (uint32_t o=0; o<64; ++o) {
+				const double bias = fabs(2.0 * flips[b][o] / trials - 1.0);
+				worst = bias > worst ? bias : worst;
+			}
+		}
+		return worst;
+	}
+
+	// Inserts hashes of structured keys (consecutive integers or "item_<i>"
+	// strings) into a Hash with a power of two number of buckets, which only
+	// uses the low bits of the hash. Prints the fraction of empty buckets,
+	// which for a uniform hash should be e^-load, and the longest chain.
+	// If prefix is not 0, the strings start with prefix_length bytes of it.
+	void bucket_distribution(const char *name, HashFunction f, bool strings, uint32_t n, const char *prefix = 0, uint32_t prefix_length = 0)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		uint32_t buckets = 1;
+		while (buckets < n)
+			buckets *= 2;
+		const uint32_t m = (uint32_t)(buckets * 0.6);
+
+		Hash<uint32_t> h(a);
+		hash::reserve(h, buckets);
+		Array<char> s(a);
+		array::resize(s, prefix_length + 32);
+		if (prefix_length)
+			memcpy(array::begin(s), prefix, prefix_length);
+		for (uint32_t i=0; i<m; ++i) {
+			const uint64_t x = i;
+			const uint64_t key = strings
+				? f(array::begin(s), prefix_length + (uint32_t)snprintf(array::begin(s) + prefix_length, 32, "item_%u", i), 0)
+				: f(&x, sizeof(x), 0);
+			hash::set(h, key, i);
+		}
+
+		uint32_t empty = 0, longest = 0;
+		for (uint32_t b=0; b<buckets; ++b) {
+			uint32_t length = 0;
+			for (uint32_t i = h._hash[b]; i != 0xffffffffu; i = h._data[i].next)
+				++length;
+			empty += length == 0;
+			longest = length > longest ? length : longest;
+		}
+		printf("  %-40s %8.4f empty (expected %6.4f) %4u longest chain\n", name,
+			(double)empty / buckets, exp(-(double)m / buckets), longest);
+	}
+
+	// Hashes n bytes in total for key lengths from 1 byte to 1 MB with each of
+	// the hash functions, then checks avalanche and bucket distribution.
+	void bench_hash_functions(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("hash_functions (n = %u bytes per length)\n", n);
+
+		const uint32_t max_len = 1024 * 1024;
+		Array<unsigned char> data(a);
+		array::resize(data, max_len + 64);
+		Random r;
+		for (uint32_t i=0; i<array::size(data); ++i)
+			data[i] = (unsigned char)r.next();
+
+		const uint32_t lengths[] = {1, 4, 8, 16, 32, 64, 128, 256, 1024, 4096, 65536, max_len};
+		for (uint32_t l=0; l<sizeof(lengths)/sizeof(lengths[0]); ++l) {
+			const uint32_t len = lengths[l];
+			const uint32_t count = n / len > 16 ? n / len : 16;
+			for (uint32_t f=0; f<NUM_HASH_FUNCTIONS; ++f) {
+				// Vary the start of the key so the hashes can't be hoisted.
+				uint64_t sum = 0;
+				const double t0 = seconds();
+				for (uint32_t i=0; i<count; ++i)
+					sum += HASH_FUNCTIONS[f].f(array::begin(data) + (i & 63), len, 0);
+				const double t = seconds() - t0;
+				sink = sum;
+				char label[64];
+				snprintf(label, sizeof(label), "%s %u B", HASH_FUNCTIONS[f].name, len);
+				printf("  %-40s %10.2f GB/s %10.2f Mhash/s\n", label,
+					(double)count * len / t * 1e-9, count / t * 1e-6);
+			}
+		}
+
+		printf("avalanche (worst bias, 0 is ideal)\n");
+		// 256 bytes and up is wide_hash_64()'s SIMD path. Those lengths use
+		// fewer trials to keep the run time down, so their bias has more
+		// sampling noise and should only be compared between functions.
+		const uint32_t key_lengths[] = {8, 16, 32, 256, 1024, 4096};
+		for (uint32_t f=0; f<NUM_HASH_FUNCTIONS; ++f) {
+			printf("  %-40s", HASH_FUNCTIONS[f].name);
+			for (uint32_t l=0; l<sizeof(key_lengths)/sizeof(key_lengths[0]); ++l) {
+				const uint32_t len = key_lengths[l];
+				printf(" %u B: %6.4f", len, avalanche_bias(HASH_FUNCTIONS[f].f, len, len <= 32 ? 20000 : 2000));
+			}
+			printf("\n");
+		}
+
+		printf("bucket distribution (Hash<uint32_t>, load 0.6)\n");
+		const uint32_t prefix_length = 1024;
+		const char *prefix = (const char *)array::begin(data);
+		for (uint32_t f=0; f<NUM_HASH_FUNCTIONS; ++f) {
+			char label[64];
+			snprintf(label, sizeof(label), "%s integers", HASH_FUNCTIONS[f].name);
+			bucket_distribution(label, HASH_FUNCTIONS[f].f, false, 1 << 20);
+			snprintf(label, sizeof(label), "%s strings", HASH_FUNCTIONS[f].name);
+			bucket_distribution(label, HASH_FUNCTIONS[f].f, true, 1 << 20);
+			snprintf(label, sizeof(label), "%s %u B prefix + strings", HASH_FUNCTIONS[f].name, prefix_length);
+			bucket_distribution(label, HASH_FUNCTIONS[f].f, true, 1 << 18, prefix, prefix_length);
+		}
+	}
+
+	// Checksums an n byte buffer with murmur_hash_64(), wide_hash_64() and as
+	// a tree with different numbers of threads, then re-hashes and verifies
+	// a small changed range.
+	void bench_tree_hash(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("tree_hash (n = %u bytes, %u hardware threads)\n", n, std::thread::hardware_concurrency());
+
+		Array<char> data(a);
+		array::resize(data, n);
+		Random r;
+		for (uint32_t i=0; i<n; ++i)
+			data[i] = (char)r.next();
+
+		double t0 = seconds();
+		sink = murmur_hash_64(array::begin(data), n, 0);
+		double t = seconds() - t0;
+		printf("  %-40s %10.2f ms %10.2f GB/s\n", "murmur_hash_64", t * 1e3, n / t * 1e-9);
+
+		t0 = seconds();
+		sink = wide_hash_64(array::begin(data), n, 0);
+		t = seconds() - t0;
+		printf("  %-40s %10.2f ms %10.2f GB/s\n", "wide_hash_64", t * 1e3, n / t * 1e-9);
+
+		TreeHash th(a);
+		const uint32_t thread_counts[] = {1, 2, 4, 8, 0};
+		for (uint32_t i=0; i<sizeof(thread_counts)/sizeof(thread_counts[0]); ++i) {
+			t0 = seconds();
+			sink = tree_hash::build(th, array::begin(data), n, thread_counts[i]);
+			t = seconds() - t0;
+			char label[64];
+			snprintf(label, sizeof(label), "tree_hash::build %u threads%s", thread_counts[i], thread_counts[i] ? "" : " (auto)");
+			printf("  %-40s %10.2f ms %10.2f GB/s\n", label, t * 1e3, n / t * 1e-9);
+		}
+
+		data[n / 2] ^= 1;
+		t0 = seconds();
+		const bool ok = tree_hash::verify(th, array::begin(data), n / 2, 1);
+		printf("  %-40s %10.3f ms %s\n", "tree_hash::verify changed range", (seconds() - t0) * 1e3, ok ? "ok" : "mismatch");
+		t0 = seconds();
+		sink = tree_hash::update(th, array::begin(data), n / 2, 1);
+		printf("  %-40s %10.3f ms\n", "tree_hash::update changed range", (seconds() - t0) * 1e3);
+	}
+
+	// The number formatting that string_stream used before: snprintf into a
+	// stack buffer, then strlen and a copy.
+	template <typename T> void printf_number(Array<char> &b, const char *fmt, const T &t)
+	{
+		char s[32];
+		snprintf(s, 32, fmt, t);
+		string_stream::push(b, s, (uint32_t)strlen(s));
+	}
+
+	// Writes n numbers of each type to a string_stream with snprintf and with
+	// the string_stream operators.
+	void bench_string_stream(uint32_t n)
+	{
+		using namespace string_stream;
+		Allocator &a = memory_globals::default_allocator();
+		printf("string_stream (n = %u)\n", n);
+
+		Array<uint32_t> ints(a);
+		Array<float> floats(a);
+		array::resize(ints, n);
+		array::resize(floats, n);
+		Random r;
+		for (uint32_t i=0; i<n; ++i) {
+			ints[i] = (uint32_t)r.next() >> (r.next() % 32);
+			floats[i] = (float)(r.next() % 2000000) / 1000.0f - 1000.0f;
+		}
+
+		Buffer b(a);
+		array::reserve(b, n * 24);
+		double t0;
+
+		#define BENCH_FORMAT(label, expr) \
+			array::clear(b); \
+			t0 = seconds(); \
+			for (uint32_t i=0; i<n; ++i) \
+				expr; \
+			report(label, n, seconds() - t0); \
+			sink = array::size(b);
+
+		BENCH_FORMAT("snprintf %u", printf_number(b, "%u", ints[i]));
+		BENCH_FORMAT("operator<< uint32_t", b << ints[i]);
+		BENCH_FORMAT("snprintf %d", printf_number(b, "%d", (int32_t)ints[i]));
+		BENCH_FORMAT("operator<< int32_t", b << (int32_t)ints[i]);
+		BENCH_FORMAT("snprintf %llx", printf_number(b, "%llx", (unsigned long long)ints[i] * ints[i]));
+		BENCH_FORMAT("operator<< uint64_t", b << (uint64_t)ints[i] * ints[i]);
+		BENCH_FORMAT("snprintf %g", printf_number(b, "%g", floats[i]));
+		BENCH_FORMAT("snprintf %.9g", printf_number(b, "%.9g", floats[i]));
+		BENCH_FORMAT("operator<< float", b << floats[i]);
+
+		const char *name = "renderer";
+		BENCH_FORMAT("printf log line", string_stream::printf(b, "[%s] frame %u took %g ms (%d draws)\n", name, ints[i], floats[i], (int32_t)ints[i]));
+		BENCH_FORMAT("format log line", format(b, FORMAT_STRING("[{}] frame {} took {} ms ({} draws)\n"), name, ints[i], floats[i], (int32_t)ints[i]));
+
+		#undef BENCH_FORMAT
+	}
+
+	// Builds a report of n lines and writes it to /dev/null, with a
+	// string_stream that is written at the end, and with a RopeBuffer that is
+	// written at the end or flushed every 64K lines.
+	void bench_rope_buffer(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("rope_buffer (n = %u)\n", n);
+		const int fd = open("/dev/null", O_WRONLY);
+		const char *name = "renderer";
+
+		double t0 = seconds();
+		uint64_t memory;
+		{
+			using namespace string_stream;
+			Buffer b(a);
+			for (uint32_t i=0; i<n; ++i) {
+				b << name << ' ' << i << ": ";
+				tab(b, 24);
+				b << (float)i * 0.25f << '\n';
+			}
+			sink = ::write(fd, c_str(b), array::size(b));
+			memory = b._capacity;
+		}
+		report("string_stream", n, seconds() - t0);
+		printf("  %-40s %10.2f MB\n", "string_stream memory", memory / (1024.0 * 1024.0));
+
+		for (uint32_t flush_lines = 0; flush_lines <= 65536; flush_lines += 65536) {
+			t0 = seconds();
+			{
+				using namespace rope_buffer;
+				RopeBuffer r(a);
+				memory = 0;
+				for (uint32_t i=0; i<n; ++i) {
+					r << name << ' ' << i << ": ";
+					tab(r, 24);
+					r << (float)i * 0.25f << '\n';
+					if (flush_lines && i % flush_lines == flush_lines - 1) {
+						memory = std::max<uint64_t>(memory, num_chunks(r) * 64 * 1024ull);
+						flush(r, fd);
+					}
+				}
+				memory = std::max<uint64_t>(memory, num_chunks(r) * 64 * 1024ull);
+				write(r, fd);
+			}
+			report(flush_lines ? "rope_buffer, flush every 64K lines" : "rope_buffer", n, seconds() - t0);
+			printf("  %-40s %10.2f MB\n", flush_lines ? "rope_buffer memory, flushed" : "rope_buffer memory", memory / (1024.0 * 1024.0));
+		}
+		close(fd);
+	}
+
+	// Logs n lines to a temporary file, writing each line synchronously and
+	// through a LogSink.
+	void bench_log_sink(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("log_sink (n = %u)\n", n);
+		const char *name = "renderer";
+
+		FILE *f = tmpfile();
+		double t0 = seconds();
+		{
+			string_stream::Buffer b(a);
+			for (uint32_t i=0; i<n; ++i) {
+				array::clear(b);
+				string_stream::format(b, FORMAT_STRING("[{}] frame {} took {} ms\n"), name, i, (float)i * 0.25f);
+				sink = ::write(fileno(f), array::begin(b), array::size(b));
+			}
+		}
+		report("format + write() per line", n, seconds() - t0);
+		fclose(f);
+
+		f = tmpfile();
+		t0 = seconds();
+		double t1;
+		{
+			LogSink s(a, fileno(f));
+			{
+				LogWriter w(s);
+				for (uint32_t i=0; i<n; ++i) {
+					string_stream::format(log_writer::buffer(w), FORMAT_STRING("[{}] frame {} took {} ms\n"), name, i, (float)i * 0.25f);
+					log_writer::commit(w);
+				}
+			}
+			t1 = seconds();
+			log_sink::flush(s);
+			sink = log_sink::stats(s).written_bytes;
+		}
+		report("log_sink, logging thread", n, t1 - t0);
+		report("log_sink, until written", n, seconds() - t0);
+		fclose(f);
+	}
+
+	// Parses n lines of CSV with sscanf(), with strtoul()/strtod() and with a
+	// StringReader, and counts the lines with memchr() and with
+	// string_reader::read_line().
+	void bench_string_reader(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("string_reader (n = %u)\n", n);
+
+		string_stream::Buffer csv(a);
+		Random r;
+		for (uint32_t i=0; i<n; ++i) {
+			string_stream::printf(csv, "%u,%.6f,%d,item_%u\n", i, (double)(r.next() % 100000000) / 1000.0,
+				(int32_t)(r.next() % 2000) - 1000, (uint32_t)(r.next() % 1000));
+		}
+		const char *end = array::end(csv);
+		const double mb = array::size(csv) / (1024.0 * 1024.0);
+
+		double t0 = seconds();
+		double sum = 0;
+		for (const char *p = array::begin(csv); p != end; ) {
+			// sscanf() calls strlen(), so copy the line to a local buffer.
+			const char *eol = (const char *)memchr(p, '\n', end - p);
+			char line[128];
+			memcpy(line, p, eol - p);
+			line[eol - p] = 0;
+			unsigned id;
+			double value;
+			int delta;
+			sscanf(line, "%u,%lf,%d", &id, &value, &delta);
+			sum += id + value + delta;
+			p = eol + 1;
+		}
+		double t = seconds() - t0;
+		report("sscanf", n, t);
+		sink = (uint64_t)sum;
+
+		t0 = seconds();
+		sum = 0;
+		for (const char *p = array::begin(csv); p != end; ) {
+			char *q;
+			sum += strtoul(p, &q, 10);
+			sum += strtod(q + 1, &q);
+			sum += strtol(q + 1, &q, 10);
+			p = (const char *)memchr(q, '\n', end - q) + 1;
+		}
+		t = seconds() - t0;
+		report("strtoul/strtod/strtol", n, t);
+		sink = (uint64_t)sum;
+
+		t0 = seconds();
+		sum = 0;
+		{
+			using namespace string_reader;
+			StringReader reader(csv);
+			while (!at_end(reader)) {
+				const StringView line = read_line(reader);
+				StringReader fields(line.begin, line.end);
+				uint32_t id;
+				double value;
+				int32_t delta;
+				read(fields, id);
+				read_until(fields, ',');
+				read(fields, value);
+				read_until(fields, ',');
+				read(fields, delta);
+				sum += id + value + delta;
+			}
+		}
+		t = seconds() - t0;
+		report("string_reader", n, t);
+		printf("  %-40s %10.2f MB/s\n", "string_reader", mb / t);
+		sink = (uint64_t)sum;
+
+		t0 = seconds();
+		uint32_t lines = 0;
+		for (const char *p = array::begin(csv); p != end; ++lines)
+			p = (const char *)memchr(p, '\n', end - p) + 1;
+		t = seconds() - t0;
+		printf("  %-40s %10.2f MB/s\n", "memchr lines", mb / t);
+		sink = lines;
+
+		t0 = seconds();
+		lines = 0;
+		StringReader reader(csv);
+		for (; !string_reader::at_end(reader); ++lines)
+			string_reader::read_line(reader);
+		t = seconds() - t0;
+		printf("  %-40s %10.2f MB/s\n", "read_line lines", mb / t);
+		sink = lines;
+
+		// Long lines, where the scan dominates.
+		array::clear(csv);
+		for (uint32_t i=0; i<n / 64; ++i) {
+			string_stream::repeat(csv, 4000 + (uint32_t)(r.next() % 200), 'x');
+			string_stream::operator<<(csv, '\n');
+		}
+		end = array::end(csv);
+		t0 = seconds();
+		lines = 0;
+		for (const char *p = array::begin(csv); p != end; ++lines)
+			p = (const char *)memchr(p, '\n', end - p) + 1;
+		t = seconds() - t0;
+		printf("  %-40s %10.2f MB/s\n", "memchr lines, 4K lines", array::size(csv) / (1024.0 * 1024.0) / t);
+		sink = lines;
+		t0 = seconds();
+		reader = StringReader(csv);
+		for (lines = 0; !string_reader::at_end(reader); ++lines)
+			string_reader::read_line(reader);
+		t = seconds() - t0;
+		printf("  %-40s %10.2f MB/s\n", "read_line lines, 4K lines", array::size(csv) / (1024.0 * 1024.0) / t);
+		sink = lines;
+	}
+
+	// Writes and parses an SJSON document with n entities, then looks up
+	// members by key through the hash and by comparing the keys of the
+	// object's members.
+	void bench_sjson(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("sjson (n = %u)\n", n);
+
+		const char *fields[] = {"name", "type", "position", "rotation", "scale", "visible", "material", "script"};
+		string_stream::Buffer b(a);
+		Random r;
+		double t0 = seconds();
+		{
+			SjsonWriter w(b);
+			sjson_writer::begin_array(w, "entities");
+			for (uint32_t i=0; i<n; ++i) {
+				sjson_writer::begin_object(w, 0);
+				sjson_writer::write(w, fields[0], "entity name with some text");
+				sjson_writer::write(w, fields[1], (uint32_t)(r.next() % 100));
+				sjson_writer::begin_array(w, fields[2]);
+				for (uint32_t j=0; j<3; ++j)
+					sjson_writer::write(w, 0, (float)(r.next() % 100000) / 100.0f);
+				sjson_writer::end_array(w);
+				sjson_writer::write(w, fields[3], (float)(r.next() % 360));
+				sjson_writer::write(w, fields[4], 1.0f);
+				sjson_writer::write(w, fields[5], (r.next() & 1) != 0);
+				sjson_writer::write(w, fields[6], "materials/default");
+				sjson_writer::write(w, fields[7], "scripts/entity.lua");
+				sjson_writer::end_object(w);
+			}
+			sjson_writer::end_array(w);
+			sjson_writer::finish(w);
+		}
+		double t = seconds() - t0;
+		const double mb = array::size(b) / (1024.0 * 1024.0);
+		printf("  %-40s %10.2f MB/s\n", "sjson_writer", mb / t);
+
+		SjsonDocument d(a);
+		t0 = seconds();
+		const bool ok = sjson::parse(d, array::begin(b), array::size(b));
+		t = seconds() - t0;
+		printf("  %-40s %10.2f MB/s %s\n", "sjson::parse", mb / t, ok ? "" : sjson::error(d));
+
+		const uint32_t entities = sjson::get(d, sjson::root(d), "entities");
+		t0 = seconds();
+		uint64_t found = 0;
+		for (uint32_t e = sjson::first_child(d, entities), i = 0; e != sjson::end(d, entities); e = sjson::next(d, e), ++i)
+			found += sjson::get(d, e, fields[i % 8]);
+		report("sjson::get", n, seconds() - t0);
+		sink = found;
+
+		t0 = seconds();
+		found = 0;
+		for (uint32_t e = sjson::first_child(d, entities), i = 0; e != sjson::end(d, entities); e = sjson::next(d, e), ++i) {
+			for (uint32_t c = sjson::first_child(d, e); c != sjson::end(d, e); c = sjson::next(d, c)) {
+				if (strcmp(sjson::key(d, c), fields[i % 8]) == 0) {
+					found += c;
+					break;
+				}
+			}
+		}
+		report("comparing member keys", n, seconds() - t0);
+		sink = found;
+
+		// An object with n members, which are found through the hash.
+		array::clear(b);
+		for (uint32_t i=0; i<n; ++i)
+			string_stream::printf(b, "entity_%u = %u\n", i, i);
+		sjson::parse(d, array::begin(b), array::size(b));
+		Array<IdString64> keys(a);
+		array::resize(keys, n);
+		for (uint32_t i=0; i<n; ++i) {
+			char key[32];
+			const uint32_t len = (uint32_t)snprintf(key, sizeof(key), "entity_%u", (uint32_t)(r.next() % n));
+			keys[i] = IdString64(key, len);
+		}
+		t0 = seconds();
+		found = 0;
+		for (uint32_t i=0; i<n; ++i)
+			found += sjson::get(d, sjson::root(d), keys[i]);
+		report("sjson::get, large object", n, seconds() - t0);
+		sink = found;
+	}
+
+	// Naive scalar versions of the vector_math functions.
+	Matrix4x4 naive_multiply(const Matrix4x4 &a, const Matrix4x4 &b)
+	{
+		const float (*fa)[4] = (const float (*)[4])&a;
+		const float (*fb)[4] = (const float (*)[4])&b;
+		Matrix4x4 r;
+		float (*fr)[4] = (float (*)[4])&r;
+		for (uint32_t i=0; i<4; ++i) {
+			for (uint32_t j=0; j<4; ++j) {
+				float sum = 0;
+				for (uint32_t k=0; k<4; ++k)
+					sum += fa[i][k] * fb[k][j];
+				fr[i][j] = sum;
+			}
+		}
+		return r;
+	}
+
+	// Inverts by the adjugate, computing each cofactor from a 3x3 minor.
+	Matrix4x4 naive_inverse(const Matrix4x4 &m)
+	{
+		const float (*f)[4] = (const float (*)[4])&m;
+		float cofactor[4][4];
+		for (uint32_t i=0; i<4; ++i) {
+			for (uint32_t j=0; j<4; ++j) {
+				float minor[3][3];
+				for (uint32_t r=0, mr=0; r<4; ++r) {
+					if (r == i)
+						continue;
+					for (uint32_t c=0, mc=0; c<4; ++c) {
+						if (c != j)
+							minor[mr][mc++] = f[r][c];
+					}
+					++mr;
+				}
+				const float det = minor[0][0] * (minor[1][1] * minor[2][2] - minor[1][2] * minor[2][1])
+					- minor[0][1] * (minor[1][0] * minor[2][2] - minor[1][2] * minor[2][0])
+					+ minor[0][2] * (minor[1][0] * minor[2][1] - minor[1][1] * minor[2][0]);
+				cofactor[i][j] = (i + j) % 2 ? -det : det;
+			}
+		}
+		float det = 0;
+		for (uint32_t j=0; j<4; ++j)
+			det += f[0][j] * cofactor[0][j];
+		Matrix4x4 r;
+		float (*fr)[4] = (float (*)[4])&r;
+		for (uint32_t i=0; i<4; ++i) {
+			for (uint32_t j=0; j<4; ++j)
+				fr[i][j] = cofactor[j][i] / det;
+		}
+		return r;
+	}
+
+	Quaternion naive_quaternion_multiply(const Quaternion &a, const Quaternion &b)
+	{
+		Quaternion q;
+		q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+		q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+		q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+		q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+		return q;
+	}
+
+	Vector3 naive_transform_point(const Matrix4x4 &m, const Vector3 &p)
+	{
+		Vector3 r;
+		r.x = p.x * m.x.x + p.y * m.y.x + p.z * m.z.x + m.t.x;
+		r.y = p.x * m.x.y + p.y * m.y.y + p.z * m.z.y + m.t.y;
+		r.z = p.x * m.x.z + p.y * m.y.z + p.z * m.z.z + m.t.z;
+		return r;
+	}
+
+	// Runs the vector_math operations on n items and compares them with the
+	// naive scalar versions above.
+	void bench_vector_math(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("vector_math (n = %u)\n", n);
+
+		Array<Matrix4x4> ma(a), mb(a), mo(a);
+		Array<Quaternion> qa(a), qb(a), qo(a);
+		Array<Vector3> points(a), po(a);
+		array::resize(ma, n);
+		array::resize(mb, n);
+		array::resize(mo, n);
+		array::resize(qa, n);
+		array::resize(qb, n);
+		array::resize(qo, n);
+		array::resize(points, n);
+		array::resize(po, n);
+		Random r;
+		#define RANDOM_FLOAT ((float)(r.next() % 2000) / 1000.0f - 1.0f)
+		for (uint32_t i=0; i<n; ++i) {
+			float *f = &ma[i].x.x;
+			float *g = &mb[i].x.x;
+			for (uint32_t j=0; j<16; ++j) {
+				f[j] = RANDOM_FLOAT + (j % 5 == 0 ? 4.0f : 0.0f);
+				g[j] = RANDOM_FLOAT + (j % 5 == 0 ? 4.0f : 0.0f);
+			}
+			const Vector3 axis = {RANDOM_FLOAT, RANDOM_FLOAT, RANDOM_FLOAT + 2.0f};
+			qa[i] = quaternion::from_axis_angle(vector3::normalize(axis), RANDOM_FLOAT * 3.0f);
+			qb[i] = quaternion::from_axis_angle(vector3::normalize(axis * -1.0f), RANDOM_FLOAT * 3.0f);
+			points[i].x = RANDOM_FLOAT;
+			points[i].y = RANDOM_FLOAT;
+			points[i].z = RANDOM_FLOAT;
+		}
+		#undef RANDOM_FLOAT
+
+		#define BENCH_MATH(label, expr) { \
+			const double t0 = seconds(); \
+			for (uint32_t i=0; i<n; ++i) \
+				expr; \
+			report(label, n, seconds() - t0); \
+		}
+
+		BENCH_MATH("naive matrix multiply", mo[i] = naive_multiply(ma[i], mb[i]));
+		BENCH_MATH("matrix4x4::multiply", mo[i] = matrix4x4::multiply(ma[i], mb[i]));
+		{
+			const double t0 = seconds();
+			matrix4x4::multiply(array::begin(ma), array::begin(mb), array::begin(mo), n);
+			report("matrix4x4::multiply, array", n, seconds() - t0);
+		}
+		BENCH_MATH("naive matrix inverse", mo[i] = naive_inverse(ma[i]));
+		BENCH_MATH("matrix4x4::inverse", mo[i] = matrix4x4::inverse(ma[i]));
+		BENCH_MATH("naive quaternion multiply", qo[i] = naive_quaternion_multiply(qa[i], qb[i]));
+		BENCH_MATH("quaternion::multiply", qo[i] = quaternion::multiply(qa[i], qb[i]));
+		BENCH_MATH("quaternion::slerp", qo[i] = quaternion::slerp(qa[i], qb[i], 0.3f));
+		const Matrix4x4 &m = ma[0];
+		BENCH_MATH("naive transform point", po[i] = naive_transform_point(m, points[i]));
+		BENCH_MATH("matrix4x4::transform_point", po[i] = matrix4x4::transform_point(m, points[i]));
+		{
+			const double t0 = seconds();
+			matrix4x4::transform_points(m, array::begin(points), array::begin(po), n);
+			report("matrix4x4::transform_points", n, seconds() - t0);
+		}
+		#undef BENCH_MATH
+
+		sink = (uint64_t)(mo[n / 2].x.x + qo[n / 2].w + po[n / 2].y);
+	}
+
+	// Runs the batch kernels on n elements in structure-of-arrays form and
+	// compares them with the same operations on arrays of structs.
+	void bench_soa_array(uint32_t n)
+	{
+		Allocator &a = memory_globals::default_allocator();
+		printf("soa_array (n = %u)\n", n);
+
+		Array<Vector3> points(a), aos_out(a);
+		Array<Quaternion> rotations(a);
+		array::resize(points, n);
+		array::resize(aos_out, n);
+		array::resize(rotations, n);
+		Random r;
+		#define RANDOM_FLOAT ((float)(r.next() % 2000) / 1000.0f - 1.0f)
+		for (uint32_t i=0; i<n; ++i) {
+			points[i].x = RANDOM_FLOAT;
+			points[i].y = RANDOM_FLOAT;
+			points[i].z = RANDOM_FLOAT + 2.0f;
+			rotations[i] = quaternion::from_axis_angle(vector3::normalize(points[i]), RANDOM_FLOAT * 3.0f);
+		}
+		#undef RANDOM_FLOAT
+		Matrix4x4 m = matrix4x4::identity();
+		m.x.y = 0.5f;
+		m.t.x = 10.0f;
+		const Quaternion q = rotations[0];
+
+		// Everything is written once first, so that page faults aren't timed.
+		SoaArray<Vector3> soa(a), soa_out(a);
+		SoaArray<Quaternion> soa_rotations(a);
+		soa_array::from_aos(soa_rotations, array::begin(rotations), n);
+		soa_array::from_aos(soa, array::begin(points), n);
+		soa_array::from_aos(soa_out, array::begin(points), n);
+		memcpy(array::begin(aos_out), array::begin(points), n * sizeof(Vector3));
+		{
+			const double t0 = seconds();
+			soa_array::from_aos(soa, array::begin(points), n);
+			report("from_aos", n, seconds() - t0);
+		}
+		{
+			const double t0 = seconds();
+			soa_array::to_aos(soa, array::begin(aos_out));
+			report("to_aos", n, seconds() - t0);
+		}
+
+		#define BENCH_SOA(label, expr) { \
+			const double t0 = seconds(); \
+			expr; \
+			report(label, n, seconds() - t0); \
+		}
+
+		BENCH_SOA("aos transform_points", matrix4x4::transform_points(m, array::begin(points), array::begin(aos_out), n));
+		BENCH_SOA("soa transform_points", soa_array::transform_points(m, soa, soa_out));
+		BENCH_SOA("aos normalize", for (uint32_t i=0; i<n; ++i) aos_out[i] = vector3::normalize(points[i]));
+		BENCH_SOA("soa normalize", soa_array::normalize(soa_out));
+		BENCH_SOA("aos rotate", for (uint32_t i=0; i<n; ++i) aos_out[i] = quaternion::rotate(q, points[i]));
+		BENCH_SOA("soa rotate", soa_array::rotate(q, soa, soa_out));
+		BENCH_SOA("aos rotate, per element", for (uint32_t i=0; i<n; ++i) aos_out[i] = quaternion::rotate(rotations[i], points[i]));
+		BENCH_SOA("soa rotate, per element", soa_array::rotate(soa_rotations, soa, soa_out));
+		#undef BENCH_SOA
+
+		sink = (uint64_t)(aos_out[n / 2].x + soa_array::x(soa_out)[n / 2]);
+	}
+
+	struct Benchmark {
+		const char *name;
+		void (*run)(uint32_t n);
+		uint32_t default_n;
+	};
+
+	const Benchmark BENCHMARKS[] = {
+		{"timers", bench_timers, 100000},
+		{"flat_hash", bench_flat_hash, 1000000},
+		{"hash_latency", bench_hash_latency, 5000000},
+		{"hash_batch", bench_hash_batch, 4000000},
+		{"murmur_batch", bench_murmur_batch, 4000000},
+		{"hash_remove_if", bench_hash_remove_if, 3000000},
+		{"split_hash", bench_split_hash, 2000000},
+		{"concurrent_hash", bench_concurrent_hash, 1000000},
+		{"frozen_hash", bench_frozen_hash, 2000000},
+		{"grouped_hash", bench_grouped_hash, 1000000},
+		{"cache", bench_cache, 5000000},
+		{"hash_functions", bench_hash_functions, 256 * 1024 * 1024},
+		{"tree_hash", bench_tree_hash, 1024 * 1024 * 1024},
+		{"string_stream", bench_string_stream, 2000000},
+		{"rope_buffer", bench_rope_buffer, 10000000},
+		{"log_sink", bench_log_sink, 2000000},
+		{"string_reader", bench_string_reader, 5000000},
+		{"sjson", bench_sjson, 500000},
+		{"vector_math", bench_vector_math, 1000000},
+		{"soa_array", bench_soa_array, 1000000},
+	};
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t n = 0;
+	const char *selected[64];
+	uint32_t num_selected = 0;
+	for (int i=1; i<argc; ++i) {
+		if (strcmp(argv[i], "-n") == 0 && i+1 < argc)
+			n = (uint32_t)strtoul(argv[++i], 0, 10);
+		else if (num_selected < 64)
+			selected[num_selected++] = argv[i];
+	}
+
+	memory_globals::init();
+	for (uint32_t i=0; i<sizeof(BENCHMARKS)/sizeof(BENCHMARKS[0]); ++i) {
+		const Benchmark &b = BENCHMARKS[i];
+		bool run = num_selected == 0;
+		for (uint32_t j=0; j<num_selected; ++j)
+			run = run || strcmp(selected[j], b.name) == 0;
+		if (run)
+			b.run(n ? n : b.default_n);
+	}
+	memory_globals::shutdown();
+	return 0;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "array.h"
+#include "collection_types.h"
+#include "hash.h"
+
+namespace foundation {
+
+	/// The clock cache keeps its entries in a fixed size array and approximates
+	/// LRU with the CLOCK algorithm. A hit only sets the referenced flag of the
+	/// entry. To evict, a hand sweeps over the entries, clearing referenced
+	/// flags, until it finds an entry that hasn't been referenced since the
+	/// last sweep. Compared with LruCache, hits are cheaper (no list updates)
+	/// and the entries are smaller.
+	///
+	/// The interface and the byte budget work like for the LruCache.
+
+	namespace cache
+	{
+		/// Returns the cached value for the key and marks it as referenced, or
+		/// returns 0 if the key is not in the cache.
+		template<typename T> const T *get(ClockCache<T> &c, uint64_t key);
+
+		/// Returns true if the key is in the cache, without touching the
+		/// referenced flag or the counters.
+		template<typename T> bool has(const ClockCache<T> &c, uint64_t key);
+
+		/// Stores the value for the key, charging the specified number of bytes
+		/// against the byte budget. Entries are evicted to make room. If evicted
+		/// is not 0, the values of the evicted entries are pushed to it, as well
+		/// as the old value if the key was already cached and the value itself
+		/// if it is larger than the whole budget (such entries are not stored).
+		template<typename T> void put(ClockCache<T> &c, uint64_t key, const T &value, uint32_t bytes = sizeof(T), Array<T> *evicted = 0);
+
+		/// Removes the key from the cache. Returns false if it wasn't cached.
+		template<typename T> bool remove(ClockCache<T> &c, uint64_t key);
+
+		/// Removes all entries from the cache. The counters are kept.
+		template<typename T> void clear(ClockCache<T> &c);
+
+		/// Returns the number of entries and the number of bytes in the cache.
+		template<typename T> uint32_t size(const ClockCache<T> &c);
+		template<typename T> uint64_t bytes(const ClockCache<T> &c);
+
+		/// Returns the number of get() hits and misses and the number of
+		/// evictions.
+		template<typename T> uint64_t hits(const ClockCache<T> &c);
+		template<typename T> uint64_t misses(const ClockCache<T> &c);
+		template<typename T> uint64_t evictions(const ClockCache<T> &c);
+	}
+
+	namespace clock_cache_internal
+	{
+		const uint32_t NOT_FOUND = 0xffffffffu;
+
+		template<typename T> void release(ClockCache<T> &c, uint32_t i)
+		{
+			typename ClockCache<T>::Entry &e = c._entries[i];
+			hash::remove(c._index, e.key);
+			c._bytes -= e.bytes;
+			e.used = 0;
+			e.referenced = 0;
+			array::push_back(c._free, i);
+		}
+
+		/// Advances the hand to the next entry that hasn't been referenced and
+		/// evicts it. Terminates within two sweeps, since the first sweep clears
+		/// all referenced flags.
+		template<typename T> void evict(ClockCache<T> &c, Array<T> *evicted)
+		{
+			const uint32_t n = array::size(c._entries);
+			while (true) {
+				typename ClockCache<T>::Entry &e = c._entries[c._hand];
+				const uint32_t i = c._hand;
+				c._hand = c._hand + 1 == n ? 0 : c._hand + 1;
+				if (!e.used)
+					continue;
+				if (e.referenced) {
+					e.referenced = 0;
+					continue;
+				}
+				if (evicted)
+					array::push_back(*evicted, e.value);
+				release(c, i);
+				++c._evictions;
+				return;
+			}
+		}
+	}
+
+	namespace cache
+	{
+		template<typename T> const T *get(ClockCache<T> &c, uint64_t key)
+		{
+			const uint32_t i = hash::get(c._index, key, clock_cache_internal::NOT_FOUND);
+			if (i == clock_cache_internal::NOT_FOUND) {
+				++c._misses;
+				return 0;
+			}
+			++c._hits;
+			c._entries[i].referenced = 1;
+			return &c._entries[i].value;
+		}
+
+		template<typename T> bool has(const ClockCache<T> &c, uint64_t key)
+		{
+			return hash::has(c._index, key);
+		}
+
+		template<typename T> void put(ClockCache<T> &c, uint64_t key, const T &value, uint32_t bytes, Array<T> *evicted)
+		{
+			using namespace clock_cache_internal;
+
+			uint32_t i = hash::get(c._index, key, NOT_FOUND);
+			if (i != NOT_FOUND) {
+				if (evicted)
+					array::push_back(*evicted, c._entries[i].value);
+				release(c, i);
+			}
+			if (bytes > c._budget || array::size(c._entries) == 0) {
+				if (evicted)
+					array::push_back(*evicted, value);
+				return;
+			}
+
+			while (array::size(c._free) == 0 || c._bytes + bytes > c._budget)
+				evict(c, evicted);
+
+			i = array::back(c._free);
+			array::pop_back(c._free);
+			typename ClockCache<T>::Entry &e = c._entries[i];
+			e.key = key;
+			e.bytes = bytes;
+			e.used = 1;
+			e.referenced = 0;
+			e.value = value;
+			hash::set(c._index, key, i);
+			c._bytes += bytes;
+		}
+
+		template<typename T> bool remove(ClockCache<T> &c, uint64_t key)
+		{
+			const uint32_t i = hash::get(c._index, key, clock_cache_internal::NOT_FOUND);
+			if (i == clock_cache_internal::NOT_FOUND)
+				return false;
+			clock_cache_internal::release(c, i);
+			return true;
+		}
+
+		template<typename T> void clear(ClockCache<T> &c)
+		{
+			for (uint32_t i=0; i<array::size(c._entries); ++i) {
+				if (c._entries[i].used)
+					clock_cache_internal::release(c, i);
+			}
+		}
+
+		template<typename T> inline uint32_t size(const ClockCache<T> &c) {return array::size(c._entries) - array::size(c._free);}
+		template<typename T> inline uint64_t bytes(const ClockCache<T> &c) {return c._bytes;}
+		template<typename T> inline uint64_t hits(const ClockCache<T> &c) {return c._hits;}
+		template<typename T> inline uint64_t misses(const ClockCache<T> &c) {return c._misses;}
+		template<typename T> inline uint64_t evictions(const ClockCache<T> &c) {return c._evictions;}
+	}
+
+	template <typename T> ClockCache<T>::ClockCache(Allocator &a, uint32_t capacity, uint64_t byte_budget) :
+		_index(a), _entries(a), _free(a), _hand(0), _bytes(0), _budget(byte_budget),
+		_hits(0), _misses(0), _evictions(0)
+	{
+		// Size the index so that it never grows.
+		hash::reserve(_index, capacity * 10 / 7 + 10);
+		array::reserve(_index._data, capacity);
+
+		array::resize(_entries, capacity);
+		array::resize(_free, capacity);
+		for (uint32_t i=0; i<capacity; ++i) {
+			_entries[i].used = 0;
+			_entries[i].referenced = 0;
+			_free[i] = capacity - 1 - i;
+		}
+	}
+}
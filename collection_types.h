@@ -42,6 +42,22 @@ namespace foundation
 		uint32_t _offset;
 	};
 
+	/// A structure-of-arrays container for Vector3, Vector4 or Quaternion.
+	/// Each component is stored in a separate stream of floats, so that batch
+	/// operations can process several elements per SIMD instruction.
+	template<typename T> struct SoaArray
+	{
+		SoaArray(Allocator &a);
+		~SoaArray();
+		SoaArray(const SoaArray &other);
+		SoaArray &operator=(const SoaArray &other);
+
+		Allocator *_allocator;
+		uint32_t _size;
+		uint32_t _capacity;
+		float *_streams[4];
+	};
+
 	/// Hash from an uint64_t to POD objects. If you want to use a generic key
 	/// object, use a hash function to map that object to an uint64_t.
 	template<typename T> struct Hash
@@ -57,5 +73,415 @@ namespace foundation
 
 		Array<uint32_t> _hash;
 		Array<Entry> _data;
+
+		// Bucket array that is being migrated to _hash during an incremental
+		// rehash. Buckets below _migrated have already been moved.
+		Array<uint32_t> _old_hash;
+		uint32_t _migrated;
+		uint32_t _rehash_step;
+	};
+
+	/// Multi-map from an uint64_t to POD objects. All the values for a key are
+	/// stored contiguously in _values, so they can be retrieved as one span.
+	template<typename T> struct GroupedHash
+	{
+	public:
+		GroupedHash(Allocator &a);
+
+		/// The values of a key are _values[offset] ... _values[offset + size - 1].
+		/// The span has room for capacity values before it must be moved.
+		struct Group {
+			uint32_t offset;
+			uint32_t size;
+			uint32_t capacity;
+		};
+
+		Hash<Group> _groups;
+		Array<T> _values;
+
+		// Number of values in the hash and number of slots in _values that are
+		// no longer used by any group.
+		uint32_t _size;
+		uint32_t _garbage;
+	};
+
+	/// Hash from an uint64_t to POD objects, like Hash, but with the keys, the
+	/// next links and the values stored in separate arrays. Lookups only touch
+	/// the key and link arrays, and no padding is needed between the fields.
+	template<typename T> struct SplitHash
+	{
+	public:
+		SplitHash(Allocator &a);
+
+		Array<uint32_t> _hash;
+		Array<uint64_t> _keys;
+		Array<uint32_t> _next;
+		Array<T> _values;
+	};
+
+	/// Set of uint64_t keys. Works like a Hash without values.
+	struct HashSet
+	{
+	public:
+		HashSet(Allocator &a);
+
+		Array<uint32_t> _hash;
+		Array<uint64_t> _keys;
+		Array<uint32_t> _next;
+	};
+
+	template<typename K> struct MurmurKeyHash;
+	template<typename K> struct BytewiseEqual;
+
+	/// Hash from a generic POD key K to POD objects. Unlike Hash, the full
+	/// key is stored and compared, so different keys with the same hash
+	/// value don't collide. HashFn maps a key to an uint64_t and EqFn
+	/// compares two keys. The defaults hash and compare the bytes of the key.
+	template<typename K, typename V, typename HashFn = MurmurKeyHash<K>, typename EqFn = BytewiseEqual<K> >
+	struct KeyHash
+	{
+	public:
+		KeyHash(Allocator &a, const HashFn &hash_fn = HashFn(), const EqFn &eq_fn = EqFn());
+
+		typedef K Key;
+
+		struct Entry {
+			uint64_t hash;
+			uint32_t next;
+			K key;
+			V value;
+		};
+
+		Array<uint32_t> _hash;
+		Array<Entry> _data;
+		HashFn _hash_fn;
+		EqFn _eq_fn;
+	};
+
+	struct ConcurrentHashShard;
+
+	/// Hash from an uint64_t to POD objects that can be shared between threads.
+	/// The keys are distributed over a number of shards. Writers lock the shard
+	/// they modify, readers don't take any locks.
+	template<typename T> struct ConcurrentHash
+	{
+	public:
+		ConcurrentHash(Allocator &a, uint32_t num_shards = 64);
+		~ConcurrentHash();
+
+		/// Writers on different shards allocate at the same time, so the
+		/// allocator is wrapped in a LockedAllocator.
+		Allocator *_backing;
+		Allocator *_allocator;
+		uint32_t _num_shards;
+		ConcurrentHashShard *_shards;
+
+	private:
+		ConcurrentHash(const ConcurrentHash &other);
+		ConcurrentHash &operator=(const ConcurrentHash &other);
+	};
+
+	/// Read-only hash from an uint64_t to POD objects, built once from a known
+	/// set of keys using a minimal perfect hash function. The data is a single
+	/// relocatable block of memory that can be written to disk and used
+	/// directly from a memory mapped file.
+	template<typename T> struct FrozenHash
+	{
+	public:
+		FrozenHash(Allocator &a);
+		~FrozenHash();
+
+		Allocator *_allocator;
+		char *_owned;
+		const char *_data;
+
+	private:
+		FrozenHash(const FrozenHash &other);
+		FrozenHash &operator=(const FrozenHash &other);
+	};
+
+	/// Open addressing hash from an uint64_t to POD objects. Each slot has a
+	/// control byte and slots are probed in groups of 16 control bytes at a
+	/// time, so most lookups touch a single group and a single entry.
+	template<typename T> struct FlatHash
+	{
+	public:
+		FlatHash(Allocator &a);
+
+		struct Entry {
+			uint64_t key;
+			T value;
+		};
+
+		uint32_t _size;
+		uint32_t _deleted;
+		Array<uint8_t> _ctrl;
+		Array<Entry> _data;
+	};
+
+	/// Fixed capacity cache from an uint64_t to POD objects that evicts the
+	/// least recently used entry. All memory is allocated when the cache is
+	/// created. The recency list is stored as indices in the entry array.
+	template<typename T> struct LruCache
+	{
+	public:
+		LruCache(Allocator &a, uint32_t capacity, uint64_t byte_budget);
+
+		struct Entry {
+			uint64_t key;
+			uint32_t prev;
+			uint32_t next;
+			uint32_t bytes;
+			T value;
+		};
+
+		Hash<uint32_t> _index;
+		Array<Entry> _entries;
+		uint32_t _head;
+		uint32_t _tail;
+		uint32_t _free;
+		uint32_t _size;
+		uint64_t _bytes;
+		uint64_t _budget;
+		uint64_t _hits;
+		uint64_t _misses;
+		uint64_t _evictions;
+	};
+
+	/// Fixed capacity cache like LruCache, but evicts with the CLOCK algorithm.
+	/// A hit only sets a reference bit instead of moving the entry in a list.
+	template<typename T> struct ClockCache
+	{
+	public:
+		ClockCache(Allocator &a, uint32_t capacity, uint64_t byte_budget);
+
+		struct Entry {
+			uint64_t key;
+			uint32_t bytes;
+			uint8_t used;
+			uint8_t referenced;
+			T value;
+		};
+
+		Hash<uint32_t> _index;
+		Array<Entry> _entries;
+		Array<uint32_t> _free;
+		uint32_t _hand;
+		uint64_t _bytes;
+		uint64_t _budget;
+		uint64_t _hits;
+		uint64_t _misses;
+		uint64_t _evictions;
+	};
+
+	/// A priority queue of POD objects, implemented as a 4-ary min-heap stored
+	/// in an array. Items are ordered with operator<, the smallest item is at
+	/// the top of the queue.
+	template <typename T> struct PriorityQueue
+	{
+		PriorityQueue(Allocator &a);
+
+		Array<T> _data;
+	};
+
+	/// A hierarchical timer wheel for scheduling large numbers of timeouts.
+	/// Time is measured in integer ticks. Scheduling and cancelling a timer
+	/// are O(1) operations.
+	struct TimerWheel
+	{
+		TimerWheel(Allocator &a);
+
+		struct Timer {
+			uint64_t expires;
+			uint64_t data;
+			uint32_t next;
+			uint32_t prev;
+			uint32_t slot;
+			uint32_t generation;
+		};
+
+		uint64_t _now;
+		uint32_t _size;
+		uint32_t _level0;
+		uint32_t _free;
+		Array<uint32_t> _slots;
+		Array<Timer> _timers;
+	};
+
+	/// Stores interned strings and maps them to and from 64 bit IDs. The
+	/// strings are stored in large chunks of memory that never move.
+	struct StringPool
+	{
+		StringPool(Allocator &a, uint32_t chunk_size = 64*1024);
+		~StringPool();
+
+		Allocator *_allocator;
+		uint32_t _chunk_size;
+		char *_chunks;
+		uint32_t _used;
+		uint32_t _capacity;
+		uint32_t _collisions;
+		uint64_t _bytes;
+
+		Hash<uint32_t> _ids;
+		Array<const char *> _strings;
+
+	private:
+		StringPool(const StringPool &other);
+		StringPool &operator=(const StringPool &other);
+	};
+
+	/// A string that is built in a list of chunks instead of one contiguous
+	/// array, so that appending never copies what has already been written.
+	struct RopeBuffer
+	{
+		RopeBuffer(Allocator &a, uint32_t chunk_size = 64*1024);
+		~RopeBuffer();
+
+		struct Chunk {
+			char *data;
+			uint32_t size;
+			uint32_t capacity;
+		};
+
+		Allocator *_allocator;
+		uint32_t _chunk_size;
+		uint64_t _size;
+		Array<Chunk> _chunks;
+
+	private:
+		RopeBuffer(const RopeBuffer &other);
+		RopeBuffer &operator=(const RopeBuffer &other);
+	};
+
+	/// A range of characters in a string that is owned by someone else.
+	struct StringView
+	{
+		const char *begin;
+		const char *end;
+	};
+
+	/// A read cursor over a range of characters. The reader doesn't own or copy
+	/// the text.
+	struct StringReader
+	{
+		StringReader(const char *begin, const char *end);
+		StringReader(const Array<char> &a);
+
+		const char *_p;
+		const char *_end;
+	};
+
+	/// A value in a parsed SJSON document. The nodes of a document are stored
+	/// in document order, so the children of an object or array directly
+	/// follow it.
+	struct SjsonNode
+	{
+		enum Type {NIL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT};
+
+		/// murmur_hash_64() of the key, for members of objects.
+		uint64_t key;
+		uint32_t type;
+		/// Index of the node after this node and its children.
+		uint32_t next;
+		/// Offset of the key in the document's strings.
+		uint32_t key_offset;
+		/// Number of children of objects and arrays, length of strings.
+		uint32_t count;
+		union {
+			double number;
+			bool boolean;
+			uint32_t string_offset;
+		};
+	};
+
+	/// A parsed SJSON document. The members of large objects are found
+	/// through a hash of the object node and the key, so looking up a member
+	/// doesn't search the object.
+	struct SjsonDocument
+	{
+		SjsonDocument(Allocator &a);
+
+		Array<SjsonNode> _nodes;
+		Array<char> _strings;
+		Hash<uint32_t> _keys;
+		const char *_error;
+		uint32_t _error_line;
+	};
+
+	/// Writes SJSON (or JSON) to a string_stream::Buffer.
+	struct SjsonWriter
+	{
+		SjsonWriter(Array<char> &buffer, bool json = false);
+
+		Array<char> *_buffer;
+		bool _json;
+		/// True until something has been written at the current depth.
+		bool _first;
+		uint32_t _depth;
+		/// Bit i is set if depth i is an array.
+		uint64_t _in_array;
+	};
+
+	struct LogSinkState;
+
+	/// Writes log text to a file descriptor from a background thread. Threads
+	/// don't write to the sink directly, they format their lines into the
+	/// buffer of a LogWriter, which is handed over to the background thread
+	/// when it fills up.
+	struct LogSink
+	{
+		/// What writers do when the background thread falls behind and
+		/// max_queued buffers are already waiting to be written: BLOCK waits
+		/// until a buffer has been written, DROP throws the new buffer away.
+		enum Overflow {BLOCK, DROP};
+
+		LogSink(Allocator &a, int fd, uint32_t buffer_size = 64*1024, uint32_t max_queued = 16, Overflow overflow = BLOCK);
+		~LogSink();
+
+		LogSinkState *_state;
+
+	private:
+		LogSink(const LogSink &other);
+		LogSink &operator=(const LogSink &other);
+	};
+
+	/// Byte counters of a LogSink. All counters start at zero when the sink is
+	/// created and only increase.
+	struct LogSinkStats
+	{
+		uint64_t queued_bytes;
+		uint64_t written_bytes;
+		uint64_t dropped_bytes;
+	};
+
+	/// A thread's buffer for writing to a LogSink. Each thread that logs to a
+	/// sink needs its own LogWriter, and the writers must be destroyed before
+	/// the sink.
+	struct LogWriter
+	{
+		LogWriter(LogSink &sink);
+		~LogWriter();
+
+		LogSink *_sink;
+		Array<char> *_buffer;
+
+	private:
+		LogWriter(const LogWriter &other);
+		LogWriter &operator=(const LogWriter &other);
+	};
+
+	/// The leaf hashes and the root hash of a buffer that is hashed as a tree.
+	/// Keeping the leaf hashes allows changed parts of the buffer to be
+	/// re-hashed and verified without hashing the whole buffer.
+	struct TreeHash
+	{
+		TreeHash(Allocator &a, uint32_t leaf_size = 1024*1024, uint64_t seed = 0);
+
+		uint32_t _leaf_size;
+		uint64_t _seed;
+		uint64_t _length;
+		uint64_t _root;
+		Array<uint64_t> _leaves;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,402 @@
+#pragma once
+
+#include "collection_types.h"
+#include "memory.h"
+#include "locked_allocator.h"
+
+#include <assert.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <new>
+
+namespace foundation {
+
+	/// Each shard of the concurrent hash is a "list-in-an-array" hash like the
+	/// regular Hash, stored in a single table allocation. Writers lock the shard
+	/// mutex and bracket their modifications with a sequence counter (a
+	/// seqlock). Readers don't lock. They read the sequence counter, do the
+	/// lookup and retry if the counter changed while they were reading.
+	///
+	/// When a shard grows, the entries are copied to a new table that is then
+	/// published to the readers. The old table can still be in use by readers,
+	/// so it is kept until concurrent_hash::collect() is called.
+	///
+	/// All the data that readers access while a writer may modify it is read
+	/// and written with relaxed atomic operations, so that the unlocked reads
+	/// are not data races.
+
+	namespace hash
+	{
+		/// Returns true if the specified key exists in the hash.
+		template<typename T> bool has(const ConcurrentHash<T> &h, uint64_t key);
+
+		/// Returns the value stored for the specified key, or deffault if the key
+		/// does not exist in the hash. Note that the value is returned by value,
+		/// since other threads may modify the hash.
+		template<typename T> T get(const ConcurrentHash<T> &h, uint64_t key, const T &deffault);
+
+		/// Sets the value for the key.
+		template<typename T> void set(ConcurrentHash<T> &h, uint64_t key, const T &value);
+
+		/// Removes the key from the hash if it exists.
+		template<typename T> void remove(ConcurrentHash<T> &h, uint64_t key);
+	}
+
+	namespace concurrent_hash
+	{
+		/// Returns the number of entries in the hash. The result is approximate if
+		/// other threads are modifying the hash.
+		template<typename T> uint32_t size(const ConcurrentHash<T> &h);
+
+		/// Frees the tables that have been replaced when shards have grown. Must
+		/// only be called when no other threads are accessing the hash.
+		template<typename T> void collect(ConcurrentHash<T> &h);
+	}
+
+	/// The shard data is aligned to a cache line to avoid false sharing between
+	/// shards.
+	struct alignas(64) ConcurrentHashShard
+	{
+		std::atomic<uint32_t> seq;
+		std::atomic<char *> table;
+		std::mutex lock;
+		char *retired;
+	};
+
+	namespace concurrent_hash_internal
+	{
+		const uint32_t END_OF_LIST = 0xffffffffu;
+
+		/// Header at the start of each table allocation. It is followed by the
+		/// bucket array and the entry array.
+		struct Table
+		{
+			uint32_t num_buckets;
+			uint32_t capacity;
+			uint32_t size;
+			char *next_retired;
+		};
+
+		template<typename T> struct Entry
+		{
+			uint64_t key;
+			uint32_t next;
+			T value;
+		};
+
+		/// Relaxed atomic loads and stores of words that readers access
+		/// without the lock.
+		template<typename W> inline W load_relaxed(const W &w)
+		{
+		#if defined(__GNUC__)
+			return __atomic_load_n(&w, __ATOMIC_RELAXED);
+		#else
+			return *(const volatile W *)&w;
+		#endif
+		}
+
+		template<typename W> inline void store_relaxed(W &w, W value)
+		{
+		#if defined(__GNUC__)
+			__atomic_store_n(&w, value, __ATOMIC_RELAXED);
+		#else
+			*(volatile W *)&w = value;
+		#endif
+		}
+
+		/// Copies n bytes with relaxed atomic loads from or stores to shared
+		/// memory. It is done byte by byte, since T can have any layout.
+		inline void load_bytes_relaxed(void *dest, const void *shared, uint32_t n)
+		{
+			for (uint32_t i=0; i<n; ++i)
+				((char *)dest)[i] = load_relaxed(((const char *)shared)[i]);
+		}
+
+		inline void store_bytes_relaxed(void *shared, const void *source, uint32_t n)
+		{
+			for (uint32_t i=0; i<n; ++i)
+				store_relaxed(((char *)shared)[i], ((const char *)source)[i]);
+		}
+
+		inline uint32_t *buckets(char *t) {return (uint32_t *)(t + sizeof(Table));}
+		inline const uint32_t *buckets(const char *t) {return (const uint32_t *)(t + sizeof(Table));}
+
+		template<typename T> inline uint32_t entries_offset(uint32_t num_buckets)
+		{
+			const uint32_t align = alignof(Entry<T>);
+			const uint32_t offset = sizeof(Table) + num_buckets * sizeof(uint32_t);
+			return (offset + align - 1) / align * align;
+		}
+
+		template<typename T> inline Entry<T> *entries(char *t)
+		{
+			return (Entry<T> *)(t + entries_offset<T>(((Table *)t)->num_buckets));
+		}
+
+		template<typename T> inline const Entry<T> *entries(const char *t)
+		{
+			return (const Entry<T> *)(t + entries_offset<T>(((const Table *)t)->num_buckets));
+		}
+
+		template<typename T> inline ConcurrentHashShard &shard(const ConcurrentHash<T> &h, uint64_t key)
+		{
+			// Use the high bits of a multiplicative hash to pick the shard, the
+			// buckets within the shard use key % num_buckets.
+			const uint64_t mixed = key * 0x9e3779b97f4a7c15ull;
+			return h._shards[uint32_t(mixed >> 32) & (h._num_shards - 1)];
+		}
+
+		/// Reader side lookup. Copies the value and returns true if the key was
+		/// found. Since the table may be modified while it is read, every index
+		/// is bounds checked and the chain walk is limited to the capacity of
+		/// the table. The result is only used if the sequence counter shows that
+		/// no writer was active.
+		template<typename T> bool read(const ConcurrentHashShard &s, uint64_t key, T *value)
+		{
+			while (true) {
+				const uint32_t seq = s.seq.load(std::memory_order_acquire);
+				if (seq & 1) {
+					// A writer is active, let it finish (it may be waiting for
+					// this core).
+					std::this_thread::yield();
+					continue;
+				}
+
+				bool found = false;
+				const char *t = s.table.load(std::memory_order_acquire);
+				if (t) {
+					const Table &table = *(const Table *)t;
+					const Entry<T> *e = entries<T>(t);
+					uint32_t i = load_relaxed(buckets(t)[key % table.num_buckets]);
+					for (uint32_t steps = 0; i < table.capacity && steps < table.capacity; ++steps) {
+						if (load_relaxed(e[i].key) == key) {
+							if (value)
+								load_bytes_relaxed(value, &e[i].value, sizeof(T));
+							found = true;
+							break;
+						}
+						i = load_relaxed(e[i].next);
+					}
+				}
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (s.seq.load(std::memory_order_relaxed) == seq)
+					return found;
+			}
+		}
+
+		inline void begin_write(ConcurrentHashShard &s)
+		{
+			s.seq.store(s.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		inline void end_write(ConcurrentHashShard &s)
+		{
+			s.seq.store(s.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		/// Writer side lookup, the shard lock must be held.
+		template<typename T> uint32_t find(char *t, uint64_t key, uint32_t *prev)
+		{
+			*prev = END_OF_LIST;
+			if (!t)
+				return END_OF_LIST;
+			Entry<T> *e = entries<T>(t);
+			uint32_t i = buckets(t)[key % ((Table *)t)->num_buckets];
+			while (i != END_OF_LIST && e[i].key != key) {
+				*prev = i;
+				i = e[i].next;
+			}
+			return i;
+		}
+
+		/// Allocates a table with room for capacity entries, containing the
+		/// entries of the old table.
+		template<typename T> char *make_table(Allocator &a, const char *old, uint32_t capacity)
+		{
+			const uint32_t num_buckets = capacity * 10 / 7 + 1;
+			const uint32_t bytes = entries_offset<T>(num_buckets) + capacity * sizeof(Entry<T>);
+			const uint32_t align = alignof(Entry<T>) > alignof(Table) ? alignof(Entry<T>) : alignof(Table);
+			char *t = (char *)a.allocate(bytes, align);
+
+			Table &table = *(Table *)t;
+			table.num_buckets = num_buckets;
+			table.capacity = capacity;
+			table.size = 0;
+			table.next_retired = 0;
+			uint32_t *b = buckets(t);
+			for (uint32_t i=0; i<num_buckets; ++i)
+				b[i] = END_OF_LIST;
+
+			if (old) {
+				const Table &old_table = *(const Table *)old;
+				Entry<T> *e = entries<T>(t);
+				memcpy((void *)e, (const void *)entries<T>(old), old_table.size * sizeof(Entry<T>));
+				for (uint32_t i=0; i<old_table.size; ++i) {
+					const uint32_t bi = e[i].key % num_buckets;
+					e[i].next = b[bi];
+					b[bi] = i;
+				}
+				table.size = old_table.size;
+			}
+			return t;
+		}
+
+		/// Finds the link that points to entry i, the shard lock must be held.
+		template<typename T> uint32_t *link_to(char *t, uint32_t i)
+		{
+			Entry<T> *e = entries<T>(t);
+			uint32_t *link = &buckets(t)[e[i].key % ((Table *)t)->num_buckets];
+			while (*link != i)
+				link = &e[*link].next;
+			return link;
+		}
+	}
+
+	namespace hash
+	{
+		template<typename T> bool has(const ConcurrentHash<T> &h, uint64_t key)
+		{
+			const ConcurrentHashShard &s = concurrent_hash_internal::shard(h, key);
+			return concurrent_hash_internal::read<T>(s, key, 0);
+		}
+
+		template<typename T> T get(const ConcurrentHash<T> &h, uint64_t key, const T &deffault)
+		{
+			const ConcurrentHashShard &s = concurrent_hash_internal::shard(h, key);
+			T value;
+			return concurrent_hash_internal::read<T>(s, key, &value) ? value : deffault;
+		}
+
+		template<typename T> void set(ConcurrentHash<T> &h, uint64_t key, const T &value)
+		{
+			using namespace concurrent_hash_internal;
+			ConcurrentHashShard &s = shard(h, key);
+			std::lock_guard<std::mutex> guard(s.lock);
+
+			char *t = s.table.load(std::memory_order_relaxed);
+			uint32_t prev;
+			const uint32_t i = find<T>(t, key, &prev);
+			if (i != END_OF_LIST) {
+				begin_write(s);
+				store_bytes_relaxed(&entries<T>(t)[i].value, &value, sizeof(T));
+				end_write(s);
+				return;
+			}
+
+			// Grow by publishing a new table. Readers that already loaded the
+			// old table can keep using it, it is not modified anymore.
+			if (!t || ((Table *)t)->size == ((Table *)t)->capacity) {
+				char *old = t;
+				t = make_table<T>(*h._allocator, old, old ? ((Table *)old)->capacity * 2 : 16);
+				s.table.store(t, std::memory_order_release);
+				if (old) {
+					((Table *)old)->next_retired = s.retired;
+					s.retired = old;
+				}
+			}
+
+			begin_write(s);
+			Table &table = *(Table *)t;
+			Entry<T> &e = entries<T>(t)[table.size];
+			uint32_t &bucket = buckets(t)[key % table.num_buckets];
+			store_relaxed(e.key, key);
+			store_bytes_relaxed(&e.value, &value, sizeof(T));
+			store_relaxed(e.next, bucket);
+			store_relaxed(bucket, table.size);
+			store_relaxed(table.size, table.size + 1);
+			end_write(s);
+		}
+
+		template<typename T> void remove(ConcurrentHash<T> &h, uint64_t key)
+		{
+			using namespace concurrent_hash_internal;
+			ConcurrentHashShard &s = shard(h, key);
+			std::lock_guard<std::mutex> guard(s.lock);
+
+			char *t = s.table.load(std::memory_order_relaxed);
+			uint32_t prev;
+			const uint32_t i = find<T>(t, key, &prev);
+			if (i == END_OF_LIST)
+				return;
+
+			begin_write(s);
+			Table &table = *(Table *)t;
+			Entry<T> *e = entries<T>(t);
+			if (prev == END_OF_LIST)
+				store_relaxed(buckets(t)[key % table.num_buckets], e[i].next);
+			else
+				store_relaxed(e[prev].next, e[i].next);
+
+			// Move the last entry into the hole to keep the entries packed.
+			const uint32_t last = table.size - 1;
+			if (i != last) {
+				uint32_t *link = link_to<T>(t, last);
+				store_relaxed(e[i].key, e[last].key);
+				store_bytes_relaxed(&e[i].value, &e[last].value, sizeof(T));
+				store_relaxed(e[i].next, e[last].next);
+				store_relaxed(*link, i);
+			}
+			store_relaxed(table.size, last);
+			end_write(s);
+		}
+	}
+
+	namespace concurrent_hash
+	{
+		template<typename T> uint32_t size(const ConcurrentHash<T> &h)
+		{
+			uint32_t n = 0;
+			for (uint32_t i=0; i<h._num_shards; ++i) {
+				const char *t = h._shards[i].table.load(std::memory_order_acquire);
+				if (t)
+					n += concurrent_hash_internal::load_relaxed(((const concurrent_hash_internal::Table *)t)->size);
+			}
+			return n;
+		}
+
+		template<typename T> void collect(ConcurrentHash<T> &h)
+		{
+			for (uint32_t i=0; i<h._num_shards; ++i) {
+				ConcurrentHashShard &s = h._shards[i];
+				while (s.retired) {
+					char *next = ((concurrent_hash_internal::Table *)s.retired)->next_retired;
+					h._allocator->deallocate(s.retired);
+					s.retired = next;
+				}
+			}
+		}
+	}
+
+	/// num_shards must be a power of two. The allocator doesn't have to be
+	/// thread-safe, the hash allocates through a LockedAllocator.
+	template <typename T> ConcurrentHash<T>::ConcurrentHash(Allocator &a, uint32_t num_shards) :
+		_backing(&a), _allocator(0), _num_shards(num_shards), _shards(0)
+	{
+		assert(num_shards > 0 && (num_shards & (num_shards - 1)) == 0);
+		_allocator = MAKE_NEW(a, LockedAllocator, a);
+		_shards = (ConcurrentHashShard *)a.allocate(sizeof(ConcurrentHashShard) * num_shards,
+			alignof(ConcurrentHashShard));
+		for (uint32_t i=0; i<num_shards; ++i) {
+			ConcurrentHashShard *s = new (_shards + i) ConcurrentHashShard;
+			s->seq.store(0);
+			s->table.store(0);
+			s->retired = 0;
+		}
+	}
+
+	template <typename T> ConcurrentHash<T>::~ConcurrentHash()
+	{
+		concurrent_hash::collect(*this);
+		for (uint32_t i=0; i<_num_shards; ++i) {
+			_allocator->deallocate(_shards[i].table.load());
+			_shards[i].~ConcurrentHashShard();
+		}
+		_allocator->deallocate(_shards);
+		Allocator &backing = *_backing;
+		MAKE_DELETE(backing, Allocator, _allocator);
+	}
+}
@@ -0,0 +1,355 @@
+#include "fast_hash.h"
+#include "simd.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define FAST_HASH_AVX2
+	#define FAST_HASH_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(__AVX2__)
+	#include <immintrin.h>
+	#define FAST_HASH_AVX2
+	#define FAST_HASH_AVX2_TARGET
+#endif
+
+namespace foundation
+{
+	namespace
+	{
+		const uint64_t SECRET[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+		inline uint64_t read_64(const unsigned char *p)
+		{
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			#ifdef PLATFORM_BIG_ENDIAN
+				v = (v >> 56) | ((v >> 40) & 0xff00ull) | ((v >> 24) & 0xff0000ull) | ((v >> 8) & 0xff000000ull)
+					| ((v << 8) & 0xff00000000ull) | ((v << 24) & 0xff0000000000ull) | ((v << 40) & 0xff000000000000ull) | (v << 56);
+			#endif
+			return v;
+		}
+
+		inline uint64_t read_32(const unsigned char *p)
+		{
+			uint32_t v;
+			memcpy(&v, p, sizeof(v));
+			#ifdef PLATFORM_BIG_ENDIAN
+				v = (v >> 24) | ((v >> 8) & 0xff00u) | ((v << 8) & 0xff0000u) | (v << 24);
+			#endif
+			return v;
+		}
+
+		/// Reads 1-3 bytes.
+		inline uint64_t read_small(const unsigned char *p, uint32_t len)
+		{
+			return (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+		}
+
+		/// Sets a and b to the low and high halves of the 128 bit product a * b.
+		inline void multiply_128(uint64_t &a, uint64_t &b)
+		{
+		#if defined(__SIZEOF_INT128__)
+			const __uint128_t r = (__uint128_t)a * b;
+			a = (uint64_t)r;
+			b = (uint64_t)(r >> 64);
+		#else
+			const uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+			const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+			const uint64_t t = rl + (rm0 << 32);
+			uint64_t c = t < rl;
+			const uint64_t lo = t + (rm1 << 32);
+			c += lo < t;
+			a = lo;
+			b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+		#endif
+		}
+
+		inline uint64_t mix(uint64_t a, uint64_t b)
+		{
+			multiply_128(a, b);
+			return a ^ b;
+		}
+
+		// The wide hash processes the input in stripes of 64 bytes, one 64 bit
+		// word per lane. After every 16 stripes the accumulators are scrambled.
+		const uint32_t LANES = 8;
+		const uint32_t STRIPE = 64;
+		const uint32_t STRIPES_PER_BLOCK = 16;
+		const uint64_t PRIME_32 = 0x9e3779b1ull;
+
+		const uint64_t WIDE_SECRET[LANES] = {
+			0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+			0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull,
+		};
+
+		const uint64_t ACC_INIT[LANES] = {
+			0x00000000c2b2ae3dull, 0x9e3779b185ebca87ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull,
+			0x85ebca77c2b2ae63ull, 0x0000000085ebca77ull, 0x27d4eb2f165667c5ull, 0x000000009e3779b1ull,
+		};
+
+		/// The lane keys are the secret with the seed added to even and
+		/// subtracted from odd lanes.
+		inline void make_keys(uint64_t seed, uint64_t *key)
+		{
+			for (uint32_t i=0; i<LANES; ++i)
+				key[i] = i & 1 ? WIDE_SECRET[i] - seed : WIDE_SECRET[i] + seed;
+		}
+
+		inline void accumulate_scalar(uint64_t *acc, const unsigned char *p, const uint64_t *key)
+		{
+			for (uint32_t i=0; i<LANES; ++i) {
+				const uint64_t d = read_64(p + 8*i);
+				const uint64_t k = d ^ key[i];
+				acc[i ^ 1] += d;
+				acc[i] += (k & 0xffffffffull) * (k >> 32);
+			}
+		}
+
+		inline void scramble_scalar(uint64_t *acc, const uint64_t *key)
+		{
+			for (uint32_t i=0; i<LANES; ++i) {
+				uint64_t a = acc[i];
+				a ^= a >> 47;
+				a ^= key[i];
+				acc[i] = a * PRIME_32;
+			}
+		}
+
+		uint64_t merge(const uint64_t *acc, const uint64_t *key, uint32_t len, uint64_t seed)
+		{
+			uint64_t h = (len * 0x9e3779b97f4a7c15ull) ^ seed;
+			for (uint32_t i=0; i<LANES; i += 2)
+				h += mix(acc[i] ^ key[i], acc[i + 1] ^ key[i + 1]);
+			h ^= h >> 37;
+			h *= 0x165667919e3779f9ull;
+			h ^= h >> 32;
+			return h;
+		}
+
+		/// Number of full stripes before the last stripe. The last stripe is
+		/// always the final 64 bytes of the input (overlapping the previous
+		/// stripe if the length isn't a multiple of 64).
+		inline uint32_t num_stripes(uint32_t len)
+		{
+			return (len - 1) / STRIPE;
+		}
+	}
+
+	uint64_t wy_hash_64(const void *key, uint32_t len, uint64_t seed)
+	{
+		const unsigned char *p = (const unsigned char *)key;
+		seed ^= SECRET[0];
+		uint64_t a, b;
+		if (len <= 16) {
+			if (len >= 4) {
+				a = (read_32(p) << 32) | read_32(p + ((len >> 3) << 2));
+				b = (read_32(p + len - 4) << 32) | read_32(p + len - 4 - ((len >> 3) << 2));
+			} else if (len > 0) {
+				a = read_small(p, len);
+				b = 0;
+			} else
+				a = b = 0;
+		} else {
+			uint32_t i = len;
+			if (i > 48) {
+				uint64_t see1 = seed, see2 = seed;
+				do {
+					seed = mix(read_64(p) ^ SECRET[1], read_64(p + 8) ^ seed);
+					see1 = mix(read_64(p + 16) ^ SECRET[2], read_64(p + 24) ^ see1);
+					see2 = mix(read_64(p + 32) ^ SECRET[3], read_64(p + 40) ^ see2);
+					p += 48;
+					i -= 48;
+				} while (i > 48);
+				seed ^= see1 ^ see2;
+			}
+			while (i > 16) {
+				seed = mix(read_64(p) ^ SECRET[1], read_64(p + 8) ^ seed);
+				i -= 16;
+				p += 16;
+			}
+			a = read_64(p + i - 16);
+			b = read_64(p + i - 8);
+		}
+		a ^= SECRET[1];
+		b ^= seed;
+		multiply_128(a, b);
+		return mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
+	}
+
+	uint64_t wide_hash_64(const void *key, uint32_t len, uint64_t seed)
+	{
+		if (len < fast_hash_internal::WIDE_MIN_LENGTH)
+			return wy_hash_64(key, len, seed);
+	#if defined(FAST_HASH_AVX2)
+		static const bool avx2 = fast_hash_internal::has_avx2();
+		if (avx2)
+			return fast_hash_internal::wide_hash_64_avx2(key, len, seed);
+	#endif
+		return fast_hash_internal::wide_hash_64_sse2(key, len, seed);
+	}
+
+	namespace fast_hash_internal
+	{
+		uint64_t wide_hash_64_scalar(const void *key, uint32_t len, uint64_t seed)
+		{
+			const unsigned char *p = (const unsigned char *)key;
+			uint64_t k[LANES], acc[LANES];
+			make_keys(seed, k);
+			memcpy(acc, ACC_INIT, sizeof(acc));
+
+			const uint32_t stripes = num_stripes(len);
+			uint32_t s = 0;
+			for (; s + STRIPES_PER_BLOCK <= stripes; s += STRIPES_PER_BLOCK) {
+				for (uint32_t i=0; i<STRIPES_PER_BLOCK; ++i)
+					accumulate_scalar(acc, p + (s + i) * STRIPE, k);
+				scramble_scalar(acc, k);
+			}
+			for (; s < stripes; ++s)
+				accumulate_scalar(acc, p + s * STRIPE, k);
+			accumulate_scalar(acc, p + len - STRIPE, k);
+			return merge(acc, k, len, seed);
+		}
+
+	#if defined(FOUNDATION_SSE2)
+		inline void accumulate_sse2(__m128i *acc, const unsigned char *p, const __m128i *key)
+		{
+			for (uint32_t i=0; i<4; ++i) {
+				const __m128i d = _mm_loadu_si128((const __m128i *)(p + 16*i));
+				const __m128i x = _mm_xor_si128(d, key[i]);
+				const __m128i product = _mm_mul_epu32(x, _mm_srli_epi64(x, 32));
+				const __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+				acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, swapped));
+			}
+		}
+
+		inline void scramble_sse2(__m128i *acc, const __m128i *key)
+		{
+			const __m128i prime = _mm_set1_epi32((int)PRIME_32);
+			for (uint32_t i=0; i<4; ++i) {
+				__m128i x = _mm_xor_si128(acc[i], _mm_srli_epi64(acc[i], 47));
+				x = _mm_xor_si128(x, key[i]);
+				const __m128i lo = _mm_mul_epu32(x, prime);
+				const __m128i hi = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+				acc[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+			}
+		}
+
+		uint64_t wide_hash_64_sse2(const void *key, uint32_t len, uint64_t seed)
+		{
+			const unsigned char *p = (const unsigned char *)key;
+			__m128i a[4], kv[4];
+			const __m128i seeds = _mm_set_epi64x(-(int64_t)seed, (int64_t)seed);
+			for (uint32_t i=0; i<4; ++i) {
+				a[i] = _mm_loadu_si128((const __m128i *)(ACC_INIT + 2*i));
+				kv[i] = _mm_add_epi64(_mm_loadu_si128((const __m128i *)(WIDE_SECRET + 2*i)), seeds);
+			}
+
+			const uint32_t stripes = num_stripes(len);
+			uint32_t s = 0;
+			for (; s + STRIPES_PER_BLOCK <= stripes; s += STRIPES_PER_BLOCK) {
+				for (uint32_t i=0; i<STRIPES_PER_BLOCK; ++i)
+					accumulate_sse2(a, p + (s + i) * STRIPE, kv);
+				scramble_sse2(a, kv);
+			}
+			for (; s < stripes; ++s)
+				accumulate_sse2(a, p + s * STRIPE, kv);
+			accumulate_sse2(a, p + len - STRIPE, kv);
+
+			uint64_t acc[LANES], k[LANES];
+			for (uint32_t i=0; i<4; ++i) {
+				_mm_storeu_si128((__m128i *)(acc + 2*i), a[i]);
+				_mm_storeu_si128((__m128i *)(k + 2*i), kv[i]);
+			}
+			return merge(acc, k, len, seed);
+		}
+	#else
+		uint64_t wide_hash_64_sse2(const void *key, uint32_t len, uint64_t seed)
+		{
+			return wide_hash_64_scalar(key, len, seed);
+		}
+	#endif
+
+	#if defined(FAST_HASH_AVX2)
+		FAST_HASH_AVX2_TARGET inline void accumulate_avx2(__m256i *acc, const unsigned char *p, const __m256i *key)
+		{
+			for (uint32_t i=0; i<2; ++i) {
+				const __m256i d = _mm256_loadu_si256((const __m256i *)(p + 32*i));
+				const __m256i x = _mm256_xor_si256(d, key[i]);
+				const __m256i product = _mm256_mul_epu32(x, _mm256_srli_epi64(x, 32));
+				const __m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+				acc[i] = _mm256_add_epi64(acc[i], _mm256_add_epi64(product, swapped));
+			}
+		}
+
+		FAST_HASH_AVX2_TARGET inline void scramble_avx2(__m256i *acc, const __m256i *key)
+		{
+			const __m256i prime = _mm256_set1_epi32((int)PRIME_32);
+			for (uint32_t i=0; i<2; ++i) {
+				__m256i x = _mm256_xor_si256(acc[i], _mm256_srli_epi64(acc[i], 47));
+				x = _mm256_xor_si256(x, key[i]);
+				const __m256i lo = _mm256_mul_epu32(x, prime);
+				const __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+				acc[i] = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+			}
+		}
+
+		// Kept separate from wide_hash_64_avx2() so that no AVX2 instructions
+		// run before the CPU check.
+		static FAST_HASH_AVX2_TARGET uint64_t wide_avx2(const void *key, uint32_t len, uint64_t seed)
+		{
+			const unsigned char *p = (const unsigned char *)key;
+			__m256i a[2], kv[2];
+			const __m256i seeds = _mm256_set_epi64x(-(int64_t)seed, (int64_t)seed, -(int64_t)seed, (int64_t)seed);
+			for (uint32_t i=0; i<2; ++i) {
+				a[i] = _mm256_loadu_si256((const __m256i *)(ACC_INIT + 4*i));
+				kv[i] = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(WIDE_SECRET + 4*i)), seeds);
+			}
+
+			const uint32_t stripes = num_stripes(len);
+			uint32_t s = 0;
+			for (; s + STRIPES_PER_BLOCK <= stripes; s += STRIPES_PER_BLOCK) {
+				for (uint32_t i=0; i<STRIPES_PER_BLOCK; ++i)
+					accumulate_avx2(a, p + (s + i) * STRIPE, kv);
+				scramble_avx2(a, kv);
+			}
+			for (; s < stripes; ++s)
+				accumulate_avx2(a, p + s * STRIPE, kv);
+			accumulate_avx2(a, p + len - STRIPE, kv);
+
+			uint64_t acc[LANES], k[LANES];
+			for (uint32_t i=0; i<2; ++i) {
+				_mm256_storeu_si256((__m256i *)(acc + 4*i), a[i]);
+				_mm256_storeu_si256((__m256i *)(k + 4*i), kv[i]);
+			}
+			return merge(acc, k, len, seed);
+		}
+
+		uint64_t wide_hash_64_avx2(const void *key, uint32_t len, uint64_t seed)
+		{
+			if (!has_avx2())
+				return wide_hash_64_scalar(key, len, seed);
+			return wide_avx2(key, len, seed);
+		}
+
+		bool has_avx2()
+		{
+		#if defined(__GNUC__)
+			return __builtin_cpu_supports("avx2");
+		#else
+			return true;
+		#endif
+		}
+	#else
+		uint64_t wide_hash_64_avx2(const void *key, uint32_t len, uint64_t seed)
+		{
+			return wide_hash_64_scalar(key, len, seed);
+		}
+
+		bool has_avx2()
+		{
+			return false;
+		}
+	#endif
+	}
+}
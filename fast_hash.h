@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types.h"
+
+namespace foundation
+{
+	/// Alternatives to murmur_hash_64() with the same signature. They give
+	/// different hash values than murmur_hash_64(), so don't mix them for the
+	/// same keys (or in stored data).
+
+	/// A wyhash style hash: short keys (up to 16 bytes) are read with at most
+	/// four overlapping loads instead of a byte by byte tail, and each 16 byte
+	/// block is mixed with a single 64x64->128 bit multiply. Fastest for short
+	/// keys.
+	uint64_t wy_hash_64(const void *key, uint32_t len, uint64_t seed);
+
+	/// An xxh3 style hash for long inputs: eight independent 64 bit lanes
+	/// accumulate 32x32->64 bit products of each 64 byte stripe, which maps
+	/// directly to SSE2 and AVX2 multiplies. The SIMD path is chosen at run
+	/// time depending on the CPU. Inputs shorter than 256 bytes are hashed
+	/// with wy_hash_64(). All paths give the same result.
+	uint64_t wide_hash_64(const void *key, uint32_t len, uint64_t seed);
+
+	namespace fast_hash_internal
+	{
+		const uint32_t WIDE_MIN_LENGTH = 256;
+
+		/// The wide hash for inputs of at least WIDE_MIN_LENGTH bytes, with each
+		/// of the implementations. They are exposed for testing. The SSE2 and
+		/// AVX2 versions fall back to the scalar version if they are not
+		/// available for the compiler or the CPU.
+		uint64_t wide_hash_64_scalar(const void *key, uint32_t len, uint64_t seed);
+		uint64_t wide_hash_64_sse2(const void *key, uint32_t len, uint64_t seed);
+		uint64_t wide_hash_64_avx2(const void *key, uint32_t len, uint64_t seed);
+
+		/// Returns true if the CPU supports AVX2 and the AVX2 path was compiled.
+		bool has_avx2();
+	}
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "array.h"
+#include "collection_types.h"
+#include "simd.h"
+
+#include <assert.h>
+
+namespace foundation {
+
+	/// The flat hash stores its entries directly in a power-of-two sized slot
+	/// array. A parallel array holds one control byte per slot: EMPTY, DELETED
+	/// or 7 bits of the key hash. Lookups compare the 7 bit tag against a whole
+	/// group of 16 control bytes at once and only load the entries that match.
+	///
+	/// The interface matches the regular hash, but there is no multi_hash
+	/// interface and no begin()/end() iteration.
+
+	namespace hash
+	{
+		/// Returns true if the specified key exists in the hash.
+		template<typename T> bool has(const FlatHash<T> &h, uint64_t key);
+
+		/// Returns the value stored for the specified key, or deffault if the key
+		/// does not exist in the hash.
+		template<typename T> const T &get(const FlatHash<T> &h, uint64_t key, const T &deffault);
+
+		/// Sets the value for the key.
+		template<typename T> void set(FlatHash<T> &h, uint64_t key, const T &value);
+
+		/// Removes the key from the hash if it exists.
+		template<typename T> void remove(FlatHash<T> &h, uint64_t key);
+
+		/// Makes room for at least size items without growing.
+		/// (The table grows automatically when 7/8 of the slots are used.)
+		/// The table can hold at most flat_hash_internal::MAX_SIZE items.
+		template<typename T> void reserve(FlatHash<T> &h, uint32_t size);
+
+		/// Remove all elements from the hash.
+		template<typename T> void clear(FlatHash<T> &h);
+	}
+
+	namespace flat_hash_internal
+	{
+		const uint32_t GROUP_SIZE = 16;
+		const uint8_t EMPTY = 0x80;
+		const uint8_t DELETED = 0xfe;
+		const uint32_t NOT_FOUND = 0xffffffffu;
+
+		/// The most items a table can hold: 7/8 of the largest power of two
+		/// number of slots that fits in an uint32_t.
+		const uint32_t MAX_SIZE = (1u << 31) - (1u << 28);
+
+		/// Mixes the key so that both the low bits (used to pick the group) and
+		/// the tag bits depend on all the bits of the key.
+		inline uint64_t mix(uint64_t key)
+		{
+			uint64_t h = key * 0x9e3779b97f4a7c15ull;
+			return h ^ (h >> 32);
+		}
+
+		inline uint32_t group_index(uint64_t h, uint32_t num_groups) {return uint32_t(h >> 7) & (num_groups - 1);}
+		inline uint8_t tag(uint64_t h) {return uint8_t(h & 0x7f);}
+
+		/// Returns a bit mask with a bit set for each control byte in the group
+		/// that is equal to c.
+		inline uint32_t match(const uint8_t *group, uint8_t c)
+		{
+		#if defined(FOUNDATION_SSE2)
+			const __m128i g = _mm_loadu_si128((const __m128i *)group);
+			return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)c))));
+		#else
+			uint32_t mask = 0;
+			for (uint32_t i=0; i<GROUP_SIZE; ++i)
+				mask |= uint32_t(group[i] == c) << i;
+			return mask;
+		#endif
+		}
+
+		/// Returns a bit mask of the EMPTY or DELETED control bytes in the group.
+		inline uint32_t match_free(const uint8_t *group)
+		{
+		#if defined(FOUNDATION_SSE2)
+			// EMPTY and DELETED are the only control bytes with the high bit set.
+			return uint32_t(_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group)));
+		#else
+			uint32_t mask = 0;
+			for (uint32_t i=0; i<GROUP_SIZE; ++i)
+				mask |= uint32_t(group[i] >> 7) << i;
+			return mask;
+		#endif
+		}
+
+
+		template<typename T> inline uint32_t num_groups(const FlatHash<T> &h)
+		{
+			return array::size(h._ctrl) / GROUP_SIZE;
+		}
+
+		/// Returns the slot index of the key or NOT_FOUND. The groups are probed
+		/// with a triangular sequence, which visits every group when the number
+		/// of groups is a power of two. Probing stops at the first group with an
+		/// EMPTY slot.
+		template<typename T> uint32_t find(const FlatHash<T> &h, uint64_t key)
+		{
+			const uint32_t n = num_groups(h);
+			if (n == 0)
+				return NOT_FOUND;
+
+			const uint64_t hv = mix(key);
+			const uint8_t t = tag(hv);
+			uint32_t g = group_index(hv, n);
+			for (uint32_t step = 1; step <= n; ++step) {
+				const uint8_t *group = array::begin(h._ctrl) + g * GROUP_SIZE;
+				uint32_t m = match(group, t);
+				while (m) {
+					const uint32_t i = g * GROUP_SIZE + simd_internal::lowest_bit(m);
+					if (h._data[i].key == key)
+						return i;
+					m &= m - 1;
+				}
+				if (match(group, EMPTY))
+					return NOT_FOUND;
+				g = (g + step) & (n - 1);
+			}
+			return NOT_FOUND;
+		}
+
+		/// Returns the first free slot on the probe sequence of the key. The
+		/// hash must have at least one free slot.
+		template<typename T> uint32_t find_free(const FlatHash<T> &h, uint64_t hv)
+		{
+			const uint32_t n = num_groups(h);
+			uint32_t g = group_index(hv, n);
+			for (uint32_t step = 1; ; ++step) {
+				const uint32_t m = match_free(array::begin(h._ctrl) + g * GROUP_SIZE);
+				if (m)
+					return g * GROUP_SIZE + simd_internal::lowest_bit(m);
+				g = (g + step) & (n - 1);
+			}
+		}
+
+		template<typename T> void rehash(FlatHash<T> &h, uint32_t new_slots)
+		{
+			FlatHash<T> nh(*h._data._allocator);
+			array::resize(nh._ctrl, new_slots);
+			array::resize(nh._data, new_slots);
+			memset(array::begin(nh._ctrl), EMPTY, new_slots);
+
+			for (uint32_t i=0; i<array::size(h._ctrl); ++i) {
+				if (h._ctrl[i] & 0x80)
+					continue;
+				const uint64_t hv = mix(h._data[i].key);
+				const uint32_t j = find_free(nh, hv);
+				nh._ctrl[j] = tag(hv);
+				nh._data[j] = h._data[i];
+			}
+			nh._size = h._size;
+
+			FlatHash<T> empty(*h._data._allocator);
+			h.~FlatHash<T>();
+			memcpy((void *)&h, (const void *)&nh, sizeof(FlatHash<T>));
+			memcpy((void *)&nh, (const void *)&empty, sizeof(FlatHash<T>));
+		}
+
+		/// Returns the number of slots needed to hold size items.
+		inline uint32_t slots_for(uint32_t size)
+		{
+			assert(size <= MAX_SIZE);
+			uint32_t slots = GROUP_SIZE;
+			while (slots - slots / 8 < size)
+				slots *= 2;
+			return slots;
+		}
+
+		template<typename T> bool full(const FlatHash<T> &h)
+		{
+			const uint32_t slots = array::size(h._ctrl);
+			return h._size + h._deleted >= slots - slots / 8;
+		}
+
+		template<typename T> void grow(FlatHash<T> &h)
+		{
+			// If most of the used slots are tombstones, rehashing at the same
+			// size is enough to reclaim them.
+			const uint32_t slots = array::size(h._ctrl);
+			if (slots && h._deleted >= h._size)
+				rehash(h, slots);
+			else {
+				assert(h._size < MAX_SIZE);
+				rehash(h, slots_for(h._size < MAX_SIZE / 2 ? h._size * 2 + 1 : MAX_SIZE));
+			}
+		}
+	}
+
+	namespace hash
+	{
+		template<typename T> bool has(const FlatHash<T> &h, uint64_t key)
+		{
+			return flat_hash_internal::find(h, key) != flat_hash_internal::NOT_FOUND;
+		}
+
+		template<typename T> const T &get(const FlatHash<T> &h, uint64_t key, const T &deffault)
+		{
+			const uint32_t i = flat_hash_internal::find(h, key);
+			return i == flat_hash_internal::NOT_FOUND ? deffault : h._data[i].value;
+		}
+
+		template<typename T> void set(FlatHash<T> &h, uint64_t key, const T &value)
+		{
+			uint32_t i = flat_hash_internal::find(h, key);
+			if (i != flat_hash_internal::NOT_FOUND) {
+				h._data[i].value = value;
+				return;
+			}
+
+			if (array::size(h._ctrl) == 0 || flat_hash_internal::full(h))
+				flat_hash_internal::grow(h);
+
+			const uint64_t hv = flat_hash_internal::mix(key);
+			i = flat_hash_internal::find_free(h, hv);
+			if (h._ctrl[i] == flat_hash_internal::DELETED)
+				--h._deleted;
+			h._ctrl[i] = flat_hash_internal::tag(hv);
+			h._data[i].key = key;
+			h._data[i].value = value;
+			++h._size;
+		}
+
+		template<typename T> void remove(FlatHash<T> &h, uint64_t key)
+		{
+			const uint32_t i = flat_hash_internal::find(h, key);
+			if (i == flat_hash_internal::NOT_FOUND)
+				return;
+
+			// If the group has an EMPTY slot, no probe sequence continues past
+			// it and the slot can be marked EMPTY instead of leaving a tombstone.
+			const uint8_t *group = array::begin(h._ctrl) + (i & ~(flat_hash_internal::GROUP_SIZE - 1));
+			if (flat_hash_internal::match(group, flat_hash_internal::EMPTY))
+				h._ctrl[i] = flat_hash_internal::EMPTY;
+			else {
+				h._ctrl[i] = flat_hash_internal::DELETED;
+				++h._deleted;
+			}
+			--h._size;
+		}
+
+		template<typename T> void reserve(FlatHash<T> &h, uint32_t size)
+		{
+			const uint32_t slots = flat_hash_internal::slots_for(size);
+			if (slots > array::size(h._ctrl))
+				flat_hash_internal::rehash(h, slots);
+		}
+
+		template<typename T> void clear(FlatHash<T> &h)
+		{
+			if (array::size(h._ctrl))
+				memset(array::begin(h._ctrl), flat_hash_internal::EMPTY, array::size(h._ctrl));
+			h._size = 0;
+			h._deleted = 0;
+		}
+	}
+
+	template <typename T> FlatHash<T>::FlatHash(Allocator &a) :
+		_size(0), _deleted(0), _ctrl(a), _data(a)
+	{}
+}
@@ -0,0 +1,387 @@
+#pragma once
+
+#include "array.h"
+#include "collection_types.h"
+#include "hash.h"
+
+namespace foundation {
+
+	/// The frozen hash uses the "hash and displace" (CHD) minimal perfect
+	/// hashing scheme. The keys are first hashed to a small number of buckets
+	/// (about four keys per bucket). For each bucket a displacement is stored
+	/// that, combined with the key, maps each key of the bucket to its own slot.
+	/// The n keys map to exactly n slots, so a lookup is one displacement read,
+	/// one key compare and one value read.
+	///
+	/// The data block contains a header, the displacements and the entries
+	/// (key and value pairs). It only uses offsets, so it can be copied or memory mapped to
+	/// any (8 byte aligned) address.
+
+	namespace hash
+	{
+		/// Returns true if the specified key exists in the hash.
+		template<typename T> bool has(const FrozenHash<T> &h, uint64_t key);
+
+		/// Returns the value stored for the specified key, or deffault if the key
+		/// does not exist in the hash.
+		template<typename T> const T &get(const FrozenHash<T> &h, uint64_t key, const T &deffault);
+	}
+
+	namespace frozen_hash
+	{
+		/// Builds the frozen hash from the entries of a hash. Returns false if the
+		/// hash contains duplicate keys (i.e. has been used as a multi_hash).
+		template<typename T> bool build(FrozenHash<T> &fh, const Hash<T> &h);
+
+		/// Builds the frozen hash from n keys and values. Returns false if there
+		/// are duplicate keys.
+		template<typename T> bool build(FrozenHash<T> &fh, const uint64_t *keys, const T *values, uint32_t n);
+
+		/// Uses the data block at data (of the specified size) for the hash,
+		/// for example a block previously written to a file and now memory
+		/// mapped. The memory is not copied and must outlive the hash. Returns
+		/// false if the data is not a valid frozen hash for T. The header and
+		/// all the displacements are checked, so that lookups in truncated or
+		/// corrupt data stay within the block.
+		template<typename T> bool attach(FrozenHash<T> &fh, const void *data, uint32_t size);
+
+		/// Returns the data block of the hash and its size in bytes.
+		template<typename T> const void *data(const FrozenHash<T> &fh);
+		template<typename T> uint32_t data_size(const FrozenHash<T> &fh);
+
+		/// Returns the number of entries in the hash.
+		template<typename T> uint32_t size(const FrozenHash<T> &fh);
+	}
+
+	namespace frozen_hash_internal
+	{
+		const uint32_t MAGIC = 0x487a7246;	// "FrzH"
+		const uint32_t VERSION = 1;
+		const uint32_t KEYS_PER_BUCKET = 4;
+
+		/// Displacements with this bit set store the slot of a single key bucket
+		/// directly.
+		const uint32_t DIRECT_SLOT = 0x80000000u;
+
+		/// Maximum number of displacements tried for a bucket.
+		const uint32_t MAX_ATTEMPTS = 1 << 20;
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t value_size;
+			uint32_t total_size;
+			uint32_t num_keys;
+			uint32_t num_buckets;
+			uint32_t entries_offset;
+			uint32_t entry_size;
+			uint64_t seed;
+		};
+
+		template<typename T> struct Entry
+		{
+			uint64_t key;
+			T value;
+		};
+
+		inline uint64_t mix(uint64_t k)
+		{
+			k ^= k >> 33;
+			k *= 0xff51afd7ed558ccdull;
+			k ^= k >> 33;
+			k *= 0xc4ceb9fe1a85ec53ull;
+			k ^= k >> 33;
+			return k;
+		}
+
+		/// Maps the high 32 bits of h to [0, n) without a division.
+		inline uint32_t range(uint64_t h, uint32_t n)
+		{
+			return uint32_t(((h >> 32) * n) >> 32);
+		}
+
+		/// The key is hashed once. The high bits of the hash select the bucket
+		/// and the displacement is mixed with the hash to select the slot.
+		inline uint64_t key_hash(uint64_t key, uint64_t seed) {return mix(key ^ seed);}
+		inline uint32_t bucket(uint64_t h, uint32_t num_buckets) {return range(h, num_buckets);}
+
+		inline uint32_t slot(uint64_t h, uint32_t displacement, uint32_t num_keys)
+		{
+			if (displacement & DIRECT_SLOT)
+				return displacement & ~DIRECT_SLOT;
+			return range((h ^ ((displacement + 1) * 0x9e3779b97f4a7c15ull)) * 0xbf58476d1ce4e5b9ull, num_keys);
+		}
+
+		inline uint32_t align_up(uint32_t offset, uint32_t align)
+		{
+			return (offset + align - 1) / align * align;
+		}
+
+		inline const Header &header(const char *data) {return *(const Header *)data;}
+		inline const uint32_t *displacements(const char *data) {return (const uint32_t *)(data + sizeof(Header));}
+		template<typename T> inline const Entry<T> *entries(const char *data) {return (const Entry<T> *)(data + header(data).entries_offset);}
+
+		/// Returns the slot of the key, or num_keys if the key is not in the hash.
+		template<typename T> uint32_t find(const FrozenHash<T> &fh, uint64_t key)
+		{
+			if (!fh._data)
+				return 0;
+			const Header &h = header(fh._data);
+			if (h.num_keys == 0)
+				return 0;
+			const uint64_t kh = key_hash(key, h.seed);
+			const uint32_t d = displacements(fh._data)[bucket(kh, h.num_buckets)];
+			const uint32_t i = slot(kh, d, h.num_keys);
+			return entries<T>(fh._data)[i].key == key ? i : h.num_keys;
+		}
+
+		/// Tries to find displacements for all buckets with the specified seed,
+		/// filling in slot_key with the index of the key stored in each slot.
+		/// Returns false if some bucket couldn't be placed.
+		template<typename T> bool place(FrozenHash<T> &fh, const uint64_t *keys, uint32_t n, uint64_t seed,
+			uint32_t num_buckets, uint32_t *displacement, uint32_t *slot_key)
+		{
+			Allocator &a = *fh._allocator;
+
+			Array<uint64_t> hashes(a);
+			array::resize(hashes, n);
+			for (uint32_t i=0; i<n; ++i)
+				hashes[i] = key_hash(keys[i], seed);
+
+			// Sort the keys by bucket (counting sort).
+			Array<uint32_t> bucket_start(a);
+			array::resize(bucket_start, num_buckets + 1);
+			memset(array::begin(bucket_start), 0, (num_buckets + 1) * sizeof(uint32_t));
+			for (uint32_t i=0; i<n; ++i)
+				++bucket_start[bucket(hashes[i], num_buckets) + 1];
+			uint32_t max_bucket_size = 0;
+			for (uint32_t b=0; b<num_buckets; ++b) {
+				if (bucket_start[b + 1] > max_bucket_size)
+					max_bucket_size = bucket_start[b + 1];
+				bucket_start[b + 1] += bucket_start[b];
+			}
+			if (max_bucket_size > 64)
+				return false;
+			Array<uint32_t> sorted(a);
+			array::resize(sorted, n);
+			{
+				Array<uint32_t> fill(bucket_start);
+				for (uint32_t i=0; i<n; ++i)
+					sorted[fill[bucket(hashes[i], num_buckets)]++] = i;
+			}
+
+			// Sort the buckets by size, largest first (counting sort again).
+			Array<uint32_t> size_start(a);
+			array::resize(size_start, max_bucket_size + 2);
+			memset(array::begin(size_start), 0, (max_bucket_size + 2) * sizeof(uint32_t));
+			for (uint32_t b=0; b<num_buckets; ++b)
+				++size_start[max_bucket_size - (bucket_start[b + 1] - bucket_start[b]) + 1];
+			for (uint32_t s=0; s<=max_bucket_size; ++s)
+				size_start[s + 1] += size_start[s];
+			Array<uint32_t> order(a);
+			array::resize(order, num_buckets);
+			for (uint32_t b=0; b<num_buckets; ++b)
+				order[size_start[max_bucket_size - (bucket_start[b + 1] - bucket_start[b])]++] = b;
+
+			// Used slots are tracked in a bit set, which is much smaller than
+			// slot_key and keeps the displacement search in cache.
+			Array<uint64_t> used(a);
+			array::resize(used, n / 64 + 1);
+			memset(array::begin(used), 0, array::size(used) * sizeof(uint64_t));
+
+			uint64_t bucket_hashes[64];
+			uint32_t slots[64];
+			uint32_t next_free = 0;
+			for (uint32_t o=0; o<num_buckets; ++o) {
+				const uint32_t b = order[o];
+				const uint32_t begin = bucket_start[b];
+				const uint32_t count = bucket_start[b + 1] - begin;
+				displacement[b] = 0;
+				if (count == 0)
+					continue;
+
+				// Single key buckets are placed last and take any free slot.
+				if (count == 1) {
+					while (used[next_free / 64] & (1ull << (next_free % 64)))
+						++next_free;
+					used[next_free / 64] |= 1ull << (next_free % 64);
+					slot_key[next_free] = sorted[begin];
+					displacement[b] = DIRECT_SLOT | next_free;
+					continue;
+				}
+
+				// The key hash is a bijection, so equal hashes means duplicate
+				// keys that can never be placed.
+				for (uint32_t k=0; k<count; ++k) {
+					bucket_hashes[k] = hashes[sorted[begin + k]];
+					for (uint32_t j=0; j<k; ++j)
+						if (bucket_hashes[j] == bucket_hashes[k])
+							return false;
+				}
+
+				bool placed = false;
+				for (uint32_t d=0; d<MAX_ATTEMPTS && !placed; ++d) {
+					placed = true;
+					for (uint32_t k=0; k<count && placed; ++k) {
+						const uint32_t s = slot(bucket_hashes[k], d, n);
+						placed = !(used[s / 64] & (1ull << (s % 64)));
+						for (uint32_t j=0; j<k && placed; ++j)
+							placed = slots[j] != s;
+						slots[k] = s;
+					}
+					if (placed) {
+						displacement[b] = d;
+						for (uint32_t k=0; k<count; ++k) {
+							used[slots[k] / 64] |= 1ull << (slots[k] % 64);
+							slot_key[slots[k]] = sorted[begin + k];
+						}
+					}
+				}
+				if (!placed)
+					return false;
+			}
+			return true;
+		}
+	}
+
+	namespace hash
+	{
+		template<typename T> bool has(const FrozenHash<T> &h, uint64_t key)
+		{
+			return h._data && frozen_hash_internal::find(h, key) != frozen_hash_internal::header(h._data).num_keys;
+		}
+
+		template<typename T> const T &get(const FrozenHash<T> &h, uint64_t key, const T &deffault)
+		{
+			if (!h._data)
+				return deffault;
+			const uint32_t i = frozen_hash_internal::find(h, key);
+			return i == frozen_hash_internal::header(h._data).num_keys ? deffault : frozen_hash_internal::entries<T>(h._data)[i].value;
+		}
+	}
+
+	namespace frozen_hash
+	{
+		template<typename T> bool build(FrozenHash<T> &fh, const Hash<T> &h)
+		{
+			Array<uint64_t> keys(*fh._allocator);
+			Array<T> values(*fh._allocator);
+			const uint32_t n = hash::end(h) - hash::begin(h);
+			array::resize(keys, n);
+			array::resize(values, n);
+			for (uint32_t i=0; i<n; ++i) {
+				keys[i] = hash::begin(h)[i].key;
+				values[i] = hash::begin(h)[i].value;
+			}
+			return build(fh, array::begin(keys), array::begin(values), n);
+		}
+
+		template<typename T> bool build(FrozenHash<T> &fh, const uint64_t *keys, const T *values, uint32_t n)
+		{
+			using namespace frozen_hash_internal;
+			Allocator &a = *fh._allocator;
+
+			const uint32_t num_buckets = n / KEYS_PER_BUCKET + 1;
+			const uint32_t align = alignof(Entry<T>) > 16 ? alignof(Entry<T>) : 16;
+			const uint32_t entries_offset = align_up(sizeof(Header) + num_buckets * sizeof(uint32_t), alignof(Entry<T>));
+			const uint32_t total_size = entries_offset + n * sizeof(Entry<T>);
+
+			Array<uint32_t> displacement(a);
+			Array<uint32_t> slot_key(a);
+			array::resize(displacement, num_buckets);
+			array::resize(slot_key, n);
+
+			// Retry with new seeds if the displacement search fails. With four
+			// keys per bucket this is very rare.
+			uint64_t seed = 0x2545f4914f6cdd1dull;
+			bool placed = false;
+			for (uint32_t attempt = 0; attempt < 8 && !placed; ++attempt) {
+				seed = mix(seed + attempt);
+				placed = place(fh, keys, n, seed, num_buckets, array::begin(displacement), array::begin(slot_key));
+			}
+			if (!placed)
+				return false;
+
+			char *data = (char *)a.allocate(total_size, align);
+			memset(data, 0, total_size);
+			Header &h = *(Header *)data;
+			h.magic = MAGIC;
+			h.version = VERSION;
+			h.value_size = sizeof(T);
+			h.total_size = total_size;
+			h.num_keys = n;
+			h.num_buckets = num_buckets;
+			h.entries_offset = entries_offset;
+			h.entry_size = sizeof(Entry<T>);
+			h.seed = seed;
+			memcpy(data + sizeof(Header), array::begin(displacement), num_buckets * sizeof(uint32_t));
+			Entry<T> *e = (Entry<T> *)(data + entries_offset);
+			for (uint32_t i=0; i<n; ++i) {
+				e[i].key = keys[slot_key[i]];
+				e[i].value = values[slot_key[i]];
+			}
+
+			a.deallocate(fh._owned);
+			fh._owned = data;
+			fh._data = data;
+			return true;
+		}
+
+		template<typename T> bool attach(FrozenHash<T> &fh, const void *data, uint32_t size)
+		{
+			using namespace frozen_hash_internal;
+			if (size < sizeof(Header) || uintptr_t(data) % 8 != 0)
+				return false;
+			const Header &h = *(const Header *)data;
+			if (h.magic != MAGIC || h.version != VERSION || h.value_size != sizeof(T) || h.total_size > size)
+				return false;
+			if (h.entry_size != sizeof(Entry<T>) || h.entries_offset % alignof(Entry<T>) != 0)
+				return false;
+
+			// The displacements and the entries must fit in the block, in that
+			// order.
+			if (h.num_buckets == 0 || sizeof(Header) + uint64_t(h.num_buckets) * sizeof(uint32_t) > h.entries_offset)
+				return false;
+			if (h.entries_offset + uint64_t(h.num_keys) * h.entry_size > h.total_size)
+				return false;
+
+			// Hashed slots are always below num_keys, direct slots must be
+			// checked.
+			const uint32_t *d = displacements((const char *)data);
+			for (uint32_t b=0; b<h.num_buckets; ++b) {
+				if (d[b] & DIRECT_SLOT ? (d[b] & ~DIRECT_SLOT) >= h.num_keys : d[b] >= MAX_ATTEMPTS)
+					return false;
+			}
+
+			fh._allocator->deallocate(fh._owned);
+			fh._owned = 0;
+			fh._data = (const char *)data;
+			return true;
+		}
+
+		template<typename T> inline const void *data(const FrozenHash<T> &fh)
+		{
+			return fh._data;
+		}
+
+		template<typename T> inline uint32_t data_size(const FrozenHash<T> &fh)
+		{
+			return fh._data ? frozen_hash_internal::header(fh._data).total_size : 0;
+		}
+
+		template<typename T> inline uint32_t size(const FrozenHash<T> &fh)
+		{
+			return fh._data ? frozen_hash_internal::header(fh._data).num_keys : 0;
+		}
+	}
+
+	template <typename T> FrozenHash<T>::FrozenHash(Allocator &a) :
+		_allocator(&a), _owned(0), _data(0)
+	{}
+
+	template <typename T> FrozenHash<T>::~FrozenHash()
+	{
+		_allocator->deallocate(_owned);
+	}
+}
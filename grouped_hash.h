@@ -0,0 +1,246 @@
+#pragma once
+
+#include "array.h"
+#include "collection_types.h"
+#include "hash.h"
+
+namespace foundation {
+
+	/// The grouped hash is a multi-map where each key owns a contiguous span of
+	/// the _values array. A regular Hash maps the key to its span, so all the
+	/// values of a key are found with a single lookup, and removing a key just
+	/// abandons its span.
+	///
+	/// Spans are allocated with room to grow. When a span is full it is moved
+	/// to the end of _values with twice the capacity (unless it already is at
+	/// the end, then it grows in place). Abandoned spans are counted as
+	/// garbage and _values is compacted when more than half of it is garbage.
+	///
+	/// Pointers returned by grouped_hash::get() are invalidated by any
+	/// modification of the hash.
+
+	namespace hash
+	{
+		/// Returns true if there are values for the specified key.
+		template<typename T> bool has(const GroupedHash<T> &h, uint64_t key);
+
+		/// Makes room for the specified number of keys.
+		template<typename T> void reserve(GroupedHash<T> &h, uint32_t size);
+
+		/// Remove all elements from the hash.
+		template<typename T> void clear(GroupedHash<T> &h);
+	}
+
+	namespace grouped_hash
+	{
+		/// Returns the values for the key. The number of values is stored in
+		/// count. Returns 0 (and sets count to 0) if the key has no values.
+		template<typename T> const T *get(const GroupedHash<T> &h, uint64_t key, uint32_t *count);
+
+		/// Returns the number of values for the key.
+		template<typename T> uint32_t count(const GroupedHash<T> &h, uint64_t key);
+
+		/// Appends the value to the values of the key.
+		template<typename T> void insert(GroupedHash<T> &h, uint64_t key, const T &value);
+
+		/// Appends n values to the values of the key.
+		template<typename T> void insert(GroupedHash<T> &h, uint64_t key, const T *values, uint32_t n);
+
+		/// Removes the value with index i in the span of the key. The last
+		/// value of the span is moved into its place.
+		template<typename T> void remove(GroupedHash<T> &h, uint64_t key, uint32_t i);
+
+		/// Removes all values for the key.
+		template<typename T> void remove_all(GroupedHash<T> &h, uint64_t key);
+
+		/// Returns the number of keys with values.
+		template<typename T> uint32_t num_keys(const GroupedHash<T> &h);
+
+		/// Returns the total number of values.
+		template<typename T> uint32_t size(const GroupedHash<T> &h);
+
+		/// Moves all the spans together at the start of _values, removing the
+		/// unused capacity.
+		template<typename T> void compact(GroupedHash<T> &h);
+	}
+
+	namespace grouped_hash_internal
+	{
+		const uint32_t MIN_CAPACITY = 4;
+		const uint32_t MIN_GARBAGE = 1024;
+
+		template<typename T> typename GroupedHash<T>::Group *group(GroupedHash<T> &h, uint64_t key)
+		{
+			const uint32_t i = hash_internal::find_or_fail(h._groups, key);
+			return i == hash_internal::END_OF_LIST ? 0 : &h._groups._data[i].value;
+		}
+
+		template<typename T> const typename GroupedHash<T>::Group *group(const GroupedHash<T> &h, uint64_t key)
+		{
+			const uint32_t i = hash_internal::find_or_fail(h._groups, key);
+			return i == hash_internal::END_OF_LIST ? 0 : &h._groups._data[i].value;
+		}
+
+		/// Compacts the values if more than half of them are garbage.
+		template<typename T> void collect(GroupedHash<T> &h)
+		{
+			if (h._garbage > MIN_GARBAGE && h._garbage > array::size(h._values) / 2)
+				grouped_hash::compact(h);
+		}
+
+		/// Makes room for n more values in the span of the key and returns the
+		/// index in _values where they should be written.
+		template<typename T> uint32_t append(GroupedHash<T> &h, uint64_t key, uint32_t n)
+		{
+			collect(h);
+
+			typename GroupedHash<T>::Group *g = group(h, key);
+			if (!g) {
+				typename GroupedHash<T>::Group ng;
+				ng.offset = array::size(h._values);
+				ng.size = 0;
+				ng.capacity = 0;
+				hash::set(h._groups, key, ng);
+				g = group(h, key);
+			}
+
+			const uint32_t needed = g->size + n;
+			if (needed > g->capacity) {
+				uint32_t capacity = g->capacity * 2;
+				if (capacity < needed)
+					capacity = needed;
+				if (capacity < MIN_CAPACITY)
+					capacity = MIN_CAPACITY;
+
+				const uint32_t end = array::size(h._values);
+				if (g->offset + g->capacity == end)
+					array::resize(h._values, g->offset + capacity);
+				else {
+					array::resize(h._values, end + capacity);
+					memcpy((void *)&h._values[end], (const void *)&h._values[g->offset], g->size * sizeof(T));
+					h._garbage += g->capacity;
+					g->offset = end;
+				}
+				g->capacity = capacity;
+			}
+
+			const uint32_t i = g->offset + g->size;
+			g->size += n;
+			h._size += n;
+			return i;
+		}
+	}
+
+	namespace hash
+	{
+		template<typename T> bool has(const GroupedHash<T> &h, uint64_t key)
+		{
+			return hash::has(h._groups, key);
+		}
+
+		template<typename T> void reserve(GroupedHash<T> &h, uint32_t size)
+		{
+			hash::reserve(h._groups, size);
+		}
+
+		template<typename T> void clear(GroupedHash<T> &h)
+		{
+			hash::clear(h._groups);
+			array::clear(h._values);
+			h._size = 0;
+			h._garbage = 0;
+		}
+	}
+
+	namespace grouped_hash
+	{
+		template<typename T> const T *get(const GroupedHash<T> &h, uint64_t key, uint32_t *count)
+		{
+			const typename GroupedHash<T>::Group *g = grouped_hash_internal::group(h, key);
+			*count = g ? g->size : 0;
+			return g ? array::begin(h._values) + g->offset : 0;
+		}
+
+		template<typename T> uint32_t count(const GroupedHash<T> &h, uint64_t key)
+		{
+			const typename GroupedHash<T>::Group *g = grouped_hash_internal::group(h, key);
+			return g ? g->size : 0;
+		}
+
+		template<typename T> void insert(GroupedHash<T> &h, uint64_t key, const T &value)
+		{
+			const uint32_t i = grouped_hash_internal::append(h, key, 1);
+			h._values[i] = value;
+		}
+
+		template<typename T> void insert(GroupedHash<T> &h, uint64_t key, const T *values, uint32_t n)
+		{
+			if (n == 0)
+				return;
+			const uint32_t i = grouped_hash_internal::append(h, key, n);
+			memcpy((void *)&h._values[i], (const void *)values, n * sizeof(T));
+		}
+
+		template<typename T> void remove(GroupedHash<T> &h, uint64_t key, uint32_t i)
+		{
+			typename GroupedHash<T>::Group *g = grouped_hash_internal::group(h, key);
+			if (!g || i >= g->size)
+				return;
+			if (g->size == 1) {
+				remove_all(h, key);
+				return;
+			}
+			h._values[g->offset + i] = h._values[g->offset + g->size - 1];
+			--g->size;
+			--h._size;
+		}
+
+		template<typename T> void remove_all(GroupedHash<T> &h, uint64_t key)
+		{
+			typename GroupedHash<T>::Group *g = grouped_hash_internal::group(h, key);
+			if (!g)
+				return;
+			h._size -= g->size;
+			if (g->offset + g->capacity == array::size(h._values))
+				array::resize(h._values, g->offset);
+			else
+				h._garbage += g->capacity;
+			hash::remove(h._groups, key);
+			grouped_hash_internal::collect(h);
+		}
+
+		template<typename T> inline uint32_t num_keys(const GroupedHash<T> &h)
+		{
+			return array::size(h._groups._data);
+		}
+
+		template<typename T> inline uint32_t size(const GroupedHash<T> &h)
+		{
+			return h._size;
+		}
+
+		template<typename T> void compact(GroupedHash<T> &h)
+		{
+			Array<T> values(*h._values._allocator);
+			array::resize(values, h._size);
+			uint32_t offset = 0;
+			for (uint32_t i=0; i<array::size(h._groups._data); ++i) {
+				typename GroupedHash<T>::Group &g = h._groups._data[i].value;
+				memcpy((void *)&values[offset], (const void *)&h._values[g.offset], g.size * sizeof(T));
+				g.offset = offset;
+				g.capacity = g.size;
+				offset += g.size;
+			}
+
+			Array<T> empty(*h._values._allocator);
+			h._values.~Array<T>();
+			memcpy((void *)&h._values, (const void *)&values, sizeof(Array<T>));
+			memcpy((void *)&values, (const void *)&empty, sizeof(Array<T>));
+			h._garbage = 0;
+		}
+	}
+
+	template <typename T> GroupedHash<T>::GroupedHash(Allocator &a) :
+		_groups(a), _values(a), _size(0), _garbage(0)
+	{}
+}
@@ -3,6 +3,12 @@
 #include "array.h"
 #include "collection_types.h"
 
+#include <assert.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <xmmintrin.h>
+#endif
+
 namespace foundation {
 
 	/// The hash function stores its data in a "list-in-an-array" where
@@ -10,6 +16,12 @@ namespace foundation {
 	///
 	/// When items are removed, the array-list is repacked to always keep
 	/// it tightly ordered.
+	///
+	/// With incremental rehashing enabled, growing the hash only allocates a
+	/// new bucket array. The old bucket array is kept alongside it and the
+	/// following operations each move a few of the old buckets over, so no
+	/// single insert has to relink all the entries. The entries themselves
+	/// never move during a rehash, only the bucket links are rebuilt.
 
 	namespace hash
 	{
@@ -33,6 +45,40 @@ namespace foundation {
 		/// Remove all elements from the hash.
 		template<typename T> void clear(Hash<T> &h);
 
+		/// Removes all entries for which pred(key, value) returns true and returns
+		/// the number of removed entries. The entries are compacted in a single
+		/// pass and the bucket links are rebuilt once, which is much faster than
+		/// calling remove() for each entry when many entries are removed. The
+		/// remaining entries keep their order. Also works for multi_hash entries.
+		template<typename T, typename Pred> uint32_t remove_if(Hash<T> &h, Pred pred);
+
+		/// Removes all entries for which pred(key, value) returns false and
+		/// returns the number of removed entries.
+		template<typename T, typename Pred> uint32_t retain(Hash<T> &h, Pred pred);
+
+		/// Shrinks the bucket array and the entry array to fit the current
+		/// number of entries, to release memory after removing many entries.
+		template<typename T> void shrink_to_fit(Hash<T> &h);
+
+		/// Enables incremental rehashing. When the hash grows, the old buckets
+		/// are migrated to the new bucket array in steps of buckets_per_operation
+		/// buckets by each following set(), remove(), multi_hash::insert() and
+		/// multi_hash::remove(). (get() and has() take a const hash and don't
+		/// migrate.) If a migration is still in progress when the hash needs to
+		/// grow again, it is finished first, so buckets_per_operation should be
+		/// at least 4. Pass 0 to rehash the entire table at once (the default).
+		template<typename T> void set_incremental_rehash(Hash<T> &h, uint32_t buckets_per_operation);
+
+		/// Batched versions of has(), get() and set() for n keys. The keys are
+		/// processed in groups: bucket and entry memory for the whole group is
+		/// prefetched before any of the lookups are resolved, so the cache misses
+		/// of different keys overlap instead of being paid one after the other.
+		/// This is much faster than individual calls when the hash doesn't fit
+		/// in the cache.
+		template<typename T> void has_many(const Hash<T> &h, const uint64_t *keys, uint32_t n, bool *result);
+		template<typename T> void get_many(const Hash<T> &h, const uint64_t *keys, uint32_t n, T *values, const T &deffault);
+		template<typename T> void set_many(Hash<T> &h, const uint64_t *keys, const T *values, uint32_t n);
+
 		/// Returns a pointer to the first entry in the hash table, can be used to
 		/// efficiently iterate over the elements (in random order).
 		template<typename T> const typename Hash<T>::Entry *begin(const Hash<T> &h);
@@ -73,8 +119,41 @@ namespace foundation {
 			uint32_t hash_i;
 			uint32_t data_prev;
 			uint32_t data_i;
+			bool in_old_hash;	//< hash_i indexes _old_hash instead of _hash.
 		};	
 
+		/// Returns the bucket that heads the chain of the find result.
+		template<typename T> inline uint32_t &head(Hash<T> &h, const FindResult &fr)
+		{
+			return fr.in_old_hash ? h._old_hash[fr.hash_i] : h._hash[fr.hash_i];
+		}
+
+		/// Returns true if an incremental rehash is in progress.
+		template<typename T> inline bool migrating(const Hash<T> &h)
+		{
+			return array::size(h._old_hash) != 0;
+		}
+
+		/// Sets the bucket of the find result for the key. Keys whose old
+		/// bucket hasn't been migrated yet are still found through _old_hash.
+		template<typename T> inline void find_bucket(const Hash<T> &h, uint64_t key, FindResult &fr)
+		{
+			if (migrating(h)) {
+				const uint32_t old_i = key % array::size(h._old_hash);
+				if (old_i >= h._migrated) {
+					fr.hash_i = old_i;
+					fr.in_old_hash = true;
+					fr.data_i = h._old_hash[old_i];
+					return;
+				}
+			}
+			fr.hash_i = key % array::size(h._hash);
+			fr.data_i = h._hash[fr.hash_i];
+		}
+
+		template<typename T> FindResult find(const Hash<T> &h, uint64_t key);
+		template<typename T> FindResult find(const Hash<T> &h, const typename Hash<T>::Entry *e);
+
 		template<typename T> uint32_t add_entry(Hash<T> &h, uint64_t key)
 		{
 			typename Hash<T>::Entry e;
@@ -88,22 +167,26 @@ namespace foundation {
 		template<typename T> void erase(Hash<T> &h, const FindResult &fr)
 		{
 			if (fr.data_prev == END_OF_LIST)
-				h._hash[fr.hash_i] = h._data[fr.data_i].next;
+				head(h, fr) = h._data[fr.data_i].next;
 			else
 				h._data[fr.data_prev].next = h._data[fr.data_i].next;
 
-			if (fr.data_i == array::size(h._data) - 1) {
+			const uint32_t last_i = array::size(h._data) - 1;
+			if (fr.data_i == last_i) {
 				array::pop_back(h._data);
 				return;
 			}
 
-			h._data[fr.data_i] = h._data[array::size(h._data) - 1];
-			FindResult last = find(h, h._data[fr.data_i].key);
+			// Find the link to the last entry by address (not by key, there
+			// may be other entries with the same key) before it is moved.
+			FindResult last = find(h, &h._data[last_i]);
+			h._data[fr.data_i] = h._data[last_i];
 
 			if (last.data_prev != END_OF_LIST)
 				h._data[last.data_prev].next = fr.data_i;
 			else
-				h._hash[last.hash_i] = fr.data_i;
+				head(h, last) = fr.data_i;
+			array::pop_back(h._data);
 		}
 
 		template<typename T> FindResult find(const Hash<T> &h, uint64_t key)
@@ -112,12 +195,12 @@ namespace foundation {
 			fr.hash_i = END_OF_LIST;
 			fr.data_prev = END_OF_LIST;
 			fr.data_i = END_OF_LIST;
+			fr.in_old_hash = false;
 
 			if (array::size(h._hash) == 0)
 				return fr;
 
-			fr.hash_i = key % array::size(h._hash);
-			fr.data_i = h._hash[fr.hash_i];
+			find_bucket(h, key, fr);
 			while (fr.data_i != END_OF_LIST) {
 				if (h._data[fr.data_i].key == key)
 					return fr;
@@ -133,12 +216,12 @@ namespace foundation {
 			fr.hash_i = END_OF_LIST;
 			fr.data_prev = END_OF_LIST;
 			fr.data_i = END_OF_LIST;
+			fr.in_old_hash = false;
 
 			if (array::size(h._hash) == 0)
 				return fr;
 
-			fr.hash_i = e->key % array::size(h._hash);
-			fr.data_i = h._hash[fr.hash_i];
+			find_bucket(h, e->key, fr);
 			while (fr.data_i != END_OF_LIST) {
 				if (&h._data[fr.data_i] == e)
 					return fr;
@@ -148,6 +231,55 @@ namespace foundation {
 			return fr;
 		}
 
+		/// Number of keys that are prefetched together by the batched functions.
+		const uint32_t BATCH_SIZE = 32;
+
+		inline void prefetch(const void *p)
+		{
+		#if defined(__GNUC__)
+			__builtin_prefetch(p);
+		#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			_mm_prefetch((const char *)p, _MM_HINT_T0);
+		#else
+			(void)p;
+		#endif
+		}
+
+		/// Finds the entries of a batch of keys (at most BATCH_SIZE), writing
+		/// the entry index or END_OF_LIST for each key to result.
+		template<typename T> void find_batch(const Hash<T> &h, const uint64_t *keys, uint32_t n, uint32_t *result)
+		{
+			FindResult fr[BATCH_SIZE];
+
+			// First pass: compute the buckets and prefetch them.
+			for (uint32_t i=0; i<n; ++i) {
+				fr[i].in_old_hash = false;
+				if (migrating(h) && keys[i] % array::size(h._old_hash) >= h._migrated) {
+					fr[i].in_old_hash = true;
+					fr[i].hash_i = keys[i] % array::size(h._old_hash);
+					prefetch(&h._old_hash[fr[i].hash_i]);
+				} else {
+					fr[i].hash_i = keys[i] % array::size(h._hash);
+					prefetch(&h._hash[fr[i].hash_i]);
+				}
+			}
+
+			// Second pass: read the buckets and prefetch the first entries.
+			for (uint32_t i=0; i<n; ++i) {
+				fr[i].data_i = fr[i].in_old_hash ? h._old_hash[fr[i].hash_i] : h._hash[fr[i].hash_i];
+				if (fr[i].data_i != END_OF_LIST)
+					prefetch(&h._data[fr[i].data_i]);
+			}
+
+			// Third pass: walk the chains.
+			for (uint32_t i=0; i<n; ++i) {
+				uint32_t data_i = fr[i].data_i;
+				while (data_i != END_OF_LIST && h._data[data_i].key != keys[i])
+					data_i = h._data[data_i].next;
+				result[i] = data_i;
+			}
+		}
+
 		template<typename T> uint32_t find_or_fail(const Hash<T> &h, uint64_t key)
 		{
 			return find(h, key).data_i;
@@ -161,7 +293,7 @@ namespace foundation {
 
 			uint32_t i = add_entry(h, key);
 			if (fr.data_prev == END_OF_LIST)
-				h._hash[fr.hash_i] = i;
+				head(h, fr) = i;
 			else
 				h._data[fr.data_prev].next = i;
 			return i;
@@ -173,7 +305,7 @@ namespace foundation {
 			const uint32_t i = add_entry(h, key);
 
 			if (fr.data_prev == END_OF_LIST)
-				h._hash[fr.hash_i] = i;
+				head(h, fr) = i;
 			else
 				h._data[fr.data_prev].next = i;
 
@@ -190,6 +322,7 @@ namespace foundation {
 
 		template<typename T> void rehash(Hash<T> &h, uint32_t new_size)
 		{
+			const uint32_t rehash_step = h._rehash_step;
 			Hash<T> nh(*h._hash._allocator);
 			array::resize(nh._hash, new_size);
 			array::reserve(nh._data, array::size(h._data));
@@ -202,8 +335,102 @@ namespace foundation {
 
 			Hash<T> empty(*h._hash._allocator);
 			h.~Hash<T>();
-			memcpy(&h, &nh, sizeof(Hash<T>));
-			memcpy(&nh, &empty, sizeof(Hash<T>));
+			memcpy((void *)&h, (const void *)&nh, sizeof(Hash<T>));
+			memcpy((void *)&nh, (const void *)&empty, sizeof(Hash<T>));
+			h._rehash_step = rehash_step;
+		}
+
+		/// Moves up to count buckets from _old_hash to _hash. Frees the old
+		/// bucket array when all buckets have been moved.
+		template<typename T> void migrate(Hash<T> &h, uint32_t count)
+		{
+			const uint32_t old_size = array::size(h._old_hash);
+			const uint32_t new_size = array::size(h._hash);
+			const uint32_t end = old_size - h._migrated > count ? h._migrated + count : old_size;
+			for (; h._migrated < end; ++h._migrated) {
+				uint32_t i = h._old_hash[h._migrated];
+				while (i != END_OF_LIST) {
+					typename Hash<T>::Entry &e = h._data[i];
+					const uint32_t next = e.next;
+					const uint32_t hash_i = e.key % new_size;
+					e.next = h._hash[hash_i];
+					h._hash[hash_i] = i;
+					i = next;
+				}
+			}
+
+			if (h._migrated == old_size) {
+				array::set_capacity(h._old_hash, 0);
+				h._migrated = 0;
+			}
+		}
+
+		/// Performs one step of an ongoing incremental rehash.
+		template<typename T> inline void migrate_step(Hash<T> &h)
+		{
+			if (migrating(h))
+				migrate(h, h._rehash_step);
+		}
+
+		/// Starts an incremental rehash to new_size buckets.
+		template<typename T> void begin_migration(Hash<T> &h, uint32_t new_size)
+		{
+			if (migrating(h))
+				migrate(h, array::size(h._old_hash));
+
+			// Swap the bucket arrays, so that the current buckets become the
+			// old buckets without copying them.
+			char tmp[sizeof(Array<uint32_t>)];
+			memcpy(tmp, (const void *)&h._hash, sizeof(Array<uint32_t>));
+			memcpy((void *)&h._hash, (const void *)&h._old_hash, sizeof(Array<uint32_t>));
+			memcpy((void *)&h._old_hash, tmp, sizeof(Array<uint32_t>));
+
+			array::resize(h._hash, new_size);
+			for (uint32_t i=0; i<new_size; ++i)
+				h._hash[i] = END_OF_LIST;
+			h._migrated = 0;
+		}
+
+		/// Rebuilds all bucket links in a bucket array of new_size buckets,
+		/// without moving the entries. Any ongoing migration is abandoned, since
+		/// all entries are linked into the new buckets.
+		template<typename T> void relink(Hash<T> &h, uint32_t new_size)
+		{
+			array::set_capacity(h._old_hash, 0);
+			h._migrated = 0;
+
+			array::resize(h._hash, new_size);
+			for (uint32_t i=0; i<new_size; ++i)
+				h._hash[i] = END_OF_LIST;
+
+			// Link in reverse order so the chains are in entry order, like they
+			// are when the entries are inserted one by one.
+			for (uint32_t i = array::size(h._data); i-- > 0; ) {
+				const uint32_t hash_i = h._data[i].key % new_size;
+				h._data[i].next = h._hash[hash_i];
+				h._hash[hash_i] = i;
+			}
+		}
+
+		/// Removes the entries for which pred(key, value) == remove_matching.
+		template<typename T, typename Pred> uint32_t compact(Hash<T> &h, Pred &pred, bool remove_matching)
+		{
+			typename Hash<T>::Entry *e = array::begin(h._data);
+			const uint32_t n = array::size(h._data);
+			uint32_t kept = 0;
+			for (uint32_t i=0; i<n; ++i) {
+				if (bool(pred(e[i].key, e[i].value)) == remove_matching)
+					continue;
+				if (kept != i)
+					e[kept] = e[i];
+				++kept;
+			}
+			if (kept == n)
+				return 0;
+
+			array::resize(h._data, kept);
+			relink(h, array::size(h._hash));
+			return n - kept;
 		}
 
 		template<typename T> bool full(const Hash<T> &h)
@@ -212,10 +439,19 @@ namespace foundation {
 			return array::size(h._data) >= array::size(h._hash) * max_load_factor;
 		}
 
+		/// Grows the bucket array to new_size buckets, incrementally if
+		/// incremental rehashing is enabled.
+		template<typename T> void grow(Hash<T> &h, uint32_t new_size)
+		{
+			if (h._rehash_step && array::size(h._hash))
+				begin_migration(h, new_size);
+			else
+				rehash(h, new_size);
+		}
+
 		template<typename T> void grow(Hash<T> &h)
 		{
-			const uint32_t new_size = array::size(h._data) * 2 + 10;
-			rehash(h, new_size);
+			grow(h, array::size(h._data) * 2 + 10);
 		}
 	}
 
@@ -236,6 +472,7 @@ namespace foundation {
 		{
 			if (array::size(h._hash) == 0)
 				hash_internal::grow(h);
+			hash_internal::migrate_step(h);
 
 			const uint32_t i = hash_internal::find_or_make(h, key);
 			h._data[i].value = value;
@@ -245,6 +482,7 @@ namespace foundation {
 
 		template<typename T> void remove(Hash<T> &h, uint64_t key)
 		{
+			hash_internal::migrate_step(h);
 			hash_internal::find_and_erase(h, key);
 		}
 
@@ -257,6 +495,106 @@ namespace foundation {
 		{
 			array::clear(h._data);
 			array::clear(h._hash);
+			array::set_capacity(h._old_hash, 0);
+			h._migrated = 0;
+		}
+
+		template<typename T, typename Pred> uint32_t remove_if(Hash<T> &h, Pred pred)
+		{
+			return hash_internal::compact(h, pred, true);
+		}
+
+		template<typename T, typename Pred> uint32_t retain(Hash<T> &h, Pred pred)
+		{
+			return hash_internal::compact(h, pred, false);
+		}
+
+		template<typename T> void shrink_to_fit(Hash<T> &h)
+		{
+			const uint32_t n = array::size(h._data);
+			if (n == 0) {
+				array::set_capacity(h._hash, 0);
+				array::set_capacity(h._data, 0);
+				array::set_capacity(h._old_hash, 0);
+				h._migrated = 0;
+				return;
+			}
+
+			// The smallest bucket array that isn't full().
+			const uint32_t new_size = n * 10 / 7 + 1;
+			if (new_size < array::size(h._hash))
+				hash_internal::relink(h, new_size);
+			array::trim(h._hash);
+			array::trim(h._data);
+		}
+
+		template<typename T> void set_incremental_rehash(Hash<T> &h, uint32_t buckets_per_operation)
+		{
+			h._rehash_step = buckets_per_operation;
+			if (buckets_per_operation == 0 && hash_internal::migrating(h))
+				hash_internal::migrate(h, array::size(h._old_hash));
+		}
+
+		template<typename T> void has_many(const Hash<T> &h, const uint64_t *keys, uint32_t n, bool *result)
+		{
+			if (array::size(h._hash) == 0) {
+				for (uint32_t i=0; i<n; ++i)
+					result[i] = false;
+				return;
+			}
+
+			uint32_t found[hash_internal::BATCH_SIZE];
+			for (uint32_t start = 0; start < n; start += hash_internal::BATCH_SIZE) {
+				const uint32_t count = n - start < hash_internal::BATCH_SIZE ? n - start : hash_internal::BATCH_SIZE;
+				hash_internal::find_batch(h, keys + start, count, found);
+				for (uint32_t i=0; i<count; ++i)
+					result[start + i] = found[i] != hash_internal::END_OF_LIST;
+			}
+		}
+
+		template<typename T> void get_many(const Hash<T> &h, const uint64_t *keys, uint32_t n, T *values, const T &deffault)
+		{
+			if (array::size(h._hash) == 0) {
+				for (uint32_t i=0; i<n; ++i)
+					values[i] = deffault;
+				return;
+			}
+
+			uint32_t found[hash_internal::BATCH_SIZE];
+			for (uint32_t start = 0; start < n; start += hash_internal::BATCH_SIZE) {
+				const uint32_t count = n - start < hash_internal::BATCH_SIZE ? n - start : hash_internal::BATCH_SIZE;
+				hash_internal::find_batch(h, keys + start, count, found);
+				for (uint32_t i=0; i<count; ++i)
+					values[start + i] = found[i] == hash_internal::END_OF_LIST ? deffault : h._data[found[i]].value;
+			}
+		}
+
+		template<typename T> void set_many(Hash<T> &h, const uint64_t *keys, const T *values, uint32_t n)
+		{
+			// Grow once up front, so that the table doesn't grow in the middle of
+			// a batch. (This assumes all keys are new, so it may over-allocate.)
+			const uint64_t needed = (uint64_t)array::size(h._data) + n;
+			assert(needed < hash_internal::END_OF_LIST);
+			if (array::size(h._hash) == 0 || needed >= array::size(h._hash) * 0.7f) {
+				const uint64_t new_size = needed * 2 + 10;
+				hash_internal::grow(h, new_size < 0xffffffffu ? (uint32_t)new_size : 0xffffffffu);
+			}
+			array::reserve(h._data, (uint32_t)needed);
+
+			uint32_t found[hash_internal::BATCH_SIZE];
+			for (uint32_t start = 0; start < n; start += hash_internal::BATCH_SIZE) {
+				const uint32_t count = n - start < hash_internal::BATCH_SIZE ? n - start : hash_internal::BATCH_SIZE;
+
+				// The lookups only warm the cache, find_or_make() below looks the
+				// key up again, since an earlier key in the batch may have been
+				// inserted in the same chain.
+				hash_internal::find_batch(h, keys + start, count, found);
+				for (uint32_t i=0; i<count; ++i) {
+					hash_internal::migrate_step(h);
+					const uint32_t j = hash_internal::find_or_make(h, keys[start + i]);
+					h._data[j].value = values[start + i];
+				}
+			}
 		}
 
 		template<typename T> const typename Hash<T>::Entry *begin(const Hash<T> &h)
@@ -313,6 +651,7 @@ namespace foundation {
 		{
 			if (array::size(h._hash) == 0)
 				hash_internal::grow(h);
+			hash_internal::migrate_step(h);
 
 			const uint32_t i = hash_internal::make(h, key);
 			h._data[i].value = value;
@@ -322,6 +661,7 @@ namespace foundation {
 
 		template<typename T> void remove(Hash<T> &h, const typename Hash<T>::Entry *e)
 		{
+			hash_internal::migrate_step(h);
 			const hash_internal::FindResult fr = hash_internal::find(h, e);
 			if (fr.data_i != hash_internal::END_OF_LIST)
 				hash_internal::erase(h, fr);
@@ -329,13 +669,17 @@ namespace foundation {
 
 		template<typename T> void remove_all(Hash<T> &h, uint64_t key)
 		{
-			while (hash::has(h, key))
-				hash::remove(h, key);
+			hash_internal::migrate_step(h);
+			hash_internal::FindResult fr = hash_internal::find(h, key);
+			while (fr.data_i != hash_internal::END_OF_LIST) {
+				hash_internal::erase(h, fr);
+				fr = hash_internal::find(h, key);
+			}
 		}
 	}
 
 
 	template <typename T> Hash<T>::Hash(Allocator &a) :
-		_hash(a), _data(a)
+		_hash(a), _data(a), _old_hash(a), _migrated(0), _rehash_step(0)
 	{}
 }
\ No newline at end of file
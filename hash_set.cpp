@@ -0,0 +1,110 @@
+#include "hash_set.h"
+
+namespace foundation
+{
+	namespace
+	{
+		using namespace hash_set_internal;
+
+		void rehash(HashSet &s, uint32_t new_size)
+		{
+			array::resize(s._hash, new_size);
+			for (uint32_t i=0; i<new_size; ++i)
+				s._hash[i] = END_OF_LIST;
+
+			// The keys don't move, only the links are rebuilt.
+			for (uint32_t i = array::size(s._keys); i-- > 0; ) {
+				const uint32_t hash_i = s._keys[i] % new_size;
+				s._next[i] = s._hash[hash_i];
+				s._hash[hash_i] = i;
+			}
+		}
+
+		bool full(const HashSet &s)
+		{
+			const float max_load_factor = 0.7f;
+			return array::size(s._keys) >= array::size(s._hash) * max_load_factor;
+		}
+
+		void grow(HashSet &s)
+		{
+			rehash(s, array::size(s._keys) * 2 + 10);
+		}
+
+		/// Returns the link (bucket or next field) that points to entry i.
+		uint32_t *link_to(HashSet &s, uint32_t i)
+		{
+			uint32_t *link = &s._hash[s._keys[i] % array::size(s._hash)];
+			while (*link != i)
+				link = &s._next[*link];
+			return link;
+		}
+	}
+
+	namespace hash
+	{
+		void remove(HashSet &s, uint64_t key)
+		{
+			if (array::size(s._hash) == 0)
+				return;
+
+			uint32_t *link = &s._hash[key % array::size(s._hash)];
+			while (*link != END_OF_LIST && s._keys[*link] != key)
+				link = &s._next[*link];
+			const uint32_t i = *link;
+			if (i == END_OF_LIST)
+				return;
+			*link = s._next[i];
+
+			const uint32_t last = array::size(s._keys) - 1;
+			if (i != last) {
+				uint32_t *last_link = link_to(s, last);
+				s._keys[i] = s._keys[last];
+				s._next[i] = s._next[last];
+				*last_link = i;
+			}
+			array::pop_back(s._keys);
+			array::pop_back(s._next);
+		}
+
+		void reserve(HashSet &s, uint32_t size)
+		{
+			if (size > array::size(s._hash))
+				rehash(s, size);
+		}
+
+		void clear(HashSet &s)
+		{
+			array::clear(s._hash);
+			array::clear(s._keys);
+			array::clear(s._next);
+		}
+	}
+
+	namespace hash_set
+	{
+		bool insert(HashSet &s, uint64_t key)
+		{
+			if (array::size(s._hash) == 0)
+				grow(s);
+
+			uint32_t *link = &s._hash[key % array::size(s._hash)];
+			while (*link != END_OF_LIST) {
+				if (s._keys[*link] == key)
+					return false;
+				link = &s._next[*link];
+			}
+
+			*link = array::size(s._keys);
+			array::push_back(s._keys, key);
+			array::push_back(s._next, END_OF_LIST);
+
+			if (full(s))
+				grow(s);
+			return true;
+		}
+	}
+
+	HashSet::HashSet(Allocator &a) : _hash(a), _keys(a), _next(a)
+	{}
+}
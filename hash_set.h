@@ -0,0 +1,76 @@
+#pragma once
+
+#include "collection_types.h"
+#include "array.h"
+
+namespace foundation
+{
+	/// The hash set uses the same "list-in-an-array" layout as the split hash,
+	/// with only the key and link arrays. When a key is removed the last key is
+	/// moved into the hole, so the keys are always tightly packed.
+
+	namespace hash
+	{
+		/// Returns true if the key is in the set.
+		bool has(const HashSet &s, uint64_t key);
+
+		/// Removes the key from the set if it exists.
+		void remove(HashSet &s, uint64_t key);
+
+		/// Grows the hash lookup table to at least the specified size. It never
+		/// shrinks. (The table will grow automatically when 70 % full.)
+		void reserve(HashSet &s, uint32_t size);
+
+		/// Removes all keys from the set.
+		void clear(HashSet &s);
+	}
+
+	namespace hash_set
+	{
+		/// Adds the key to the set. Returns true if the key was added and false
+		/// if it already was in the set.
+		bool insert(HashSet &s, uint64_t key);
+
+		/// Returns the number of keys in the set.
+		uint32_t size(const HashSet &s);
+
+		/// Returns the keys of the set (in random order). There are size() keys.
+		const uint64_t *keys(const HashSet &s);
+	}
+
+	namespace hash_set_internal
+	{
+		const uint32_t END_OF_LIST = 0xffffffffu;
+
+		inline uint32_t find(const HashSet &s, uint64_t key)
+		{
+			if (array::size(s._hash) == 0)
+				return END_OF_LIST;
+			uint32_t i = s._hash[key % array::size(s._hash)];
+			while (i != END_OF_LIST && s._keys[i] != key)
+				i = s._next[i];
+			return i;
+		}
+	}
+
+	namespace hash
+	{
+		inline bool has(const HashSet &s, uint64_t key)
+		{
+			return hash_set_internal::find(s, key) != hash_set_internal::END_OF_LIST;
+		}
+	}
+
+	namespace hash_set
+	{
+		inline uint32_t size(const HashSet &s)
+		{
+			return array::size(s._keys);
+		}
+
+		inline const uint64_t *keys(const HashSet &s)
+		{
+			return array::begin(s._keys);
+		}
+	}
+}
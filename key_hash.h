@@ -0,0 +1,230 @@
+#pragma once
+
+#include "array.h"
+#include "collection_types.h"
+#include "murmur_hash.h"
+
+#include <string.h>
+
+namespace foundation {
+
+	/// The key hash uses the same "list-in-an-array" layout as the regular
+	/// hash, but the entries store the full key together with its 64 bit hash
+	/// value. Lookups compare the hash values first and only call EqFn when
+	/// they match. The stored hash values are also used when the table grows,
+	/// so HashFn is called exactly once per set(), get(), has() or remove().
+
+	/// Default hash function for KeyHash, hashes the bytes of the key.
+	template<typename K> struct MurmurKeyHash
+	{
+		uint64_t operator()(const K &key) const {return murmur_hash_64(&key, sizeof(K), 0);}
+	};
+
+	/// Default key comparison for KeyHash, compares the bytes of the keys. Keys
+	/// that contain padding must be zeroed before they are filled in, or use a
+	/// custom comparison.
+	template<typename K> struct BytewiseEqual
+	{
+		bool operator()(const K &a, const K &b) const {return memcmp(&a, &b, sizeof(K)) == 0;}
+	};
+
+	/// Hash and comparison for zero-terminated string keys. The hash only stores
+	/// the pointers, the strings must outlive it.
+	struct CStringKeyHash
+	{
+		uint64_t operator()(const char *key) const {return murmur_hash_64(key, (uint32_t)strlen(key), 0);}
+	};
+
+	struct CStringEqual
+	{
+		bool operator()(const char *a, const char *b) const {return strcmp(a, b) == 0;}
+	};
+
+	namespace hash
+	{
+		/// Returns true if the specified key exists in the hash.
+		template<typename K, typename V, typename H, typename E> bool has(const KeyHash<K,V,H,E> &h, const typename KeyHash<K,V,H,E>::Key &key);
+
+		/// Returns the value stored for the specified key, or deffault if the key
+		/// does not exist in the hash.
+		template<typename K, typename V, typename H, typename E> const V &get(const KeyHash<K,V,H,E> &h, const typename KeyHash<K,V,H,E>::Key &key, const V &deffault);
+
+		/// Sets the value for the key.
+		template<typename K, typename V, typename H, typename E> void set(KeyHash<K,V,H,E> &h, const typename KeyHash<K,V,H,E>::Key &key, const V &value);
+
+		/// Removes the key from the hash if it exists.
+		template<typename K, typename V, typename H, typename E> void remove(KeyHash<K,V,H,E> &h, const typename KeyHash<K,V,H,E>::Key &key);
+
+		/// Grows the hash lookup table to at least the specified size. It never
+		/// shrinks. (The table will grow automatically when 70 % full.)
+		template<typename K, typename V, typename H, typename E> void reserve(KeyHash<K,V,H,E> &h, uint32_t size);
+
+		/// Remove all elements from the hash.
+		template<typename K, typename V, typename H, typename E> void clear(KeyHash<K,V,H,E> &h);
+
+		/// Returns a pointer to the first entry in the hash table, can be used to
+		/// efficiently iterate over the elements (in random order).
+		template<typename K, typename V, typename H, typename E> const typename KeyHash<K,V,H,E>::Entry *begin(const KeyHash<K,V,H,E> &h);
+		template<typename K, typename V, typename H, typename E> const typename KeyHash<K,V,H,E>::Entry *end(const KeyHash<K,V,H,E> &h);
+	}
+
+	namespace key_hash_internal
+	{
+		const uint32_t END_OF_LIST = 0xffffffffu;
+
+		struct FindResult
+		{
+			uint32_t hash_i;
+			uint32_t data_prev;
+			uint32_t data_i;
+		};
+
+		template<typename K, typename V, typename H, typename E> FindResult find(const KeyHash<K,V,H,E> &h, uint64_t hv, const K &key)
+		{
+			FindResult fr;
+			fr.hash_i = END_OF_LIST;
+			fr.data_prev = END_OF_LIST;
+			fr.data_i = END_OF_LIST;
+
+			if (array::size(h._hash) == 0)
+				return fr;
+
+			fr.hash_i = hv % array::size(h._hash);
+			fr.data_i = h._hash[fr.hash_i];
+			while (fr.data_i != END_OF_LIST) {
+				const typename KeyHash<K,V,H,E>::Entry &e = h._data[fr.data_i];
+				if (e.hash == hv && h._eq_fn(e.key, key))
+					return fr;
+				fr.data_prev = fr.data_i;
+				fr.data_i = e.next;
+			}
+			return fr;
+		}
+
+		/// Returns the link (bucket or next field) that points to entry i.
+		template<typename K, typename V, typename H, typename E> uint32_t *link_to(KeyHash<K,V,H,E> &h, uint32_t i)
+		{
+			uint32_t *link = &h._hash[h._data[i].hash % array::size(h._hash)];
+			while (*link != i)
+				link = &h._data[*link].next;
+			return link;
+		}
+
+		template<typename K, typename V, typename H, typename E> void erase(KeyHash<K,V,H,E> &h, const FindResult &fr)
+		{
+			if (fr.data_prev == END_OF_LIST)
+				h._hash[fr.hash_i] = h._data[fr.data_i].next;
+			else
+				h._data[fr.data_prev].next = h._data[fr.data_i].next;
+
+			const uint32_t last = array::size(h._data) - 1;
+			if (fr.data_i != last) {
+				uint32_t *link = link_to(h, last);
+				h._data[fr.data_i] = h._data[last];
+				*link = fr.data_i;
+			}
+			array::pop_back(h._data);
+		}
+
+		template<typename K, typename V, typename H, typename E> void rehash(KeyHash<K,V,H,E> &h, uint32_t new_size)
+		{
+			array::resize(h._hash, new_size);
+			for (uint32_t i=0; i<new_size; ++i)
+				h._hash[i] = END_OF_LIST;
+
+			// The entries don't move and the hash values are stored, so only the
+			// links are rebuilt.
+			for (uint32_t i = array::size(h._data); i-- > 0; ) {
+				const uint32_t hash_i = h._data[i].hash % new_size;
+				h._data[i].next = h._hash[hash_i];
+				h._hash[hash_i] = i;
+			}
+		}
+
+		template<typename K, typename V, typename H, typename E> bool full(const KeyHash<K,V,H,E> &h)
+		{
+			const float max_load_factor = 0.7f;
+			return array::size(h._data) >= array::size(h._hash) * max_load_factor;
+		}
+
+		template<typename K, typename V, typename H, typename E> void grow(KeyHash<K,V,H,E> &h)
+		{
+			rehash(h, array::size(h._data) * 2 + 10);
+		}
+	}
+
+	namespace hash
+	{
+		template<typename K, typename V, typename H, typename E> bool has(const KeyHash<K,V,H,E> &h, const typename KeyHash<K,V,H,E>::Key &key)
+		{
+			return key_hash_internal::find(h, h._hash_fn(key), key).data_i != key_hash_internal::END_OF_LIST;
+		}
+
+		template<typename K, typename V, typename H, typename E> const V &get(const KeyHash<K,V,H,E> &h, const typename KeyHash<K,V,H,E>::Key &key, const V &deffault)
+		{
+			const uint32_t i = key_hash_internal::find(h, h._hash_fn(key), key).data_i;
+			return i == key_hash_internal::END_OF_LIST ? deffault : h._data[i].value;
+		}
+
+		template<typename K, typename V, typename H, typename E> void set(KeyHash<K,V,H,E> &h, const typename KeyHash<K,V,H,E>::Key &key, const V &value)
+		{
+			if (array::size(h._hash) == 0)
+				key_hash_internal::grow(h);
+
+			const uint64_t hv = h._hash_fn(key);
+			const key_hash_internal::FindResult fr = key_hash_internal::find(h, hv, key);
+			if (fr.data_i != key_hash_internal::END_OF_LIST) {
+				h._data[fr.data_i].value = value;
+				return;
+			}
+
+			typename KeyHash<K,V,H,E>::Entry e;
+			e.hash = hv;
+			e.next = key_hash_internal::END_OF_LIST;
+			e.key = key;
+			e.value = value;
+			const uint32_t i = array::size(h._data);
+			array::push_back(h._data, e);
+			if (fr.data_prev == key_hash_internal::END_OF_LIST)
+				h._hash[fr.hash_i] = i;
+			else
+				h._data[fr.data_prev].next = i;
+
+			if (key_hash_internal::full(h))
+				key_hash_internal::grow(h);
+		}
+
+		template<typename K, typename V, typename H, typename E> void remove(KeyHash<K,V,H,E> &h, const typename KeyHash<K,V,H,E>::Key &key)
+		{
+			const key_hash_internal::FindResult fr = key_hash_internal::find(h, h._hash_fn(key), key);
+			if (fr.data_i != key_hash_internal::END_OF_LIST)
+				key_hash_internal::erase(h, fr);
+		}
+
+		template<typename K, typename V, typename H, typename E> void reserve(KeyHash<K,V,H,E> &h, uint32_t size)
+		{
+			if (size > array::size(h._hash))
+				key_hash_internal::rehash(h, size);
+		}
+
+		template<typename K, typename V, typename H, typename E> void clear(KeyHash<K,V,H,E> &h)
+		{
+			array::clear(h._hash);
+			array::clear(h._data);
+		}
+
+		template<typename K, typename V, typename H, typename E> const typename KeyHash<K,V,H,E>::Entry *begin(const KeyHash<K,V,H,E> &h)
+		{
+			return array::begin(h._data);
+		}
+
+		template<typename K, typename V, typename H, typename E> const typename KeyHash<K,V,H,E>::Entry *end(const KeyHash<K,V,H,E> &h)
+		{
+			return array::end(h._data);
+		}
+	}
+
+	template <typename K, typename V, typename H, typename E> KeyHash<K,V,H,E>::KeyHash(Allocator &a, const H &hash_fn, const E &eq_fn) :
+		_hash(a), _data(a), _hash_fn(hash_fn), _eq_fn(eq_fn)
+	{}
+}
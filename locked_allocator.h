@@ -0,0 +1,44 @@
+#pragma once
+
+#include "memory.h"
+
+#include <mutex>
+
+namespace foundation
+{
+	/// An allocator that forwards to a backing allocator under a lock. Use it
+	/// to share an allocator that isn't thread-safe (such as the default
+	/// allocator) between threads.
+	class LockedAllocator : public Allocator
+	{
+	public:
+		LockedAllocator(Allocator &backing) : _backing(backing) {}
+
+		virtual void *allocate(uint32_t size, uint32_t align = DEFAULT_ALIGN) {
+			std::lock_guard<std::mutex> guard(_lock);
+			return _backing.allocate(size, align);
+		}
+
+		virtual void deallocate(void *p) {
+			std::lock_guard<std::mutex> guard(_lock);
+			_backing.deallocate(p);
+		}
+
+		virtual uint32_t allocated_size(void *p) {
+			std::lock_guard<std::mutex> guard(_lock);
+			return _backing.allocated_size(p);
+		}
+
+		virtual uint32_t total_allocated() {
+			std::lock_guard<std::mutex> guard(_lock);
+			return _backing.total_allocated();
+		}
+
+		/// Returns the backing allocator.
+		Allocator &backing() {return _backing;}
+
+	private:
+		Allocator &_backing;
+		std::mutex _lock;
+	};
+}
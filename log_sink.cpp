@@ -0,0 +1,252 @@
+#include "log_sink.h"
+#include "array.h"
+#include "queue.h"
+#include "memory.h"
+#include "locked_allocator.h"
+
+#include <errno.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+	#include <io.h>
+#else
+	#include <unistd.h>
+	#include <sys/uio.h>
+#endif
+
+namespace foundation
+{
+	struct LogSinkState
+	{
+		LogSinkState(Allocator &a, int fd, uint32_t buffer_size, uint32_t max_queued, LogSink::Overflow overflow) :
+			allocator(a), fd(fd), buffer_size(buffer_size), max_queued(max_queued), overflow(overflow),
+			queue(allocator), free_buffers(allocator), stopping(false), writing(0),
+			queued_bytes(0), written_bytes(0), dropped_bytes(0)
+		{
+			queue::reserve(queue, max_queued);
+		}
+
+		/// Buffers can grow on the threads that own them, so all the sink's
+		/// allocations go through this.
+		LockedAllocator allocator;
+		int fd;
+		uint32_t buffer_size;
+		uint32_t max_queued;
+		LogSink::Overflow overflow;
+
+		/// Protects the members below.
+		std::mutex lock;
+		/// Signaled when buffers are queued or the sink is stopping.
+		std::condition_variable queued;
+		/// Signaled when queued buffers have been written.
+		std::condition_variable written;
+		Queue<Array<char> *> queue;
+		Array<Array<char> *> free_buffers;
+		bool stopping;
+		/// Number of buffers that the background thread is writing.
+		uint32_t writing;
+
+		std::atomic<uint64_t> queued_bytes;
+		std::atomic<uint64_t> written_bytes;
+		std::atomic<uint64_t> dropped_bytes;
+
+		std::thread thread;
+	};
+
+	namespace
+	{
+		/// Returns an empty buffer, recycled if possible. Must be called with
+		/// the lock held.
+		Array<char> *get_buffer(LogSinkState &s)
+		{
+			if (array::size(s.free_buffers)) {
+				Array<char> *b = array::back(s.free_buffers);
+				array::pop_back(s.free_buffers);
+				return b;
+			}
+			Array<char> *b = MAKE_NEW(s.allocator, Array<char>, s.allocator);
+			array::reserve(*b, s.buffer_size);
+			return b;
+		}
+
+		/// Writes the buffers to the file descriptor. Returns the number of
+		/// bytes that were written.
+		uint64_t write_buffers(int fd, Array<char> **buffers, uint32_t n)
+		{
+			uint64_t total = 0;
+		#if defined(_WIN32)
+			for (uint32_t i=0; i<n; ++i) {
+				const char *p = array::begin(*buffers[i]);
+				uint32_t left = array::size(*buffers[i]);
+				while (left > 0) {
+					const int written = _write(fd, p, left);
+					if (written <= 0)
+						return total;
+					p += written;
+					left -= written;
+					total += written;
+				}
+			}
+		#else
+			struct iovec iov[64];
+			for (uint32_t i=0; i<n; ++i) {
+				iov[i].iov_base = array::begin(*buffers[i]);
+				iov[i].iov_len = array::size(*buffers[i]);
+			}
+			struct iovec *first = iov;
+			uint32_t num = n;
+			while (num > 0) {
+				const ssize_t written = writev(fd, first, num);
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return total;
+				total += written;
+				// Skip past what was written, after a partial write.
+				size_t skip = written;
+				while (num > 0 && skip >= first->iov_len) {
+					skip -= first->iov_len;
+					++first;
+					--num;
+				}
+				if (num > 0) {
+					first->iov_base = (char *)first->iov_base + skip;
+					first->iov_len -= skip;
+				}
+			}
+		#endif
+			return total;
+		}
+
+		void run_writer(LogSinkState *state)
+		{
+			LogSinkState &s = *state;
+			Array<char> *batch[64];
+			while (true) {
+				uint32_t n = 0;
+				{
+					std::unique_lock<std::mutex> guard(s.lock);
+					s.queued.wait(guard, [&s] {return queue::size(s.queue) > 0 || s.stopping;});
+					if (queue::size(s.queue) == 0)
+						return;
+					while (n < 64 && queue::size(s.queue) > 0) {
+						batch[n++] = s.queue[0];
+						queue::pop_front(s.queue);
+					}
+					s.writing = n;
+				}
+
+				uint64_t bytes = 0;
+				for (uint32_t i=0; i<n; ++i)
+					bytes += array::size(*batch[i]);
+				const uint64_t written = write_buffers(s.fd, batch, n);
+				s.written_bytes += written;
+				s.dropped_bytes += bytes - written;
+
+				{
+					std::lock_guard<std::mutex> guard(s.lock);
+					for (uint32_t i=0; i<n; ++i) {
+						array::clear(*batch[i]);
+						array::push_back(s.free_buffers, batch[i]);
+					}
+					s.writing = 0;
+				}
+				s.written.notify_all();
+			}
+		}
+	}
+
+	namespace log_sink
+	{
+		LogSinkStats stats(const LogSink &sink)
+		{
+			LogSinkStats stats;
+			stats.queued_bytes = sink._state->queued_bytes;
+			stats.written_bytes = sink._state->written_bytes;
+			stats.dropped_bytes = sink._state->dropped_bytes;
+			return stats;
+		}
+
+		void flush(LogSink &sink)
+		{
+			LogSinkState &s = *sink._state;
+			std::unique_lock<std::mutex> guard(s.lock);
+			s.written.wait(guard, [&s] {return queue::size(s.queue) == 0 && s.writing == 0;});
+		}
+	}
+
+	namespace log_writer
+	{
+		void commit(LogWriter &w)
+		{
+			// Queue the buffer when it is three quarters full, so that lines
+			// rarely grow past the end of the buffer.
+			const uint32_t buffer_size = w._sink->_state->buffer_size;
+			if (array::size(*w._buffer) >= buffer_size - buffer_size / 4)
+				flush(w);
+		}
+
+		void flush(LogWriter &w)
+		{
+			LogSinkState &s = *w._sink->_state;
+			const uint32_t size = array::size(*w._buffer);
+			if (size == 0)
+				return;
+
+			{
+				std::unique_lock<std::mutex> guard(s.lock);
+				if (queue::size(s.queue) >= s.max_queued) {
+					if (s.overflow == LogSink::DROP) {
+						guard.unlock();
+						s.dropped_bytes += size;
+						array::clear(*w._buffer);
+						return;
+					}
+					s.written.wait(guard, [&s] {return queue::size(s.queue) < s.max_queued;});
+				}
+				queue::push_back(s.queue, w._buffer);
+				w._buffer = get_buffer(s);
+			}
+			s.queued_bytes += size;
+			s.queued.notify_one();
+		}
+	}
+
+	LogSink::LogSink(Allocator &a, int fd, uint32_t buffer_size, uint32_t max_queued, Overflow overflow)
+	{
+		_state = MAKE_NEW(a, LogSinkState, a, fd, buffer_size, max_queued, overflow);
+		_state->thread = std::thread(run_writer, _state);
+	}
+
+	LogSink::~LogSink()
+	{
+		{
+			std::lock_guard<std::mutex> guard(_state->lock);
+			_state->stopping = true;
+		}
+		_state->queued.notify_one();
+		_state->thread.join();
+
+		for (uint32_t i=0; i<array::size(_state->free_buffers); ++i)
+			MAKE_DELETE(_state->allocator, Array<char>, _state->free_buffers[i]);
+		Allocator &a = _state->allocator.backing();
+		MAKE_DELETE(a, LogSinkState, _state);
+	}
+
+	LogWriter::LogWriter(LogSink &sink) : _sink(&sink)
+	{
+		std::lock_guard<std::mutex> guard(sink._state->lock);
+		_buffer = get_buffer(*sink._state);
+	}
+
+	LogWriter::~LogWriter()
+	{
+		log_writer::flush(*this);
+		LogSinkState &s = *_sink->_state;
+		std::lock_guard<std::mutex> guard(s.lock);
+		array::push_back(s.free_buffers, _buffer);
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "collection_types.h"
+
+namespace foundation
+{
+	/// A LogWriter's buffer is a regular string_stream::Buffer, so lines are
+	/// formatted with the string_stream functions and then committed:
+	///
+	///     string_stream::format(log_writer::buffer(w), FORMAT_STRING("{} done\n"), name);
+	///     log_writer::commit(w);
+	///
+	/// When the buffer is close to full, commit() swaps it for an empty buffer
+	/// and queues the full one for the background thread, which writes all the
+	/// queued buffers with a single writev(). Written buffers are recycled, so
+	/// once the sink has warmed up, logging doesn't allocate any memory (unless
+	/// a single line is larger than the buffer size).
+	///
+	/// The writers keep their lines until the buffer is full, so call
+	/// log_writer::flush() for lines that must be written right away.
+	namespace log_sink
+	{
+		/// Returns the byte counters of the sink. queued_bytes counts the bytes
+		/// that have been handed to the background thread, dropped_bytes the
+		/// bytes that were thrown away because the queue was full (with the
+		/// DROP policy) or because writing failed.
+		LogSinkStats stats(const LogSink &s);
+
+		/// Waits until all buffers that have been queued so far are written.
+		void flush(LogSink &s);
+	}
+
+	namespace log_writer
+	{
+		/// Returns the buffer that the next log line should be written to.
+		Array<char> &buffer(LogWriter &w);
+
+		/// Marks the end of a log line. Queues the buffer for writing if it is
+		/// close to full. (With the BLOCK policy, this can block until the
+		/// background thread catches up.)
+		void commit(LogWriter &w);
+
+		/// Queues the buffer for writing, even if it isn't full.
+		void flush(LogWriter &w);
+	}
+
+	namespace log_writer
+	{
+		inline Array<char> &buffer(LogWriter &w)
+		{
+			return *w._buffer;
+		}
+	}
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "array.h"
+#include "collection_types.h"
+#include "hash.h"
+
+namespace foundation {
+
+	/// The LRU cache stores its entries in a fixed size array. Used entries are
+	/// linked in a doubly linked recency list (most recently used first) and
+	/// unused entries in a singly linked free list, using entry indices as
+	/// links. A Hash<uint32_t> maps keys to entry indices. The index and the
+	/// entry array are allocated up front, so get(), put() and remove() never
+	/// allocate memory.
+	///
+	/// Each entry is charged a number of bytes (by default sizeof(T), but it
+	/// can be the size of the object T refers to). Entries are evicted when
+	/// the cache is full or the byte budget would be exceeded.
+	///
+	/// The budget is charged explicitly rather than enforced by an Allocator
+	/// that the cached objects are allocated from. The cache stores T by value
+	/// and can't free what a T refers to, so such an allocator could only fail
+	/// allocations, not make room for them. Instead the caller frees the
+	/// evicted values that put() hands back. To make the budget track the
+	/// memory that is really used, charge the allocated_size() of the
+	/// object's allocation:
+	///
+	///     void *p = a.allocate(size);
+	///     cache::put(c, key, p, a.allocated_size(p), &evicted);
+	///     for (uint32_t i=0; i<array::size(evicted); ++i)
+	///         a.deallocate(evicted[i]);
+
+	namespace cache
+	{
+		/// Returns the cached value for the key and marks it as most recently
+		/// used, or returns 0 if the key is not in the cache.
+		template<typename T> const T *get(LruCache<T> &c, uint64_t key);
+
+		/// Returns true if the key is in the cache, without touching the
+		/// recency order or the counters.
+		template<typename T> bool has(const LruCache<T> &c, uint64_t key);
+
+		/// Stores the value for the key, charging the specified number of bytes
+		/// against the byte budget. Least recently used entries are evicted to
+		/// make room. If evicted is not 0, the values of the evicted entries are
+		/// pushed to it, as well as the old value if the key was already cached
+		/// and the value itself if it is larger than the whole budget (such
+		/// entries are not stored). So all the values that the cache no longer
+		/// holds end up in evicted.
+		template<typename T> void put(LruCache<T> &c, uint64_t key, const T &value, uint32_t bytes = sizeof(T), Array<T> *evicted = 0);
+
+		/// Removes the key from the cache. Returns false if it wasn't cached.
+		template<typename T> bool remove(LruCache<T> &c, uint64_t key);
+
+		/// Removes all entries from the cache. The counters are kept.
+		template<typename T> void clear(LruCache<T> &c);
+
+		/// Returns the number of entries and the number of bytes in the cache.
+		template<typename T> uint32_t size(const LruCache<T> &c);
+		template<typename T> uint64_t bytes(const LruCache<T> &c);
+
+		/// Returns the number of get() hits and misses and the number of
+		/// evictions.
+		template<typename T> uint64_t hits(const LruCache<T> &c);
+		template<typename T> uint64_t misses(const LruCache<T> &c);
+		template<typename T> uint64_t evictions(const LruCache<T> &c);
+	}
+
+	namespace lru_cache_internal
+	{
+		const uint32_t END_OF_LIST = 0xffffffffu;
+
+		template<typename T> void unlink(LruCache<T> &c, uint32_t i)
+		{
+			typename LruCache<T>::Entry &e = c._entries[i];
+			if (e.prev == END_OF_LIST)
+				c._head = e.next;
+			else
+				c._entries[e.prev].next = e.next;
+			if (e.next == END_OF_LIST)
+				c._tail = e.prev;
+			else
+				c._entries[e.next].prev = e.prev;
+		}
+
+		template<typename T> void link_front(LruCache<T> &c, uint32_t i)
+		{
+			typename LruCache<T>::Entry &e = c._entries[i];
+			e.prev = END_OF_LIST;
+			e.next = c._head;
+			if (c._head == END_OF_LIST)
+				c._tail = i;
+			else
+				c._entries[c._head].prev = i;
+			c._head = i;
+		}
+
+		template<typename T> void release(LruCache<T> &c, uint32_t i)
+		{
+			typename LruCache<T>::Entry &e = c._entries[i];
+			unlink(c, i);
+			hash::remove(c._index, e.key);
+			c._bytes -= e.bytes;
+			--c._size;
+			e.next = c._free;
+			c._free = i;
+		}
+
+		template<typename T> void evict(LruCache<T> &c, Array<T> *evicted)
+		{
+			const uint32_t i = c._tail;
+			if (evicted)
+				array::push_back(*evicted, c._entries[i].value);
+			release(c, i);
+			++c._evictions;
+		}
+	}
+
+	namespace cache
+	{
+		template<typename T> const T *get(LruCache<T> &c, uint64_t key)
+		{
+			const uint32_t i = hash::get(c._index, key, lru_cache_internal::END_OF_LIST);
+			if (i == lru_cache_internal::END_OF_LIST) {
+				++c._misses;
+				return 0;
+			}
+			++c._hits;
+			if (c._head != i) {
+				lru_cache_internal::unlink(c, i);
+				lru_cache_internal::link_front(c, i);
+			}
+			return &c._entries[i].value;
+		}
+
+		template<typename T> bool has(const LruCache<T> &c, uint64_t key)
+		{
+			return hash::has(c._index, key);
+		}
+
+		template<typename T> void put(LruCache<T> &c, uint64_t key, const T &value, uint32_t bytes, Array<T> *evicted)
+		{
+			using namespace lru_cache_internal;
+
+			uint32_t i = hash::get(c._index, key, END_OF_LIST);
+			if (i != END_OF_LIST) {
+				if (evicted)
+					array::push_back(*evicted, c._entries[i].value);
+				release(c, i);
+			}
+			if (bytes > c._budget || array::size(c._entries) == 0) {
+				if (evicted)
+					array::push_back(*evicted, value);
+				return;
+			}
+
+			while (c._free == END_OF_LIST || c._bytes + bytes > c._budget)
+				evict(c, evicted);
+
+			i = c._free;
+			typename LruCache<T>::Entry &e = c._entries[i];
+			c._free = e.next;
+			e.key = key;
+			e.bytes = bytes;
+			e.value = value;
+			link_front(c, i);
+			hash::set(c._index, key, i);
+			c._bytes += bytes;
+			++c._size;
+		}
+
+		template<typename T> bool remove(LruCache<T> &c, uint64_t key)
+		{
+			const uint32_t i = hash::get(c._index, key, lru_cache_internal::END_OF_LIST);
+			if (i == lru_cache_internal::END_OF_LIST)
+				return false;
+			lru_cache_internal::release(c, i);
+			return true;
+		}
+
+		template<typename T> void clear(LruCache<T> &c)
+		{
+			while (c._head != lru_cache_internal::END_OF_LIST)
+				lru_cache_internal::release(c, c._head);
+		}
+
+		template<typename T> inline uint32_t size(const LruCache<T> &c) {return c._size;}
+		template<typename T> inline uint64_t bytes(const LruCache<T> &c) {return c._bytes;}
+		template<typename T> inline uint64_t hits(const LruCache<T> &c) {return c._hits;}
+		template<typename T> inline uint64_t misses(const LruCache<T> &c) {return c._misses;}
+		template<typename T> inline uint64_t evictions(const LruCache<T> &c) {return c._evictions;}
+	}
+
+	template <typename T> LruCache<T>::LruCache(Allocator &a, uint32_t capacity, uint64_t byte_budget) :
+		_index(a), _entries(a), _head(lru_cache_internal::END_OF_LIST), _tail(lru_cache_internal::END_OF_LIST),
+		_free(lru_cache_internal::END_OF_LIST), _size(0), _bytes(0), _budget(byte_budget),
+		_hits(0), _misses(0), _evictions(0)
+	{
+		// Size the index so that it never grows.
+		hash::reserve(_index, capacity * 10 / 7 + 10);
+		array::reserve(_index._data, capacity);
+
+		array::resize(_entries, capacity);
+		for (uint32_t i = capacity; i-- > 0; ) {
+			_entries[i].next = _free;
+			_free = i;
+		}
+	}
+}
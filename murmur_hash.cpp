@@ -1,57 +1,252 @@
 #include "murmur_hash.h"
 
+#include <string.h>
+#include <assert.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+	#include <immintrin.h>
+	#define MURMUR_HASH_AVX512
+#endif
+
 namespace foundation
 {
-	uint64_t murmur_hash_64(const void * key, uint32_t len, uint64_t seed)
+	namespace
 	{
 		const uint64_t m = 0xc6a4a7935bd1e995ULL;
 		const uint32_t r = 47;
 
-		uint64_t h = seed ^ (len * m);
-
-		const uint64_t * data = (const uint64_t *)key;
-		const uint64_t * end = data + (len/8);
-
-		while(data != end)
+		/// Reads a 64 bit word as little endian.
+		inline uint64_t load_64(const void *p)
 		{
+			uint64_t k;
+			memcpy(&k, p, sizeof(k));
 			#ifdef PLATFORM_BIG_ENDIAN
-				uint64 k = *data++;
-				char *p = (char *)&k;
-				char c;
-				c = p[0]; p[0] = p[7]; p[7] = c;
-				c = p[1]; p[1] = p[6]; p[6] = c;
-				c = p[2]; p[2] = p[5]; p[5] = c;
-				c = p[3]; p[3] = p[4]; p[4] = c;
-			#else
-				uint64_t k = *data++;
+				char *c = (char *)&k;
+				char t;
+				t = c[0]; c[0] = c[7]; c[7] = t;
+				t = c[1]; c[1] = c[6]; c[6] = t;
+				t = c[2]; c[2] = c[5]; c[5] = t;
+				t = c[3]; c[3] = c[4]; c[4] = t;
 			#endif
+			return k;
+		}
 
+		inline uint64_t mix_word(uint64_t h, uint64_t k)
+		{
 			k *= m;
 			k ^= k >> r;
 			k *= m;
-			
+
 			h ^= k;
 			h *= m;
+			return h;
+		}
+
+		inline uint64_t mix_tail(uint64_t h, const unsigned char *data2, uint32_t len)
+		{
+			switch(len & 7)
+			{
+			case 7: h ^= uint64_t(data2[6]) << 48;
+				// fall through
+			case 6: h ^= uint64_t(data2[5]) << 40;
+				// fall through
+			case 5: h ^= uint64_t(data2[4]) << 32;
+				// fall through
+			case 4: h ^= uint64_t(data2[3]) << 24;
+				// fall through
+			case 3: h ^= uint64_t(data2[2]) << 16;
+				// fall through
+			case 2: h ^= uint64_t(data2[1]) << 8;
+				// fall through
+			case 1: h ^= uint64_t(data2[0]);
+					h *= m;
+			};
+
+			h ^= h >> r;
+			h *= m;
+			h ^= h >> r;
+
+			return h;
+		}
+	}
+
+	uint64_t murmur_hash_64(const void * key, uint32_t len, uint64_t seed)
+	{
+		uint64_t h = seed ^ (len * m);
+
+		const char * data = (const char *)key;
+		const char * end = data + (len/8)*8;
+
+		while(data != end)
+		{
+			h = mix_word(h, load_64(data));
+			data += 8;
+		}
+
+		return mix_tail(h, (const unsigned char *)data, len);
+	}
+
+	namespace
+	{
+		/// Hashes the tail bytes and finalizes the hash like mix_tail(), but
+		/// reads the tail of keys with at least eight bytes with a single load
+		/// instead of a switch.
+		inline uint64_t batch_finish(uint64_t h, const char *data, uint32_t len)
+		{
+			const uint32_t rem = len & 7;
+			uint64_t tail;
+			if (len >= 8) {
+				// The last eight bytes of the key end with the tail bytes.
+				tail = load_64(data + len - 8) >> ((64 - rem*8) & 63);
+				tail = rem ? tail : 0;
+			} else {
+				const unsigned char *p = (const unsigned char *)data;
+				tail = 0;
+				for (uint32_t k=0; k<len; ++k)
+					tail |= uint64_t(p[k]) << (k*8);
+			}
+			h ^= tail;
+			h = rem ? h * m : h;
+			h ^= h >> r;
+			h *= m;
+			h ^= h >> r;
+			return h;
 		}
 
-		const unsigned char * data2 = (const unsigned char*)data;
+	#if defined(MURMUR_HASH_AVX512)
+		/// Hashes the words of eight keys at a time in the 64 bit lanes of an
+		/// AVX-512 register (AVX-512DQ has the 64 bit multiply). The words are
+		/// gathered with the key pointers as indices. Returns the number of keys
+		/// that were hashed.
+		__attribute__((target("avx512f,avx512dq"))) uint32_t batch_avx512(const void * const *keys, const uint32_t *lens, const uint64_t *seeds, uint64_t *out, uint32_t n)
+		{
+			// The zero-masking forms of the conversion and the shifts are used
+			// with a full mask because the unmasked ones trigger
+			// -Wmaybe-uninitialized in GCC's headers.
+			const __mmask8 all = 0xff;
+			const __m512i mv = _mm512_set1_epi64((long long)m);
+			uint32_t i = 0;
+			for (; i + 8 <= n; i += 8) {
+				const __m512i len = _mm512_maskz_cvtepu32_epi64(all, _mm256_loadu_si256((const __m256i *)(lens + i)));
+				const __m512i seed = seeds ? _mm512_loadu_si512(seeds + i) : _mm512_setzero_si512();
+				__m512i h = _mm512_xor_si512(seed, _mm512_mullo_epi64(len, mv));
+				const __m512i words = _mm512_maskz_srli_epi64(all, len, 3);
+				__m512i ptr = _mm512_loadu_si512(keys + i);
+
+				uint32_t max_words = 0;
+				for (uint32_t j=0; j<8; ++j)
+					max_words = lens[i + j] / 8 > max_words ? lens[i + j] / 8 : max_words;
+				for (uint32_t w=0; w<max_words; ++w) {
+					const __mmask8 active = _mm512_cmpgt_epu64_mask(words, _mm512_set1_epi64((long long)w));
+					__m512i k = _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), active, ptr, (const void *)0, 1);
+					ptr = _mm512_add_epi64(ptr, _mm512_set1_epi64(8));
+					k = _mm512_mullo_epi64(k, mv);
+					k = _mm512_xor_si512(k, _mm512_maskz_srli_epi64(all, k, r));
+					k = _mm512_mullo_epi64(k, mv);
+					h = _mm512_mask_mullo_epi64(h, active, _mm512_xor_si512(h, k), mv);
+				}
+
+				_mm512_storeu_si512(out + i, h);
+				for (uint32_t j=0; j<8; ++j)
+					out[i + j] = batch_finish(out[i + j], (const char *)keys[i + j], lens[i + j]);
+			}
+			return i;
+		}
 
-		switch(len & 7)
+		bool has_avx512()
 		{
-		case 7: h ^= uint64_t(data2[6]) << 48;
-		case 6: h ^= uint64_t(data2[5]) << 40;
-		case 5: h ^= uint64_t(data2[4]) << 32;
-		case 4: h ^= uint64_t(data2[3]) << 24;
-		case 3: h ^= uint64_t(data2[2]) << 16;
-		case 2: h ^= uint64_t(data2[1]) << 8;
-		case 1: h ^= uint64_t(data2[0]);
-				h *= m;
-		};
-		
-		h ^= h >> r;
-		h *= m;
-		h ^= h >> r;
+			return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+		}
+	#endif
+	}
+
+	void murmur_hash_64_batch(const void * const *keys, const uint32_t *lens, const uint64_t *seeds, uint64_t *out, uint32_t n)
+	{
+		const uint32_t LANES = 4;
+
+		uint32_t i = 0;
+	#if defined(MURMUR_HASH_AVX512) && !defined(PLATFORM_BIG_ENDIAN)
+		static const bool avx512 = has_avx512();
+		if (avx512)
+			i = batch_avx512(keys, lens, seeds, out, n);
+	#endif
+
+		for (; i + LANES <= n; i += LANES) {
+			// The keys are hashed in lock step, so the multiplies of different
+			// keys overlap. Keys that are out of words keep their hash value
+			// through a select instead of a branch, since branches on random
+			// key lengths are mispredicted.
+			uint64_t h[LANES];
+			const char *data[LANES];
+			uint32_t words[LANES];
+			uint32_t max_words = 0;
+			for (uint32_t j=0; j<LANES; ++j) {
+				h[j] = (seeds ? seeds[i + j] : 0) ^ (lens[i + j] * m);
+				data[j] = (const char *)keys[i + j];
+				words[j] = lens[i + j] / 8;
+				max_words = words[j] > max_words ? words[j] : max_words;
+			}
+			// Lanes that are out of words read a local zero word instead, since
+			// their keys may be shorter than a word (or null, if empty).
+			static const uint64_t zero = 0;
+			for (uint32_t w=0; w<max_words; ++w) {
+				for (uint32_t j=0; j<LANES; ++j) {
+					const bool active = w < words[j];
+					const char *word = active ? data[j] + w*8 : (const char *)&zero;
+					const uint64_t mixed = mix_word(h[j], load_64(word));
+					h[j] = active ? mixed : h[j];
+				}
+			}
+			for (uint32_t j=0; j<LANES; ++j)
+				out[i + j] = batch_finish(h[j], data[j], lens[i + j]);
+		}
 
-		return h;
+		for (; i < n; ++i)
+			out[i] = murmur_hash_64(keys[i], lens[i], seeds ? seeds[i] : 0);
+	}
+
+	namespace murmur_hash
+	{
+		void init(MurmurHash64State &s, uint64_t seed, uint32_t len)
+		{
+			s._h = seed ^ (len * m);
+			s._len = len;
+			s._processed = 0;
+			s._buffered = 0;
+		}
+
+		void update(MurmurHash64State &s, const void *data, uint32_t n)
+		{
+			const char *p = (const char *)data;
+			const char *end = p + n;
+			s._processed += n;
+
+			// Complete a word that was started by a previous update.
+			if (s._buffered) {
+				while (s._buffered < 8 && p != end)
+					s._buffer[s._buffered++] = *p++;
+				if (s._buffered < 8)
+					return;
+				s._h = mix_word(s._h, load_64(s._buffer));
+				s._buffered = 0;
+			}
+
+			const char *words_end = p + ((end - p) / 8) * 8;
+			uint64_t h = s._h;
+			while (p != words_end) {
+				h = mix_word(h, load_64(p));
+				p += 8;
+			}
+			s._h = h;
+
+			while (p != end)
+				s._buffer[s._buffered++] = *p++;
+		}
+
+		uint64_t finish(MurmurHash64State &s)
+		{
+			assert(s._processed == s._len);
+			return mix_tail(s._h, (const unsigned char *)s._buffer, s._buffered);
+		}
 	}
 }
\ No newline at end of file
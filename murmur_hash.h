@@ -7,4 +7,149 @@ namespace foundation
 	/// Implementation of the 64 bit MurmurHash2 function
 	/// http://murmurhash.googlepages.com/
 	uint64_t murmur_hash_64(const void *key, uint32_t len, uint64_t seed);
+
+	/// Computes out[i] = murmur_hash_64(keys[i], lens[i], seeds[i]) for n keys.
+	/// If seeds is 0, all keys are hashed with seed 0. Hashing several keys at
+	/// once interleaves their independent multiply chains, which is much faster
+	/// than calling murmur_hash_64() for each key when the keys are short. The
+	/// output can be passed directly to hash::set_many() or hash::get_many().
+	void murmur_hash_64_batch(const void * const *keys, const uint32_t *lens, const uint64_t *seeds, uint64_t *out, uint32_t n);
+
+	/// State for computing murmur_hash_64() incrementally, see the
+	/// murmur_hash namespace.
+	struct MurmurHash64State
+	{
+		uint64_t _h;
+		uint32_t _len;
+		uint32_t _processed;
+		uint32_t _buffered;
+		char _buffer[8];
+	};
+
+	/// Computes murmur_hash_64() of data that arrives in chunks, without
+	/// concatenating the chunks. The result is identical to hashing all the
+	/// data at once with murmur_hash_64().
+	///
+	/// MurmurHash2 mixes the total length into the initial hash value, so the
+	/// total length must be known when the hash is started. (To hash a stream
+	/// of unknown length, use a different hash function.)
+	namespace murmur_hash
+	{
+		/// Starts hashing len bytes of data with the specified seed.
+		void init(MurmurHash64State &s, uint64_t seed, uint32_t len);
+
+		/// Hashes the next n bytes of data. The chunks can have any size.
+		void update(MurmurHash64State &s, const void *data, uint32_t n);
+
+		/// Returns the hash. Exactly len bytes must have been passed to
+		/// update().
+		uint64_t finish(MurmurHash64State &s);
+	}
+
+	/// constexpr version of murmur_hash_64() that gives bit for bit the same
+	/// result. It reads the data byte by byte, so use it for strings that are
+	/// known at compile time and murmur_hash_64() for everything else.
+	constexpr uint64_t murmur_hash_64_constexpr(const char *key, uint32_t len, uint64_t seed);
+
+	namespace murmur_hash_internal
+	{
+		/// Returns the number of characters before the first NUL in the array
+		/// of n characters, or n if there is none.
+		constexpr uint32_t string_length(const char *s, uint32_t n)
+		{
+			uint32_t len = 0;
+			while (len < n && s[len])
+				++len;
+			return len;
+		}
+	}
+
+	/// A 64 bit string ID, the murmur_hash_64() of the string with seed 0.
+	///
+	/// IDs can be constructed from constant character arrays, such as string
+	/// literals. The string ends at the first NUL in the array (like with
+	/// strlen()), and the hash is computed at compile time. (Declare the
+	/// IdString64 constexpr to guarantee that.) Non-const arrays are rejected,
+	/// since they are buffers whose content is only known at runtime. Use the
+	/// (s, len) constructor for those.
+	struct IdString64
+	{
+		constexpr IdString64() : id(0) {}
+		constexpr explicit IdString64(uint64_t id) : id(id) {}
+		template <uint32_t N> constexpr explicit IdString64(const char (&s)[N])
+			: id(murmur_hash_64_constexpr(s, murmur_hash_internal::string_length(s, N), 0)) {}
+		template <uint32_t N> IdString64(char (&s)[N]) = delete;
+		IdString64(const char *s, uint32_t len) : id(murmur_hash_64(s, len, 0)) {}
+
+		uint64_t id;
+	};
+
+	constexpr bool operator==(IdString64 a, IdString64 b) {return a.id == b.id;}
+	constexpr bool operator!=(IdString64 a, IdString64 b) {return a.id != b.id;}
+	constexpr bool operator<(IdString64 a, IdString64 b) {return a.id < b.id;}
+
+	namespace murmur_hash_internal
+	{
+		/// Reads a little endian 64 bit word, which is what murmur_hash_64()
+		/// reads on both little and big endian platforms.
+		constexpr uint64_t load_64(const char *p)
+		{
+			return uint64_t((unsigned char)p[0])
+				| uint64_t((unsigned char)p[1]) << 8
+				| uint64_t((unsigned char)p[2]) << 16
+				| uint64_t((unsigned char)p[3]) << 24
+				| uint64_t((unsigned char)p[4]) << 32
+				| uint64_t((unsigned char)p[5]) << 40
+				| uint64_t((unsigned char)p[6]) << 48
+				| uint64_t((unsigned char)p[7]) << 56;
+		}
+	}
+
+	constexpr uint64_t murmur_hash_64_constexpr(const char *key, uint32_t len, uint64_t seed)
+	{
+		const uint64_t m = 0xc6a4a7935bd1e995ULL;
+		const uint32_t r = 47;
+
+		uint64_t h = seed ^ (len * m);
+
+		const char *data = key;
+		const char *end = data + (len/8)*8;
+
+		while (data != end)
+		{
+			uint64_t k = murmur_hash_internal::load_64(data);
+			data += 8;
+
+			k *= m;
+			k ^= k >> r;
+			k *= m;
+
+			h ^= k;
+			h *= m;
+		}
+
+		switch (len & 7)
+		{
+		case 7: h ^= uint64_t((unsigned char)data[6]) << 48;
+			// fall through
+		case 6: h ^= uint64_t((unsigned char)data[5]) << 40;
+			// fall through
+		case 5: h ^= uint64_t((unsigned char)data[4]) << 32;
+			// fall through
+		case 4: h ^= uint64_t((unsigned char)data[3]) << 24;
+			// fall through
+		case 3: h ^= uint64_t((unsigned char)data[2]) << 16;
+			// fall through
+		case 2: h ^= uint64_t((unsigned char)data[1]) << 8;
+			// fall through
+		case 1: h ^= uint64_t((unsigned char)data[0]);
+				h *= m;
+		};
+
+		h ^= h >> r;
+		h *= m;
+		h ^= h >> r;
+
+		return h;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "collection_types.h"
+#include "array.h"
+
+namespace foundation
+{
+	namespace priority_queue
+	{
+		/// Returns the number of items in the queue.
+		template<typename T> uint32_t size(const PriorityQueue<T> &q);
+		/// Returns true if the queue is empty.
+		template<typename T> bool empty(const PriorityQueue<T> &q);
+		/// Makes sure the queue has room for at least the specified number of items.
+		template<typename T> void reserve(PriorityQueue<T> &q, uint32_t size);
+		/// Removes all items from the queue (does not free memory).
+		template<typename T> void clear(PriorityQueue<T> &q);
+
+		/// Returns the smallest item in the queue. The queue cannot be empty.
+		template<typename T> const T &top(const PriorityQueue<T> &q);
+
+		/// Pushes the item to the queue.
+		template<typename T> void push(PriorityQueue<T> &q, const T &item);
+		/// Pushes n items to the queue. If the batch is large compared to the
+		/// size of the queue, the heap is rebuilt in O(size + n) instead of
+		/// pushing the items one by one.
+		template<typename T> void push(PriorityQueue<T> &q, const T *items, uint32_t n);
+		/// Pops the smallest item from the queue. The queue cannot be empty.
+		template<typename T> void pop(PriorityQueue<T> &q);
+
+		/// Replaces the content of the queue with the n items and arranges them
+		/// into a heap in O(n).
+		template<typename T> void heapify(PriorityQueue<T> &q, const T *items, uint32_t n);
+	}
+
+	namespace priority_queue_internal
+	{
+		/// Number of children of each node in the heap. A 4-ary heap is shallower
+		/// than a binary heap and the children of a node share a cache line.
+		const uint32_t ARITY = 4;
+
+		template<typename T> void sift_up(T *data, uint32_t i)
+		{
+			const T item = data[i];
+			while (i > 0) {
+				const uint32_t parent = (i - 1) / ARITY;
+				if (!(item < data[parent]))
+					break;
+				data[i] = data[parent];
+				i = parent;
+			}
+			data[i] = item;
+		}
+
+		template<typename T> void sift_down(T *data, uint32_t n, uint32_t i)
+		{
+			const T item = data[i];
+			while (true) {
+				const uint32_t first = i * ARITY + 1;
+				if (first >= n)
+					break;
+				const uint32_t last = first + ARITY < n ? first + ARITY : n;
+				uint32_t smallest = first;
+				for (uint32_t c = first + 1; c < last; ++c) {
+					if (data[c] < data[smallest])
+						smallest = c;
+				}
+				if (!(data[smallest] < item))
+					break;
+				data[i] = data[smallest];
+				i = smallest;
+			}
+			data[i] = item;
+		}
+
+		template<typename T> void build(T *data, uint32_t n)
+		{
+			if (n < 2)
+				return;
+			for (uint32_t i = (n - 2) / ARITY + 1; i-- > 0; )
+				sift_down(data, n, i);
+		}
+	}
+
+	namespace priority_queue
+	{
+		template<typename T> inline uint32_t size(const PriorityQueue<T> &q)
+		{
+			return array::size(q._data);
+		}
+
+		template<typename T> inline bool empty(const PriorityQueue<T> &q)
+		{
+			return array::empty(q._data);
+		}
+
+		template<typename T> inline void reserve(PriorityQueue<T> &q, uint32_t size)
+		{
+			array::reserve(q._data, size);
+		}
+
+		template<typename T> inline void clear(PriorityQueue<T> &q)
+		{
+			array::clear(q._data);
+		}
+
+		template<typename T> inline const T &top(const PriorityQueue<T> &q)
+		{
+			return array::front(q._data);
+		}
+
+		template<typename T> inline void push(PriorityQueue<T> &q, const T &item)
+		{
+			array::push_back(q._data, item);
+			priority_queue_internal::sift_up(array::begin(q._data), array::size(q._data) - 1);
+		}
+
+		template<typename T> void push(PriorityQueue<T> &q, const T *items, uint32_t n)
+		{
+			const uint32_t old_size = array::size(q._data);
+			array::resize(q._data, old_size + n);
+			T *data = array::begin(q._data);
+			memcpy(data + old_size, items, n * sizeof(T));
+
+			// Pushing one at a time costs O(n log(size)), rebuilding costs
+			// O(size + n). Rebuild when the batch is a sizeable fraction of
+			// the queue.
+			if (n > old_size / 8)
+				priority_queue_internal::build(data, old_size + n);
+			else {
+				for (uint32_t i = old_size; i < old_size + n; ++i)
+					priority_queue_internal::sift_up(data, i);
+			}
+		}
+
+		template<typename T> inline void pop(PriorityQueue<T> &q)
+		{
+			const uint32_t n = array::size(q._data) - 1;
+			q._data[0] = q._data[n];
+			array::pop_back(q._data);
+			if (n > 1)
+				priority_queue_internal::sift_down(array::begin(q._data), n, 0);
+		}
+
+		template<typename T> void heapify(PriorityQueue<T> &q, const T *items, uint32_t n)
+		{
+			array::resize(q._data, n);
+			memcpy(array::begin(q._data), items, n * sizeof(T));
+			priority_queue_internal::build(array::begin(q._data), n);
+		}
+	}
+
+	template <typename T> inline PriorityQueue<T>::PriorityQueue(Allocator &a) : _data(a) {}
+}
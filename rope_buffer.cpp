@@ -0,0 +1,231 @@
+#include "rope_buffer.h"
+#include "memory.h"
+
+#include <stdarg.h>
+#include <errno.h>
+
+#if defined(_WIN32)
+	#include <io.h>
+#else
+	#include <unistd.h>
+	#include <limits.h>
+	#include <sys/uio.h>
+#endif
+
+namespace foundation
+{
+	namespace
+	{
+		void add_chunk(RopeBuffer &r, uint32_t min_capacity)
+		{
+			RopeBuffer::Chunk c;
+			c.capacity = min_capacity > r._chunk_size ? min_capacity : r._chunk_size;
+			c.data = (char *)r._allocator->allocate(c.capacity, 1);
+			c.size = 0;
+			array::push_back(r._chunks, c);
+		}
+
+	#if defined(_WIN32)
+		/// Writes n bytes, retrying after partial writes. (There is no writev()
+		/// on Windows.)
+		bool write_all(int fd, const char *data, uint32_t n)
+		{
+			while (n > 0) {
+				const int written = _write(fd, data, n);
+				if (written <= 0)
+					return false;
+				data += written;
+				n -= written;
+			}
+			return true;
+		}
+	#endif
+	}
+
+	namespace rope_buffer_internal
+	{
+		char *reserve(RopeBuffer &r, uint32_t n)
+		{
+			const uint32_t num = array::size(r._chunks);
+			if (num == 0 || r._chunks[num - 1].capacity - r._chunks[num - 1].size < n)
+				add_chunk(r, n);
+			RopeBuffer::Chunk &c = array::back(r._chunks);
+			return c.data + c.size;
+		}
+	}
+
+	namespace rope_buffer
+	{
+		RopeBuffer & printf(RopeBuffer &r, const char *format, ...)
+		{
+			// Try to print into the space left in the current chunk first, so
+			// that the format is usually only parsed once.
+			uint32_t available = 0;
+			if (array::size(r._chunks))
+				available = array::back(r._chunks).capacity - array::back(r._chunks).size;
+			char *p = available ? rope_buffer_internal::reserve(r, available) : 0;
+
+			va_list args;
+			va_start(args, format);
+			const int n = vsnprintf(p, available, format, args);
+			va_end(args);
+			if (n < 0)
+				return r;
+			if ((uint32_t)n < available) {
+				rope_buffer_internal::commit(r, n);
+				return r;
+			}
+
+			p = rope_buffer_internal::reserve(r, n + 1);
+			va_start(args, format);
+			vsnprintf(p, n + 1, format, args);
+			va_end(args);
+			rope_buffer_internal::commit(r, n);
+			return r;
+		}
+
+		RopeBuffer & push(RopeBuffer &r, const char *data, uint32_t n)
+		{
+			// Fill up the current chunk, then continue in new chunks.
+			while (n > 0) {
+				uint32_t available = 0;
+				if (array::size(r._chunks))
+					available = array::back(r._chunks).capacity - array::back(r._chunks).size;
+				if (available == 0)
+					available = r._chunk_size;
+				const uint32_t part = n < available ? n : available;
+				memcpy(rope_buffer_internal::reserve(r, part), data, part);
+				rope_buffer_internal::commit(r, part);
+				data += part;
+				n -= part;
+			}
+			return r;
+		}
+
+		RopeBuffer & tab(RopeBuffer &r, uint32_t column)
+		{
+			uint32_t current_column = 0;
+			for (uint32_t i = array::size(r._chunks); i-- > 0; ) {
+				const RopeBuffer::Chunk &c = r._chunks[i];
+				uint32_t j = c.size;
+				while (j > 0 && c.data[j-1] != '\n' && c.data[j-1] != '\r') {
+					++current_column;
+					--j;
+				}
+				if (j > 0)
+					break;
+			}
+			if (current_column < column)
+				repeat(r, column - current_column, ' ');
+			return r;
+		}
+
+		RopeBuffer & repeat(RopeBuffer &r, uint32_t count, char c)
+		{
+			while (count > 0) {
+				uint32_t available = 0;
+				if (array::size(r._chunks))
+					available = array::back(r._chunks).capacity - array::back(r._chunks).size;
+				if (available == 0)
+					available = r._chunk_size;
+				const uint32_t part = count < available ? count : available;
+				memset(rope_buffer_internal::reserve(r, part), c, part);
+				rope_buffer_internal::commit(r, part);
+				count -= part;
+			}
+			return r;
+		}
+
+		void clear(RopeBuffer &r)
+		{
+			// Oversized chunks are not kept, so that a single large write doesn't
+			// hold on to its memory.
+			const bool keep_first = array::size(r._chunks) && r._chunks[0].capacity == r._chunk_size;
+			for (uint32_t i = keep_first ? 1 : 0; i<array::size(r._chunks); ++i)
+				r._allocator->deallocate(r._chunks[i].data);
+			array::resize(r._chunks, keep_first ? 1 : 0);
+			if (keep_first)
+				r._chunks[0].size = 0;
+			r._size = 0;
+		}
+
+		void copy(const RopeBuffer &r, Array<char> &a)
+		{
+			uint32_t end = array::size(a);
+			array::resize(a, end + (uint32_t)r._size);
+			for (uint32_t i=0; i<array::size(r._chunks); ++i) {
+				memcpy(array::begin(a) + end, r._chunks[i].data, r._chunks[i].size);
+				end += r._chunks[i].size;
+			}
+		}
+
+		bool write(const RopeBuffer &r, int fd)
+		{
+		#if defined(_WIN32)
+			for (uint32_t i=0; i<array::size(r._chunks); ++i) {
+				if (!write_all(fd, r._chunks[i].data, r._chunks[i].size))
+					return false;
+			}
+			return true;
+		#else
+			#if defined(IOV_MAX)
+				const uint32_t MAX_IOV = IOV_MAX < 1024 ? IOV_MAX : 1024;
+			#else
+				const uint32_t MAX_IOV = 16;
+			#endif
+			struct iovec iov[MAX_IOV];
+
+			uint32_t chunk = 0;
+			uint32_t offset = 0;
+			const uint32_t num = array::size(r._chunks);
+			while (true) {
+				// Gather the remaining chunks, starting from the middle of a chunk
+				// after a partial write.
+				uint32_t n = 0;
+				for (uint32_t i = chunk; i < num && n < MAX_IOV; ++i) {
+					const uint32_t start = i == chunk ? offset : 0;
+					if (r._chunks[i].size == start)
+						continue;
+					iov[n].iov_base = r._chunks[i].data + start;
+					iov[n].iov_len = r._chunks[i].size - start;
+					++n;
+				}
+				if (n == 0)
+					return true;
+
+				const ssize_t written = writev(fd, iov, n);
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return false;
+
+				// Skip past what was written.
+				uint64_t skip = (uint64_t)written;
+				while (chunk < num && skip >= r._chunks[chunk].size - offset) {
+					skip -= r._chunks[chunk].size - offset;
+					++chunk;
+					offset = 0;
+				}
+				offset += (uint32_t)skip;
+			}
+		#endif
+		}
+
+		bool flush(RopeBuffer &r, int fd)
+		{
+			const bool ok = write(r, fd);
+			clear(r);
+			return ok;
+		}
+	}
+
+	RopeBuffer::RopeBuffer(Allocator &a, uint32_t chunk_size) :
+		_allocator(&a), _chunk_size(chunk_size), _size(0), _chunks(a)
+	{}
+
+	RopeBuffer::~RopeBuffer()
+	{
+		for (uint32_t i=0; i<array::size(_chunks); ++i)
+			_allocator->deallocate(_chunks[i].data);
+	}
+}
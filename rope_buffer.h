@@ -0,0 +1,134 @@
+#pragma once
+
+#include "collection_types.h"
+#include "string_stream.h"
+
+namespace foundation
+{
+	/// The rope buffer supports the same writing functions as string_stream,
+	/// but the text is stored in chunks of chunk_size bytes from the
+	/// allocator. When a chunk is full, a new chunk is started, so the text
+	/// written so far is never copied. Formatted values are never split
+	/// between chunks, so a chunk can end before it is full. (A single write
+	/// larger than the chunk size gets a chunk of its own.)
+	///
+	/// The text is never flattened into one string. Instead, write() sends
+	/// the chunks to a file descriptor with writev(). Calling flush() now and
+	/// then while building a large dump keeps the memory use bounded.
+	namespace rope_buffer
+	{
+		/// Dumps the item to the buffer, formatted like string_stream does.
+		RopeBuffer & operator<<(RopeBuffer &r, char c);
+		RopeBuffer & operator<<(RopeBuffer &r, const char *s);
+		RopeBuffer & operator<<(RopeBuffer &r, float f);
+		RopeBuffer & operator<<(RopeBuffer &r, int32_t i);
+		RopeBuffer & operator<<(RopeBuffer &r, uint32_t i);
+		RopeBuffer & operator<<(RopeBuffer &r, uint64_t i);
+
+		/// Uses printf to print formatted data to the buffer.
+		RopeBuffer & printf(RopeBuffer &r, const char *format, ...);
+
+		/// Like string_stream::format().
+		template <typename F, typename... Args> RopeBuffer & format(RopeBuffer &r, F format_string, const Args &... args);
+
+		/// Pushes the raw data to the buffer.
+		RopeBuffer & push(RopeBuffer &r, const char *data, uint32_t n);
+
+		/// Pads the buffer with spaces until it is aligned at the specified
+		/// column, like string_stream::tab().
+		RopeBuffer & tab(RopeBuffer &r, uint32_t column);
+
+		/// Adds the specified number of c to the buffer.
+		RopeBuffer & repeat(RopeBuffer &r, uint32_t count, char c);
+
+		/// Returns the number of characters in the buffer.
+		uint64_t size(const RopeBuffer &r);
+
+		/// Returns the number of chunks in the buffer.
+		uint32_t num_chunks(const RopeBuffer &r);
+
+		/// Removes all text from the buffer. The first chunk is kept for reuse,
+		/// the others are freed.
+		void clear(RopeBuffer &r);
+
+		/// Appends the text in the buffer to the array. (Use it for small
+		/// buffers, large buffers should be written with write().)
+		void copy(const RopeBuffer &r, Array<char> &a);
+
+		/// Writes the text in the buffer to the file descriptor, with as few
+		/// writev() calls as possible. Returns false if writing failed.
+		bool write(const RopeBuffer &r, int fd);
+
+		/// Writes the text to the file descriptor and clears the buffer.
+		bool flush(RopeBuffer &r, int fd);
+	}
+
+	namespace rope_buffer_internal
+	{
+		/// Returns a pointer to n bytes of contiguous space at the end of the
+		/// buffer. Call commit() with the number of bytes that were used.
+		char *reserve(RopeBuffer &r, uint32_t n);
+
+		inline void commit(RopeBuffer &r, uint32_t n)
+		{
+			array::back(r._chunks).size += n;
+			r._size += n;
+		}
+	}
+
+	namespace rope_buffer
+	{
+		inline RopeBuffer & operator<<(RopeBuffer &r, char c)
+		{
+			*rope_buffer_internal::reserve(r, 1) = c;
+			rope_buffer_internal::commit(r, 1);
+			return r;
+		}
+
+		inline RopeBuffer & operator<<(RopeBuffer &r, const char *s)
+		{
+			return push(r, s, (uint32_t)strlen(s));
+		}
+
+		inline RopeBuffer & operator<<(RopeBuffer &r, float f)
+		{
+			using namespace string_stream_internal;
+			rope_buffer_internal::commit(r, format_float(rope_buffer_internal::reserve(r, MAX_NUMBER_LENGTH), f));
+			return r;
+		}
+
+		inline RopeBuffer & operator<<(RopeBuffer &r, int32_t i)
+		{
+			using namespace string_stream_internal;
+			rope_buffer_internal::commit(r, format_int32(rope_buffer_internal::reserve(r, MAX_NUMBER_LENGTH), i));
+			return r;
+		}
+
+		inline RopeBuffer & operator<<(RopeBuffer &r, uint32_t i)
+		{
+			using namespace string_stream_internal;
+			rope_buffer_internal::commit(r, format_uint32(rope_buffer_internal::reserve(r, MAX_NUMBER_LENGTH), i));
+			return r;
+		}
+
+		inline RopeBuffer & operator<<(RopeBuffer &r, uint64_t i)
+		{
+			using namespace string_stream_internal;
+			rope_buffer_internal::commit(r, format_hex64(rope_buffer_internal::reserve(r, MAX_NUMBER_LENGTH), i));
+			return r;
+		}
+
+		template <typename F, typename... Args> RopeBuffer & format(RopeBuffer &r, F, const Args &... args)
+		{
+			using namespace string_stream_internal;
+			const auto &parsed = parsed_format<F, sizeof...(Args)>();
+			const FormatArg format_args[] = {format_arg(args)..., format_arg('\0')};
+			char *p = rope_buffer_internal::reserve(r, format_length(parsed.literal_length, format_args, sizeof...(Args)));
+			rope_buffer_internal::commit(r, write_format(p, F::string(), parsed.segments, parsed.num_segments, format_args));
+			return r;
+		}
+
+		inline uint64_t size(const RopeBuffer &r) {return r._size;}
+		inline uint32_t num_chunks(const RopeBuffer &r) {return array::size(r._chunks);}
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "types.h"
+
+/// FOUNDATION_SSE2 is defined when SSE2 can be used without checking the
+/// CPU (always on x86-64). Code that uses it must have a scalar fallback.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define FOUNDATION_SSE2
+#endif
+
+namespace foundation
+{
+	namespace simd_internal
+	{
+		/// Returns the index of the lowest set bit in mask, such as the first
+		/// matching byte in a _mm_movemask_epi8() mask. mask can't be 0.
+		inline uint32_t lowest_bit(uint32_t mask)
+		{
+		#if defined(__GNUC__)
+			return __builtin_ctz(mask);
+		#else
+			uint32_t i = 0;
+			while (!(mask & 1)) {
+				mask >>= 1;
+				++i;
+			}
+			return i;
+		#endif
+		}
+	}
+}
@@ -0,0 +1,755 @@
+#include "sjson.h"
+#include "hash.h"
+#include "simd.h"
+#include "string_reader.h"
+#include "string_stream.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace foundation
+{
+	namespace
+	{
+		const uint32_t MAX_DEPTH = 256;
+		const uint32_t NO_KEY = 0xffffffffu;
+
+		inline bool is_whitespace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		}
+
+		inline bool is_key_char(char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+		}
+
+
+		/// Returns the first character in [p, end) that isn't whitespace.
+		/// Indentation is skipped 16 characters at a time.
+		inline const char *skip_whitespace(const char *p, const char *end)
+		{
+			if (p == end || !is_whitespace(*p))
+				return p;
+		#if defined(FOUNDATION_SSE2)
+			for (; end - p >= 16; p += 16) {
+				const __m128i v = _mm_loadu_si128((const __m128i *)p);
+				const __m128i space = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+					_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+				const uint32_t mask = ~(uint32_t)_mm_movemask_epi8(space) & 0xffff;
+				if (mask)
+					return p + simd_internal::lowest_bit(mask);
+			}
+		#endif
+			while (p != end && is_whitespace(*p))
+				++p;
+			return p;
+		}
+
+		/// Returns the first '"' or '\\' in [p, end), or end. String contents
+		/// are scanned 16 characters at a time.
+		inline const char *find_quote_or_escape(const char *p, const char *end)
+		{
+		#if defined(FOUNDATION_SSE2)
+			const __m128i quote = _mm_set1_epi8('"');
+			const __m128i backslash = _mm_set1_epi8('\\');
+			for (; end - p >= 16; p += 16) {
+				const __m128i v = _mm_loadu_si128((const __m128i *)p);
+				const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+				if (mask)
+					return p + simd_internal::lowest_bit(mask);
+			}
+		#endif
+			while (p != end && *p != '"' && *p != '\\')
+				++p;
+			return p;
+		}
+
+		inline uint32_t hex_digit(char c)
+		{
+			if (c >= '0' && c <= '9') return c - '0';
+			if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+			if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+			return 16;
+		}
+
+		void push_utf8(Array<char> &a, uint32_t c)
+		{
+			if (c < 0x80) {
+				array::push_back(a, (char)c);
+			} else if (c < 0x800) {
+				array::push_back(a, (char)(0xc0 | (c >> 6)));
+				array::push_back(a, (char)(0x80 | (c & 0x3f)));
+			} else if (c < 0x10000) {
+				array::push_back(a, (char)(0xe0 | (c >> 12)));
+				array::push_back(a, (char)(0x80 | ((c >> 6) & 0x3f)));
+				array::push_back(a, (char)(0x80 | (c & 0x3f)));
+			} else {
+				array::push_back(a, (char)(0xf0 | (c >> 18)));
+				array::push_back(a, (char)(0x80 | ((c >> 12) & 0x3f)));
+				array::push_back(a, (char)(0x80 | ((c >> 6) & 0x3f)));
+				array::push_back(a, (char)(0x80 | (c & 0x3f)));
+			}
+		}
+
+		struct Parser
+		{
+			SjsonDocument &d;
+			const char *start;
+			const char *p;
+			const char *end;
+			uint32_t depth;
+		};
+
+		bool fail(Parser &ps, const char *error)
+		{
+			if (!ps.d._error) {
+				ps.d._error = error;
+				ps.d._error_line = 1;
+				for (const char *q = ps.start; q < ps.p; ++q)
+					ps.d._error_line += *q == '\n';
+			}
+			return false;
+		}
+
+		/// Skips whitespace and comments.
+		bool skip_space(Parser &ps)
+		{
+			while (true) {
+				ps.p = skip_whitespace(ps.p, ps.end);
+				if (ps.end - ps.p < 2 || ps.p[0] != '/')
+					return true;
+				if (ps.p[1] == '/') {
+					ps.p = string_reader_internal::find(ps.p, ps.end, '\n');
+				} else if (ps.p[1] == '*') {
+					const char *q = ps.p + 2;
+					while (true) {
+						q = string_reader_internal::find(q, ps.end, '*');
+						if (ps.end - q < 2)
+							return fail(ps, "unterminated comment");
+						if (q[1] == '/')
+							break;
+						++q;
+					}
+					ps.p = q + 2;
+				} else {
+					return true;
+				}
+			}
+		}
+
+		/// Parses the string at ps.p, which starts with a quote, into the
+		/// document's strings.
+		bool parse_string(Parser &ps, uint32_t &offset, uint32_t &length)
+		{
+			Array<char> &strings = ps.d._strings;
+			offset = array::size(strings);
+
+			if (ps.end - ps.p >= 3 && ps.p[1] == '"' && ps.p[2] == '"') {
+				// A raw string ends at the first """.
+				const char *q = ps.p + 3;
+				while (true) {
+					q = string_reader_internal::find(q, ps.end, '"');
+					if (ps.end - q < 3)
+						return fail(ps, "unterminated raw string");
+					if (q[1] == '"' && q[2] == '"')
+						break;
+					++q;
+				}
+				string_stream::push(strings, ps.p + 3, (uint32_t)(q - ps.p - 3));
+				ps.p = q + 3;
+			} else {
+				const char *p = ps.p + 1;
+				while (true) {
+					const char *q = find_quote_or_escape(p, ps.end);
+					string_stream::push(strings, p, (uint32_t)(q - p));
+					if (q == ps.end) {
+						ps.p = q;
+						return fail(ps, "unterminated string");
+					}
+					if (*q == '"') {
+						p = q + 1;
+						break;
+					}
+					if (ps.end - q < 2) {
+						ps.p = q;
+						return fail(ps, "unterminated string");
+					}
+					p = q + 2;
+					switch (q[1]) {
+						case '"': array::push_back(strings, '"'); break;
+						case '\\': array::push_back(strings, '\\'); break;
+						case '/': array::push_back(strings, '/'); break;
+						case 'b': array::push_back(strings, '\b'); break;
+						case 'f': array::push_back(strings, '\f'); break;
+						case 'n': array::push_back(strings, '\n'); break;
+						case 'r': array::push_back(strings, '\r'); break;
+						case 't': array::push_back(strings, '\t'); break;
+						case 'u': {
+							uint32_t c = 0;
+							for (uint32_t i=0; i<4; ++i) {
+								const uint32_t h = p + i < ps.end ? hex_digit(p[i]) : 16;
+								if (h == 16) {
+									ps.p = q;
+									return fail(ps, "invalid \\u escape");
+								}
+								c = c * 16 + h;
+							}
+							p += 4;
+							// A surrogate pair encodes a character outside the BMP.
+							// Lone surrogates can't be encoded as UTF-8 and are
+							// replaced with U+FFFD.
+							if (c >= 0xd800 && c < 0xe000) {
+								uint32_t low = 0;
+								if (c < 0xdc00 && ps.end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+									for (uint32_t i=0; i<4; ++i) {
+										const uint32_t h = hex_digit(p[2 + i]);
+										if (h == 16) {
+											ps.p = p;
+											return fail(ps, "invalid \\u escape");
+										}
+										low = low * 16 + h;
+									}
+								}
+								if (low >= 0xdc00 && low < 0xe000) {
+									c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+									p += 6;
+								} else {
+									c = 0xfffd;
+								}
+							}
+							push_utf8(strings, c);
+							break;
+						}
+						default:
+							ps.p = q;
+							return fail(ps, "invalid escape");
+					}
+				}
+				ps.p = p;
+			}
+
+			length = array::size(strings) - offset;
+			array::push_back(strings, '\0');
+			return true;
+		}
+
+		bool parse_key(Parser &ps, uint64_t &key, uint32_t &offset)
+		{
+			uint32_t length;
+			if (*ps.p == '"') {
+				if (!parse_string(ps, offset, length))
+					return false;
+			} else {
+				const char *q = ps.p;
+				while (q != ps.end && is_key_char(*q))
+					++q;
+				if (q == ps.p)
+					return fail(ps, "expected a key");
+				offset = array::size(ps.d._strings);
+				length = (uint32_t)(q - ps.p);
+				string_stream::push(ps.d._strings, ps.p, length);
+				array::push_back(ps.d._strings, '\0');
+				ps.p = q;
+			}
+			key = murmur_hash_64(array::begin(ps.d._strings) + offset, length, 0);
+
+			if (!skip_space(ps))
+				return false;
+			if (ps.p == ps.end || (*ps.p != '=' && *ps.p != ':'))
+				return fail(ps, "expected = or : after key");
+			++ps.p;
+			return true;
+		}
+
+		inline bool matches(const Parser &ps, const char *word, uint32_t n)
+		{
+			return (uint32_t)(ps.end - ps.p) >= n && memcmp(ps.p, word, n) == 0
+				&& (ps.p + n == ps.end || !is_key_char(ps.p[n]));
+		}
+
+		bool parse_value(Parser &ps, uint64_t key, uint32_t key_offset);
+
+		/// Parses the members of the object up to the close character (0 for
+		/// the root object, which ends at the end of the text).
+		bool parse_members(Parser &ps, uint32_t object, char close)
+		{
+			while (true) {
+				if (!skip_space(ps))
+					return false;
+				if (ps.p == ps.end) {
+					if (close)
+						return fail(ps, "unterminated object");
+					break;
+				}
+				if (close && *ps.p == close) {
+					++ps.p;
+					break;
+				}
+
+				uint64_t key;
+				uint32_t key_offset;
+				if (!parse_key(ps, key, key_offset))
+					return false;
+				if (!parse_value(ps, key, key_offset))
+					return false;
+				++ps.d._nodes[object].count;
+
+				if (!skip_space(ps))
+					return false;
+				if (ps.p != ps.end && *ps.p == ',')
+					++ps.p;
+			}
+
+			// Members of small objects are found by comparing the key hashes
+			// of the members, which is faster than a lookup in a large hash.
+			if (ps.d._nodes[object].count > sjson_internal::MAX_UNHASHED_MEMBERS) {
+				for (uint32_t i = object + 1; i != array::size(ps.d._nodes); i = ps.d._nodes[i].next)
+					hash::set(ps.d._keys, sjson_internal::member_key(object, ps.d._nodes[i].key), i);
+			}
+			return true;
+		}
+
+		bool parse_elements(Parser &ps, uint32_t a)
+		{
+			while (true) {
+				if (!skip_space(ps))
+					return false;
+				if (ps.p == ps.end)
+					return fail(ps, "unterminated array");
+				if (*ps.p == ']') {
+					++ps.p;
+					break;
+				}
+				if (!parse_value(ps, 0, NO_KEY))
+					return false;
+				++ps.d._nodes[a].count;
+
+				if (!skip_space(ps))
+					return false;
+				if (ps.p != ps.end && *ps.p == ',')
+					++ps.p;
+			}
+			return true;
+		}
+
+		/// Returns true if the out of range number in [first, last) is too
+		/// small for a double rather than too large. Such numbers are read as
+		/// zero, like strtod() does.
+		bool is_underflow(const char *first, const char *last)
+		{
+			// The decimal exponent of the first significant digit, without the
+			// explicit exponent.
+			const char *p = first + (*first == '-');
+			int64_t magnitude = -1;
+			for (; p != last && *p >= '0' && *p <= '9'; ++p) {
+				if (magnitude >= 0 || *p != '0')
+					++magnitude;
+			}
+			if (magnitude < 0 && p != last && *p == '.') {
+				for (++p; p != last && *p == '0'; ++p)
+					--magnitude;
+			}
+			while (p != last && ((*p >= '0' && *p <= '9') || *p == '.'))
+				++p;
+
+			int64_t exponent = 0;
+			if (p != last && (*p == 'e' || *p == 'E')) {
+				++p;
+				const bool negative = p != last && *p == '-';
+				p += p != last && (*p == '-' || *p == '+');
+				for (; p != last && *p >= '0' && *p <= '9'; ++p) {
+					if (exponent < 1000000000)
+						exponent = exponent * 10 + (*p - '0');
+				}
+				if (negative)
+					exponent = -exponent;
+			}
+			return magnitude + exponent < 0;
+		}
+
+		bool parse_value(Parser &ps, uint64_t key, uint32_t key_offset)
+		{
+			if (!skip_space(ps))
+				return false;
+			if (ps.p == ps.end)
+				return fail(ps, "expected a value");
+
+			const uint32_t i = array::size(ps.d._nodes);
+			SjsonNode n;
+			n.key = key;
+			n.key_offset = key_offset;
+			n.count = 0;
+			n.number = 0;
+
+			const char c = *ps.p;
+			if (c == '{' || c == '[') {
+				if (ps.depth == MAX_DEPTH)
+					return fail(ps, "too deeply nested");
+				n.type = c == '{' ? SjsonNode::OBJECT : SjsonNode::ARRAY;
+				array::push_back(ps.d._nodes, n);
+				++ps.p;
+				++ps.depth;
+				if (!(c == '{' ? parse_members(ps, i, '}') : parse_elements(ps, i)))
+					return false;
+				--ps.depth;
+			} else if (c == '"') {
+				n.type = SjsonNode::STRING;
+				if (!parse_string(ps, n.string_offset, n.count))
+					return false;
+				array::push_back(ps.d._nodes, n);
+			} else if (matches(ps, "true", 4) || matches(ps, "false", 5)) {
+				n.type = SjsonNode::BOOLEAN;
+				n.boolean = c == 't';
+				ps.p += n.boolean ? 4 : 5;
+				array::push_back(ps.d._nodes, n);
+			} else if (matches(ps, "null", 4)) {
+				n.type = SjsonNode::NIL;
+				ps.p += 4;
+				array::push_back(ps.d._nodes, n);
+			} else {
+				n.type = SjsonNode::NUMBER;
+				const ParseResult res = string_reader::parse(ps.p, ps.end, n.number);
+				if (res.error == PARSE_INVALID)
+					return fail(ps, "expected a value");
+				if (res.error == PARSE_OUT_OF_RANGE) {
+					if (!is_underflow(ps.p, res.end))
+						return fail(ps, "number out of range");
+					n.number = *ps.p == '-' ? -0.0 : 0.0;
+				}
+				ps.p = res.end;
+				if (ps.p != ps.end && is_key_char(*ps.p))
+					return fail(ps, "invalid number");
+				array::push_back(ps.d._nodes, n);
+			}
+			ps.d._nodes[i].next = array::size(ps.d._nodes);
+			return true;
+		}
+	}
+
+	namespace sjson
+	{
+		bool parse(SjsonDocument &d, const char *text, uint32_t size)
+		{
+			array::clear(d._nodes);
+			array::clear(d._strings);
+			hash::clear(d._keys);
+			d._error = 0;
+			d._error_line = 0;
+
+			Parser ps = {d, text, text, text + size, 0};
+			const char *nul = (const char *)memchr(text, 0, size);
+			if (nul) {
+				ps.p = nul;
+				return fail(ps, "unexpected NUL character");
+			}
+			if (!skip_space(ps))
+				return false;
+
+			// A document that starts with a brace or a bracket is JSON,
+			// otherwise the root is an object without braces.
+			if (ps.p != ps.end && (*ps.p == '{' || *ps.p == '[')) {
+				if (!parse_value(ps, 0, NO_KEY) || !skip_space(ps))
+					return false;
+				if (ps.p != ps.end)
+					return fail(ps, "unexpected text after the root");
+				return true;
+			}
+
+			SjsonNode root;
+			root.key = 0;
+			root.type = SjsonNode::OBJECT;
+			root.key_offset = NO_KEY;
+			root.count = 0;
+			root.number = 0;
+			array::push_back(d._nodes, root);
+			if (!parse_members(ps, 0, 0))
+				return false;
+			d._nodes[0].next = array::size(d._nodes);
+			return true;
+		}
+
+		uint32_t get(const SjsonDocument &d, uint32_t object, IdString64 key)
+		{
+			if (d._nodes[object].count > sjson_internal::MAX_UNHASHED_MEMBERS)
+				return hash::get(d._keys, sjson_internal::member_key(object, key.id), NOT_FOUND);
+
+			uint32_t found = NOT_FOUND;
+			for (uint32_t i = object + 1; i != d._nodes[object].next; i = d._nodes[i].next) {
+				if (d._nodes[i].key == key.id)
+					found = i;
+			}
+			return found;
+		}
+
+		double get_number(const SjsonDocument &d, uint32_t object, const char *key, double deffault)
+		{
+			const uint32_t i = get(d, object, key);
+			return i != NOT_FOUND && type(d, i) == SjsonNode::NUMBER ? number(d, i) : deffault;
+		}
+
+		bool get_bool(const SjsonDocument &d, uint32_t object, const char *key, bool deffault)
+		{
+			const uint32_t i = get(d, object, key);
+			return i != NOT_FOUND && type(d, i) == SjsonNode::BOOLEAN ? boolean(d, i) : deffault;
+		}
+
+		const char *get_string(const SjsonDocument &d, uint32_t object, const char *key, const char *deffault)
+		{
+			const uint32_t i = get(d, object, key);
+			return i != NOT_FOUND && type(d, i) == SjsonNode::STRING ? string(d, i) : deffault;
+		}
+	}
+
+	namespace
+	{
+		/// Writes the finite number f with 15, 16 or 17 significant digits,
+		/// the fewest that read back as the same double, without trailing
+		/// zeros. The digits come from snprintf(), but the decimal point is
+		/// placed here, so the output doesn't depend on the locale.
+		void write_double(Array<char> &b, double f)
+		{
+			char digits[24];
+			uint32_t n = 0;
+			int32_t e = 0;
+			for (int32_t precision = 15; precision <= 17; ++precision) {
+				// s is [-]d<decimal point>ddd...e[+-]dd
+				char s[40];
+				snprintf(s, sizeof(s), "%.*e", precision - 1, f);
+				const char *p = s;
+				n = 0;
+				for (; *p != 'e'; ++p) {
+					if (*p >= '0' && *p <= '9')
+						digits[n++] = *p;
+				}
+				e = atoi(p + 1);
+
+				// Check that the digits read back as f.
+				char t[40];
+				uint32_t length = 0;
+				t[length++] = digits[0];
+				t[length++] = '.';
+				memcpy(t + length, digits + 1, n - 1);
+				length += n - 1;
+				t[length++] = 'e';
+				length += string_stream_internal::format_int32(t + length, e);
+				double v;
+				string_reader::parse(t, t + length, v);
+				if (v == (f < 0 ? -f : f))
+					break;
+			}
+			while (n > 1 && digits[n - 1] == '0')
+				--n;
+
+			using namespace string_stream;
+			if (f < 0)
+				b << '-';
+			// Like %.17g, use scientific notation for small and large exponents.
+			if (e >= -4 && e < 17) {
+				if (e >= (int32_t)n - 1) {
+					push(b, digits, n);
+					for (int32_t i=n; i<=e; ++i)
+						b << '0';
+				} else if (e >= 0) {
+					push(b, digits, e + 1);
+					b << '.';
+					push(b, digits + e + 1, n - e - 1);
+				} else {
+					b << "0.";
+					for (int32_t i=-1; i>e; --i)
+						b << '0';
+					push(b, digits, n);
+				}
+			} else {
+				b << digits[0];
+				if (n > 1) {
+					b << '.';
+					push(b, digits + 1, n - 1);
+				}
+				printf(b, "e%c%02d", e < 0 ? '-' : '+', e < 0 ? -e : e);
+			}
+		}
+
+		void write_escaped(Array<char> &b, const char *s)
+		{
+			using namespace string_stream;
+			b << '"';
+			for (const char *p = s; *p; ) {
+				const char *q = p;
+				while (*q && *q != '"' && *q != '\\' && (unsigned char)*q >= 0x20)
+					++q;
+				push(b, p, (uint32_t)(q - p));
+				if (!*q)
+					break;
+				switch (*q) {
+					case '"': b << "\\\""; break;
+					case '\\': b << "\\\\"; break;
+					case '\n': b << "\\n"; break;
+					case '\r': b << "\\r"; break;
+					case '\t': b << "\\t"; break;
+					default: printf(b, "\\u%04x", (unsigned)(unsigned char)*q); break;
+				}
+				p = q + 1;
+			}
+			b << '"';
+		}
+
+		/// Starts a new item: separates it from the previous item, indents it
+		/// and writes the key.
+		void begin_item(SjsonWriter &w, const char *key)
+		{
+			using namespace string_stream;
+			Array<char> &b = *w._buffer;
+			const bool in_array = (w._in_array >> w._depth) & 1;
+			assert(in_array == (key == 0));
+
+			if (w._json && !w._first)
+				b << ',';
+			if (w._json || w._depth > 0 || !w._first)
+				b << '\n';
+			repeat(b, w._depth + w._json, '\t');
+			w._first = false;
+
+			if (in_array)
+				return;
+			bool plain = !w._json && *key;
+			for (const char *p = key; *p && plain; ++p)
+				plain = is_key_char(*p);
+			if (plain)
+				b << key;
+			else
+				write_escaped(b, key);
+			b << (w._json ? ": " : " = ");
+		}
+
+		void begin_container(SjsonWriter &w, const char *key, bool is_array)
+		{
+			begin_item(w, key);
+			string_stream::operator<<(*w._buffer, is_array ? '[' : '{');
+			++w._depth;
+			assert(w._depth < 64);
+			if (is_array)
+				w._in_array |= 1ull << w._depth;
+			else
+				w._in_array &= ~(1ull << w._depth);
+			w._first = true;
+		}
+
+		void end_container(SjsonWriter &w, char close)
+		{
+			using namespace string_stream;
+			assert(w._depth > 0);
+			--w._depth;
+			Array<char> &b = *w._buffer;
+			if (!w._first) {
+				b << '\n';
+				repeat(b, w._depth + w._json, '\t');
+			}
+			b << close;
+			w._first = false;
+		}
+	}
+
+	namespace sjson_writer
+	{
+		void begin_object(SjsonWriter &w, const char *key)
+		{
+			begin_container(w, key, false);
+		}
+
+		void end_object(SjsonWriter &w)
+		{
+			assert(!((w._in_array >> w._depth) & 1));
+			end_container(w, '}');
+		}
+
+		void begin_array(SjsonWriter &w, const char *key)
+		{
+			begin_container(w, key, true);
+		}
+
+		void end_array(SjsonWriter &w)
+		{
+			assert((w._in_array >> w._depth) & 1);
+			end_container(w, ']');
+		}
+
+		void write(SjsonWriter &w, const char *key, const char *s)
+		{
+			begin_item(w, key);
+			write_escaped(*w._buffer, s);
+		}
+
+		void write(SjsonWriter &w, const char *key, bool b)
+		{
+			begin_item(w, key);
+			string_stream::operator<<(*w._buffer, b ? "true" : "false");
+		}
+
+		void write(SjsonWriter &w, const char *key, float f)
+		{
+			begin_item(w, key);
+			if (w._json && !isfinite(f))
+				string_stream::operator<<(*w._buffer, "null");
+			else
+				string_stream::operator<<(*w._buffer, f);
+		}
+
+		void write(SjsonWriter &w, const char *key, double f)
+		{
+			begin_item(w, key);
+			if (!isfinite(f)) {
+				if (w._json)
+					string_stream::operator<<(*w._buffer, "null");
+				else
+					string_stream::operator<<(*w._buffer, (float)f);
+			} else if (f >= -2147483648.0 && f <= 2147483647.0 && f == (double)(int32_t)f)
+				string_stream::operator<<(*w._buffer, (int32_t)f);
+			else
+				write_double(*w._buffer, f);
+		}
+
+		void write(SjsonWriter &w, const char *key, int32_t i)
+		{
+			begin_item(w, key);
+			string_stream::operator<<(*w._buffer, i);
+		}
+
+		void write(SjsonWriter &w, const char *key, uint32_t i)
+		{
+			begin_item(w, key);
+			string_stream::operator<<(*w._buffer, i);
+		}
+
+		void write_null(SjsonWriter &w, const char *key)
+		{
+			begin_item(w, key);
+			string_stream::operator<<(*w._buffer, "null");
+		}
+
+		void finish(SjsonWriter &w)
+		{
+			using namespace string_stream;
+			assert(w._depth == 0);
+			Array<char> &b = *w._buffer;
+			if (w._json)
+				b << (w._first ? "}" : "\n}");
+			if (w._json || !w._first)
+				b << '\n';
+		}
+	}
+
+	SjsonDocument::SjsonDocument(Allocator &a) :
+		_nodes(a), _strings(a), _keys(a), _error(0), _error_line(0)
+	{}
+
+	SjsonWriter::SjsonWriter(Array<char> &buffer, bool json) :
+		_buffer(&buffer), _json(json), _first(true), _depth(0), _in_array(0)
+	{
+		if (json)
+			string_stream::operator<<(buffer, '{');
+	}
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "collection_types.h"
+#include "array.h"
+#include "murmur_hash.h"
+
+#include <string.h>
+
+namespace foundation
+{
+	/// Reads SJSON, the simplified JSON used for configuration and data files.
+	/// SJSON is JSON with these extensions:
+	///
+	/// * The root is an object without braces.
+	/// * Keys don't need quotes if they only use letters, digits, _ and -.
+	/// * Keys and values can be separated by = as well as :.
+	/// * Commas between items are optional.
+	/// * // and /* */ comments.
+	/// * """raw strings""" without escapes.
+	///
+	/// Regular JSON documents are read as well.
+	///
+	/// The document is parsed into a flat array of SjsonNodes. Strings are
+	/// unescaped and copied to the document, so the text can be freed after
+	/// parsing. Use a TempAllocator for documents that are only read once.
+	///
+	/// Text with NUL characters is rejected. Lone surrogates in \u escapes
+	/// are read as U+FFFD and numbers too small for a double as zero.
+	namespace sjson
+	{
+		const uint32_t NOT_FOUND = 0xffffffffu;
+
+		/// Parses the text into the document, replacing what was there. Returns
+		/// false if the text is not valid SJSON, see error().
+		bool parse(SjsonDocument &d, const char *text, uint32_t size);
+
+		/// Returns a description of the parse error, or 0 if the last parse
+		/// succeeded.
+		const char *error(const SjsonDocument &d);
+
+		/// Returns the line of the parse error (counted from 1).
+		uint32_t error_line(const SjsonDocument &d);
+
+		/// Returns the root node.
+		uint32_t root(const SjsonDocument &d);
+
+		/// Returns the type of the node.
+		SjsonNode::Type type(const SjsonDocument &d, uint32_t node);
+
+		/// Returns the number of children of an object or an array.
+		uint32_t size(const SjsonDocument &d, uint32_t node);
+
+		/// Iterates over the children of an object or an array:
+		///
+		///     for (uint32_t c = first_child(d, n); c != end(d, n); c = next(d, c))
+		uint32_t first_child(const SjsonDocument &d, uint32_t node);
+		uint32_t next(const SjsonDocument &d, uint32_t node);
+		uint32_t end(const SjsonDocument &d, uint32_t node);
+
+		/// Returns the member of the object with the specified key, or
+		/// NOT_FOUND. (If the object has the same key more than once, the last
+		/// member is returned.)
+		uint32_t get(const SjsonDocument &d, uint32_t object, const char *key);
+		uint32_t get(const SjsonDocument &d, uint32_t object, IdString64 key);
+
+		/// Returns the key of an object member.
+		const char *key(const SjsonDocument &d, uint32_t node);
+
+		/// Returns the value of a node of the matching type.
+		double number(const SjsonDocument &d, uint32_t node);
+		bool boolean(const SjsonDocument &d, uint32_t node);
+		const char *string(const SjsonDocument &d, uint32_t node);
+		uint32_t string_length(const SjsonDocument &d, uint32_t node);
+
+		/// Returns the value of the member of the object with the specified key,
+		/// or deffault if there is no such member or it has a different type.
+		double get_number(const SjsonDocument &d, uint32_t object, const char *key, double deffault);
+		bool get_bool(const SjsonDocument &d, uint32_t object, const char *key, bool deffault);
+		const char *get_string(const SjsonDocument &d, uint32_t object, const char *key, const char *deffault);
+	}
+
+	/// Writes SJSON, or JSON if the writer was created with json = true. The
+	/// writer starts in the root object. Pass a key for each item that is
+	/// written to an object and a key of 0 for items written to an array:
+	///
+	///     SjsonWriter w(buffer);
+	///     sjson_writer::write(w, "name", "box");
+	///     sjson_writer::begin_array(w, "size");
+	///     sjson_writer::write(w, 0, 1.0f);
+	///     sjson_writer::end_array(w);
+	///     sjson_writer::finish(w);
+	///
+	/// Keys and strings are escaped as needed. Numbers are written the same in
+	/// every locale. JSON has no inf and nan, so in JSON mode they are written
+	/// as null.
+	namespace sjson_writer
+	{
+		void begin_object(SjsonWriter &w, const char *key);
+		void end_object(SjsonWriter &w);
+		void begin_array(SjsonWriter &w, const char *key);
+		void end_array(SjsonWriter &w);
+
+		void write(SjsonWriter &w, const char *key, const char *s);
+		void write(SjsonWriter &w, const char *key, bool b);
+		void write(SjsonWriter &w, const char *key, float f);
+		void write(SjsonWriter &w, const char *key, double f);
+		void write(SjsonWriter &w, const char *key, int32_t i);
+		void write(SjsonWriter &w, const char *key, uint32_t i);
+		void write_null(SjsonWriter &w, const char *key);
+
+		/// Ends the root object. All other objects and arrays must have been
+		/// ended.
+		void finish(SjsonWriter &w);
+	}
+
+	namespace sjson_internal
+	{
+		/// Objects with more members than this are added to
+		/// SjsonDocument::_keys, members of smaller objects are found by
+		/// comparing the key hashes of the members.
+		const uint32_t MAX_UNHASHED_MEMBERS = 16;
+
+		/// Returns the key for finding the member with the hashed key in the
+		/// object in SjsonDocument::_keys.
+		inline uint64_t member_key(uint32_t object, uint64_t key)
+		{
+			return key + (uint64_t)object * 0x9e3779b97f4a7c15ull;
+		}
+	}
+
+	namespace sjson
+	{
+		inline const char *error(const SjsonDocument &d) {return d._error;}
+		inline uint32_t error_line(const SjsonDocument &d) {return d._error_line;}
+		inline uint32_t root(const SjsonDocument &) {return 0;}
+		inline SjsonNode::Type type(const SjsonDocument &d, uint32_t node) {return (SjsonNode::Type)d._nodes[node].type;}
+		inline uint32_t size(const SjsonDocument &d, uint32_t node) {return d._nodes[node].count;}
+		inline uint32_t first_child(const SjsonDocument &, uint32_t node) {return node + 1;}
+		inline uint32_t next(const SjsonDocument &d, uint32_t node) {return d._nodes[node].next;}
+		inline uint32_t end(const SjsonDocument &d, uint32_t node) {return d._nodes[node].next;}
+
+		inline const char *key(const SjsonDocument &d, uint32_t node) {return array::begin(d._strings) + d._nodes[node].key_offset;}
+		inline double number(const SjsonDocument &d, uint32_t node) {return d._nodes[node].number;}
+		inline bool boolean(const SjsonDocument &d, uint32_t node) {return d._nodes[node].boolean;}
+		inline const char *string(const SjsonDocument &d, uint32_t node) {return array::begin(d._strings) + d._nodes[node].string_offset;}
+		inline uint32_t string_length(const SjsonDocument &d, uint32_t node) {return d._nodes[node].count;}
+
+		inline uint32_t get(const SjsonDocument &d, uint32_t object, const char *key)
+		{
+			return get(d, object, IdString64(key, (uint32_t)strlen(key)));
+		}
+	}
+}
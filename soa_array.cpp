@@ -0,0 +1,494 @@
+#include "soa_array.h"
+#include "vector_math.h"
+
+#include <assert.h>
+
+#if defined(FOUNDATION_SSE2) && defined(__GNUC__) && defined(__x86_64__)
+	#include <immintrin.h>
+	#define SOA_ARRAY_AVX
+	// AVX-512 implies FMA, and GCC would contract the multiplies and adds
+	// into fused operations, which round differently from the other paths.
+	#define SOA_ARRAY_AVX512_TARGET __attribute__((target("avx512f"), optimize("fp-contract=off")))
+#endif
+
+namespace foundation
+{
+	namespace
+	{
+		// The kernels below take the streams of their arrays and a start index
+		// and process blocks of elements from there. They return the index of
+		// the first element that wasn't processed, which is then passed on to
+		// the next narrower kernel, ending with the scalar functions.
+
+		void transform_one(const Matrix4x4 &m, const float * const *in, float * const *out, uint32_t i, bool translate)
+		{
+			const Vector3 p = {in[0][i], in[1][i], in[2][i]};
+			const Vector3 r = translate ? matrix4x4::transform_point(m, p) : matrix4x4::transform_vector(m, p);
+			out[0][i] = r.x;
+			out[1][i] = r.y;
+			out[2][i] = r.z;
+		}
+
+		void rotate_one(const Quaternion *single, const float * const *q, const float * const *in, float * const *out, uint32_t i)
+		{
+			const Quaternion qi = single ? *single : Quaternion{q[0][i], q[1][i], q[2][i], q[3][i]};
+			const Vector3 v = {in[0][i], in[1][i], in[2][i]};
+			const Vector3 r = quaternion::rotate(qi, v);
+			out[0][i] = r.x;
+			out[1][i] = r.y;
+			out[2][i] = r.z;
+		}
+
+	#if defined(FOUNDATION_SSE2)
+		#define SOA_ARRAY_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+
+		// The products and sums are computed in the same order as in the
+		// vector_math functions, so that all the kernels give the same results.
+
+		uint32_t transform_sse(const Matrix4x4 &m, const float * const *in, float * const *out, uint32_t i, uint32_t n, bool translate)
+		{
+			const float *mf = &m.x.x;
+			__m128 mm[16];
+			for (uint32_t j=0; j<16; ++j)
+				mm[j] = _mm_set1_ps(mf[j]);
+			for (; i + 4 <= n; i += 4) {
+				const __m128 x = _mm_load_ps(in[0] + i);
+				const __m128 y = _mm_load_ps(in[1] + i);
+				const __m128 z = _mm_load_ps(in[2] + i);
+				for (uint32_t c=0; c<3; ++c) {
+					__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, mm[c]), _mm_mul_ps(y, mm[4 + c])), _mm_mul_ps(z, mm[8 + c]));
+					if (translate)
+						r = _mm_add_ps(r, mm[12 + c]);
+					_mm_store_ps(out[c] + i, r);
+				}
+			}
+			return i;
+		}
+
+		uint32_t normalize3_sse(float * const *s, uint32_t i, uint32_t n)
+		{
+			const __m128 one = _mm_set1_ps(1.0f);
+			for (; i + 4 <= n; i += 4) {
+				const __m128 x = _mm_load_ps(s[0] + i);
+				const __m128 y = _mm_load_ps(s[1] + i);
+				const __m128 z = _mm_load_ps(s[2] + i);
+				const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+				const __m128 r = _mm_div_ps(one, _mm_sqrt_ps(d));
+				_mm_store_ps(s[0] + i, _mm_mul_ps(x, r));
+				_mm_store_ps(s[1] + i, _mm_mul_ps(y, r));
+				_mm_store_ps(s[2] + i, _mm_mul_ps(z, r));
+			}
+			return i;
+		}
+
+		uint32_t normalize4_sse(float * const *s, uint32_t i, uint32_t n)
+		{
+			for (; i + 4 <= n; i += 4) {
+				const __m128 x = _mm_load_ps(s[0] + i);
+				const __m128 y = _mm_load_ps(s[1] + i);
+				const __m128 z = _mm_load_ps(s[2] + i);
+				const __m128 w = _mm_load_ps(s[3] + i);
+				const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+					_mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+				const __m128 l = _mm_sqrt_ps(d);
+				_mm_store_ps(s[0] + i, _mm_div_ps(x, l));
+				_mm_store_ps(s[1] + i, _mm_div_ps(y, l));
+				_mm_store_ps(s[2] + i, _mm_div_ps(z, l));
+				_mm_store_ps(s[3] + i, _mm_div_ps(w, l));
+			}
+			return i;
+		}
+
+		uint32_t rotate_sse(const Quaternion *single, const float * const *q, const float * const *in, float * const *out, uint32_t i, uint32_t n)
+		{
+			const __m128 two = _mm_set1_ps(2.0f);
+			for (; i + 4 <= n; i += 4) {
+				const __m128 ux = single ? _mm_set1_ps(single->x) : _mm_load_ps(q[0] + i);
+				const __m128 uy = single ? _mm_set1_ps(single->y) : _mm_load_ps(q[1] + i);
+				const __m128 uz = single ? _mm_set1_ps(single->z) : _mm_load_ps(q[2] + i);
+				const __m128 uw = single ? _mm_set1_ps(single->w) : _mm_load_ps(q[3] + i);
+				const __m128 vx = _mm_load_ps(in[0] + i);
+				const __m128 vy = _mm_load_ps(in[1] + i);
+				const __m128 vz = _mm_load_ps(in[2] + i);
+				const __m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy)), two);
+				const __m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz)), two);
+				const __m128 tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx)), two);
+				_mm_store_ps(out[0] + i, _mm_add_ps(_mm_add_ps(vx, _mm_mul_ps(tx, uw)), _mm_sub_ps(_mm_mul_ps(uy, tz), _mm_mul_ps(uz, ty))));
+				_mm_store_ps(out[1] + i, _mm_add_ps(_mm_add_ps(vy, _mm_mul_ps(ty, uw)), _mm_sub_ps(_mm_mul_ps(uz, tx), _mm_mul_ps(ux, tz))));
+				_mm_store_ps(out[2] + i, _mm_add_ps(_mm_add_ps(vz, _mm_mul_ps(tz, uw)), _mm_sub_ps(_mm_mul_ps(ux, ty), _mm_mul_ps(uy, tx))));
+			}
+			return i;
+		}
+
+		/// Converts four elements of three or four components at a time.
+		uint32_t gather_sse(const float *aos, uint32_t components, uint32_t n, float * const *s)
+		{
+			uint32_t i = 0;
+			if (components == 4) {
+				for (; i + 4 <= n; i += 4, aos += 16) {
+					__m128 x = _mm_loadu_ps(aos);
+					__m128 y = _mm_loadu_ps(aos + 4);
+					__m128 z = _mm_loadu_ps(aos + 8);
+					__m128 w = _mm_loadu_ps(aos + 12);
+					_MM_TRANSPOSE4_PS(x, y, z, w);
+					_mm_store_ps(s[0] + i, x);
+					_mm_store_ps(s[1] + i, y);
+					_mm_store_ps(s[2] + i, z);
+					_mm_store_ps(s[3] + i, w);
+				}
+			} else if (components == 3) {
+				for (; i + 4 <= n; i += 4, aos += 12) {
+					const __m128 a = _mm_loadu_ps(aos);         // x0 y0 z0 x1
+					const __m128 b = _mm_loadu_ps(aos + 4);     // y1 z1 x2 y2
+					const __m128 c = _mm_loadu_ps(aos + 8);     // z2 x3 y3 z3
+					const __m128 x23 = SOA_ARRAY_SHUFFLE(b, c, 2, 2, 1, 1);
+					_mm_store_ps(s[0] + i, SOA_ARRAY_SHUFFLE(a, x23, 0, 3, 0, 2));
+					const __m128 y01 = SOA_ARRAY_SHUFFLE(a, b, 1, 1, 0, 0);
+					const __m128 y23 = SOA_ARRAY_SHUFFLE(b, c, 3, 3, 2, 2);
+					_mm_store_ps(s[1] + i, SOA_ARRAY_SHUFFLE(y01, y23, 0, 2, 0, 2));
+					const __m128 z01 = SOA_ARRAY_SHUFFLE(a, b, 2, 2, 1, 1);
+					const __m128 z23 = SOA_ARRAY_SHUFFLE(c, c, 0, 0, 3, 3);
+					_mm_store_ps(s[2] + i, SOA_ARRAY_SHUFFLE(z01, z23, 0, 2, 0, 2));
+				}
+			}
+			return i;
+		}
+
+		uint32_t scatter_sse(const float * const *s, uint32_t components, uint32_t n, float *aos)
+		{
+			uint32_t i = 0;
+			if (components == 4) {
+				for (; i + 4 <= n; i += 4, aos += 16) {
+					__m128 x = _mm_load_ps(s[0] + i);
+					__m128 y = _mm_load_ps(s[1] + i);
+					__m128 z = _mm_load_ps(s[2] + i);
+					__m128 w = _mm_load_ps(s[3] + i);
+					_MM_TRANSPOSE4_PS(x, y, z, w);
+					_mm_storeu_ps(aos, x);
+					_mm_storeu_ps(aos + 4, y);
+					_mm_storeu_ps(aos + 8, z);
+					_mm_storeu_ps(aos + 12, w);
+				}
+			} else if (components == 3) {
+				for (; i + 4 <= n; i += 4, aos += 12) {
+					const __m128 x = _mm_load_ps(s[0] + i);
+					const __m128 y = _mm_load_ps(s[1] + i);
+					const __m128 z = _mm_load_ps(s[2] + i);
+					const __m128 xy01 = _mm_unpacklo_ps(x, y);  // x0 y0 x1 y1
+					const __m128 xy23 = _mm_unpackhi_ps(x, y);  // x2 y2 x3 y3
+					const __m128 z0x1 = SOA_ARRAY_SHUFFLE(z, xy01, 0, 0, 2, 2);
+					_mm_storeu_ps(aos, SOA_ARRAY_SHUFFLE(xy01, z0x1, 0, 1, 0, 2));
+					const __m128 y1z1 = SOA_ARRAY_SHUFFLE(xy01, z, 3, 3, 1, 1);
+					_mm_storeu_ps(aos + 4, SOA_ARRAY_SHUFFLE(y1z1, xy23, 0, 2, 0, 1));
+					const __m128 z23x3y3 = SOA_ARRAY_SHUFFLE(z, xy23, 2, 3, 2, 3);
+					_mm_storeu_ps(aos + 8, SOA_ARRAY_SHUFFLE(z23x3y3, z23x3y3, 0, 2, 3, 1));
+				}
+			}
+			return i;
+		}
+	#endif
+
+	#if defined(SOA_ARRAY_AVX)
+		__attribute__((target("avx"))) uint32_t transform_avx(const Matrix4x4 &m, const float * const *in, float * const *out, uint32_t i, uint32_t n, bool translate)
+		{
+			const float *mf = &m.x.x;
+			__m256 mm[16];
+			for (uint32_t j=0; j<16; ++j)
+				mm[j] = _mm256_set1_ps(mf[j]);
+			for (; i + 8 <= n; i += 8) {
+				const __m256 x = _mm256_load_ps(in[0] + i);
+				const __m256 y = _mm256_load_ps(in[1] + i);
+				const __m256 z = _mm256_load_ps(in[2] + i);
+				for (uint32_t c=0; c<3; ++c) {
+					__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, mm[c]), _mm256_mul_ps(y, mm[4 + c])), _mm256_mul_ps(z, mm[8 + c]));
+					if (translate)
+						r = _mm256_add_ps(r, mm[12 + c]);
+					_mm256_store_ps(out[c] + i, r);
+				}
+			}
+			return i;
+		}
+
+		__attribute__((target("avx"))) uint32_t normalize3_avx(float * const *s, uint32_t i, uint32_t n)
+		{
+			const __m256 one = _mm256_set1_ps(1.0f);
+			for (; i + 8 <= n; i += 8) {
+				const __m256 x = _mm256_load_ps(s[0] + i);
+				const __m256 y = _mm256_load_ps(s[1] + i);
+				const __m256 z = _mm256_load_ps(s[2] + i);
+				const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+				const __m256 r = _mm256_div_ps(one, _mm256_sqrt_ps(d));
+				_mm256_store_ps(s[0] + i, _mm256_mul_ps(x, r));
+				_mm256_store_ps(s[1] + i, _mm256_mul_ps(y, r));
+				_mm256_store_ps(s[2] + i, _mm256_mul_ps(z, r));
+			}
+			return i;
+		}
+
+		__attribute__((target("avx"))) uint32_t normalize4_avx(float * const *s, uint32_t i, uint32_t n)
+		{
+			for (; i + 8 <= n; i += 8) {
+				const __m256 x = _mm256_load_ps(s[0] + i);
+				const __m256 y = _mm256_load_ps(s[1] + i);
+				const __m256 z = _mm256_load_ps(s[2] + i);
+				const __m256 w = _mm256_load_ps(s[3] + i);
+				const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)),
+					_mm256_add_ps(_mm256_mul_ps(z, z), _mm256_mul_ps(w, w)));
+				const __m256 l = _mm256_sqrt_ps(d);
+				_mm256_store_ps(s[0] + i, _mm256_div_ps(x, l));
+				_mm256_store_ps(s[1] + i, _mm256_div_ps(y, l));
+				_mm256_store_ps(s[2] + i, _mm256_div_ps(z, l));
+				_mm256_store_ps(s[3] + i, _mm256_div_ps(w, l));
+			}
+			return i;
+		}
+
+		__attribute__((target("avx"))) uint32_t rotate_avx(const Quaternion *single, const float * const *q, const float * const *in, float * const *out, uint32_t i, uint32_t n)
+		{
+			const __m256 two = _mm256_set1_ps(2.0f);
+			for (; i + 8 <= n; i += 8) {
+				const __m256 ux = single ? _mm256_set1_ps(single->x) : _mm256_load_ps(q[0] + i);
+				const __m256 uy = single ? _mm256_set1_ps(single->y) : _mm256_load_ps(q[1] + i);
+				const __m256 uz = single ? _mm256_set1_ps(single->z) : _mm256_load_ps(q[2] + i);
+				const __m256 uw = single ? _mm256_set1_ps(single->w) : _mm256_load_ps(q[3] + i);
+				const __m256 vx = _mm256_load_ps(in[0] + i);
+				const __m256 vy = _mm256_load_ps(in[1] + i);
+				const __m256 vz = _mm256_load_ps(in[2] + i);
+				const __m256 tx = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(uy, vz), _mm256_mul_ps(uz, vy)), two);
+				const __m256 ty = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(uz, vx), _mm256_mul_ps(ux, vz)), two);
+				const __m256 tz = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ux, vy), _mm256_mul_ps(uy, vx)), two);
+				_mm256_store_ps(out[0] + i, _mm256_add_ps(_mm256_add_ps(vx, _mm256_mul_ps(tx, uw)), _mm256_sub_ps(_mm256_mul_ps(uy, tz), _mm256_mul_ps(uz, ty))));
+				_mm256_store_ps(out[1] + i, _mm256_add_ps(_mm256_add_ps(vy, _mm256_mul_ps(ty, uw)), _mm256_sub_ps(_mm256_mul_ps(uz, tx), _mm256_mul_ps(ux, tz))));
+				_mm256_store_ps(out[2] + i, _mm256_add_ps(_mm256_add_ps(vz, _mm256_mul_ps(tz, uw)), _mm256_sub_ps(_mm256_mul_ps(ux, ty), _mm256_mul_ps(uy, tx))));
+			}
+			return i;
+		}
+
+		SOA_ARRAY_AVX512_TARGET uint32_t transform_avx512(const Matrix4x4 &m, const float * const *in, float * const *out, uint32_t i, uint32_t n, bool translate)
+		{
+			const float *mf = &m.x.x;
+			__m512 mm[16];
+			for (uint32_t j=0; j<16; ++j)
+				mm[j] = _mm512_set1_ps(mf[j]);
+			for (; i + 16 <= n; i += 16) {
+				const __m512 x = _mm512_load_ps(in[0] + i);
+				const __m512 y = _mm512_load_ps(in[1] + i);
+				const __m512 z = _mm512_load_ps(in[2] + i);
+				for (uint32_t c=0; c<3; ++c) {
+					__m512 r = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, mm[c]), _mm512_mul_ps(y, mm[4 + c])), _mm512_mul_ps(z, mm[8 + c]));
+					if (translate)
+						r = _mm512_add_ps(r, mm[12 + c]);
+					_mm512_store_ps(out[c] + i, r);
+				}
+			}
+			return i;
+		}
+
+		SOA_ARRAY_AVX512_TARGET uint32_t normalize3_avx512(float * const *s, uint32_t i, uint32_t n)
+		{
+			// The square roots use the zero-masking form with a full mask,
+			// because the unmasked one triggers -Wmaybe-uninitialized in GCC's
+			// headers.
+			const __mmask16 all = 0xffff;
+			const __m512 one = _mm512_set1_ps(1.0f);
+			for (; i + 16 <= n; i += 16) {
+				const __m512 x = _mm512_load_ps(s[0] + i);
+				const __m512 y = _mm512_load_ps(s[1] + i);
+				const __m512 z = _mm512_load_ps(s[2] + i);
+				const __m512 d = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y)), _mm512_mul_ps(z, z));
+				const __m512 r = _mm512_div_ps(one, _mm512_maskz_sqrt_ps(all, d));
+				_mm512_store_ps(s[0] + i, _mm512_mul_ps(x, r));
+				_mm512_store_ps(s[1] + i, _mm512_mul_ps(y, r));
+				_mm512_store_ps(s[2] + i, _mm512_mul_ps(z, r));
+			}
+			return i;
+		}
+
+		SOA_ARRAY_AVX512_TARGET uint32_t normalize4_avx512(float * const *s, uint32_t i, uint32_t n)
+		{
+			const __mmask16 all = 0xffff;
+			for (; i + 16 <= n; i += 16) {
+				const __m512 x = _mm512_load_ps(s[0] + i);
+				const __m512 y = _mm512_load_ps(s[1] + i);
+				const __m512 z = _mm512_load_ps(s[2] + i);
+				const __m512 w = _mm512_load_ps(s[3] + i);
+				const __m512 d = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y)),
+					_mm512_add_ps(_mm512_mul_ps(z, z), _mm512_mul_ps(w, w)));
+				const __m512 l = _mm512_maskz_sqrt_ps(all, d);
+				_mm512_store_ps(s[0] + i, _mm512_div_ps(x, l));
+				_mm512_store_ps(s[1] + i, _mm512_div_ps(y, l));
+				_mm512_store_ps(s[2] + i, _mm512_div_ps(z, l));
+				_mm512_store_ps(s[3] + i, _mm512_div_ps(w, l));
+			}
+			return i;
+		}
+
+		SOA_ARRAY_AVX512_TARGET uint32_t rotate_avx512(const Quaternion *single, const float * const *q, const float * const *in, float * const *out, uint32_t i, uint32_t n)
+		{
+			const __m512 two = _mm512_set1_ps(2.0f);
+			for (; i + 16 <= n; i += 16) {
+				const __m512 ux = single ? _mm512_set1_ps(single->x) : _mm512_load_ps(q[0] + i);
+				const __m512 uy = single ? _mm512_set1_ps(single->y) : _mm512_load_ps(q[1] + i);
+				const __m512 uz = single ? _mm512_set1_ps(single->z) : _mm512_load_ps(q[2] + i);
+				const __m512 uw = single ? _mm512_set1_ps(single->w) : _mm512_load_ps(q[3] + i);
+				const __m512 vx = _mm512_load_ps(in[0] + i);
+				const __m512 vy = _mm512_load_ps(in[1] + i);
+				const __m512 vz = _mm512_load_ps(in[2] + i);
+				const __m512 tx = _mm512_mul_ps(_mm512_sub_ps(_mm512_mul_ps(uy, vz), _mm512_mul_ps(uz, vy)), two);
+				const __m512 ty = _mm512_mul_ps(_mm512_sub_ps(_mm512_mul_ps(uz, vx), _mm512_mul_ps(ux, vz)), two);
+				const __m512 tz = _mm512_mul_ps(_mm512_sub_ps(_mm512_mul_ps(ux, vy), _mm512_mul_ps(uy, vx)), two);
+				_mm512_store_ps(out[0] + i, _mm512_add_ps(_mm512_add_ps(vx, _mm512_mul_ps(tx, uw)), _mm512_sub_ps(_mm512_mul_ps(uy, tz), _mm512_mul_ps(uz, ty))));
+				_mm512_store_ps(out[1] + i, _mm512_add_ps(_mm512_add_ps(vy, _mm512_mul_ps(ty, uw)), _mm512_sub_ps(_mm512_mul_ps(uz, tx), _mm512_mul_ps(ux, tz))));
+				_mm512_store_ps(out[2] + i, _mm512_add_ps(_mm512_add_ps(vz, _mm512_mul_ps(tz, uw)), _mm512_sub_ps(_mm512_mul_ps(ux, ty), _mm512_mul_ps(uy, tx))));
+			}
+			return i;
+		}
+
+		bool has_avx()
+		{
+			static const bool avx = __builtin_cpu_supports("avx");
+			return avx;
+		}
+
+		bool has_avx512()
+		{
+			static const bool avx512 = __builtin_cpu_supports("avx512f");
+			return avx512;
+		}
+	#endif
+
+		void transform_many(const Matrix4x4 &m, const SoaArray<Vector3> &in, SoaArray<Vector3> &out, bool translate)
+		{
+			const uint32_t n = in._size;
+			soa_array::resize(out, n);
+			uint32_t i = 0;
+		#if defined(SOA_ARRAY_AVX)
+			if (has_avx512())
+				i = transform_avx512(m, in._streams, out._streams, i, n, translate);
+			if (has_avx())
+				i = transform_avx(m, in._streams, out._streams, i, n, translate);
+		#endif
+		#if defined(FOUNDATION_SSE2)
+			i = transform_sse(m, in._streams, out._streams, i, n, translate);
+		#endif
+			for (; i<n; ++i)
+				transform_one(m, in._streams, out._streams, i, translate);
+		}
+
+		void rotate_many(const Quaternion *single, const float * const *q, const SoaArray<Vector3> &in, SoaArray<Vector3> &out)
+		{
+			const uint32_t n = in._size;
+			soa_array::resize(out, n);
+			uint32_t i = 0;
+		#if defined(SOA_ARRAY_AVX)
+			if (has_avx512())
+				i = rotate_avx512(single, q, in._streams, out._streams, i, n);
+			if (has_avx())
+				i = rotate_avx(single, q, in._streams, out._streams, i, n);
+		#endif
+		#if defined(FOUNDATION_SSE2)
+			i = rotate_sse(single, q, in._streams, out._streams, i, n);
+		#endif
+			for (; i<n; ++i)
+				rotate_one(single, q, in._streams, out._streams, i);
+		}
+
+		Vector4 normalize_one(const Vector4 &v) {return vector4::normalize(v);}
+		Quaternion normalize_one(const Quaternion &q) {return quaternion::normalize(q);}
+
+		template<typename T> void normalize4(SoaArray<T> &a)
+		{
+			const uint32_t n = a._size;
+			uint32_t i = 0;
+		#if defined(SOA_ARRAY_AVX)
+			if (has_avx512())
+				i = normalize4_avx512(a._streams, i, n);
+			if (has_avx())
+				i = normalize4_avx(a._streams, i, n);
+		#endif
+		#if defined(FOUNDATION_SSE2)
+			i = normalize4_sse(a._streams, i, n);
+		#endif
+			for (; i<n; ++i)
+				soa_array::set(a, i, normalize_one(soa_array::get(a, i)));
+		}
+	}
+
+	namespace soa_array_internal
+	{
+		void gather(const float *aos, uint32_t components, uint32_t n, float * const *streams)
+		{
+			uint32_t i = 0;
+		#if defined(FOUNDATION_SSE2)
+			i = gather_sse(aos, components, n, streams);
+		#endif
+			for (; i<n; ++i) {
+				for (uint32_t c=0; c<components; ++c)
+					streams[c][i] = aos[i*components + c];
+			}
+		}
+
+		void scatter(const float * const *streams, uint32_t components, uint32_t n, float *aos)
+		{
+			uint32_t i = 0;
+		#if defined(FOUNDATION_SSE2)
+			i = scatter_sse(streams, components, n, aos);
+		#endif
+			for (; i<n; ++i) {
+				for (uint32_t c=0; c<components; ++c)
+					aos[i*components + c] = streams[c][i];
+			}
+		}
+	}
+
+	namespace soa_array
+	{
+		void transform_points(const Matrix4x4 &m, const SoaArray<Vector3> &in, SoaArray<Vector3> &out)
+		{
+			transform_many(m, in, out, true);
+		}
+
+		void transform_vectors(const Matrix4x4 &m, const SoaArray<Vector3> &in, SoaArray<Vector3> &out)
+		{
+			transform_many(m, in, out, false);
+		}
+
+		void normalize(SoaArray<Vector3> &a)
+		{
+			const uint32_t n = a._size;
+			uint32_t i = 0;
+		#if defined(SOA_ARRAY_AVX)
+			if (has_avx512())
+				i = normalize3_avx512(a._streams, i, n);
+			if (has_avx())
+				i = normalize3_avx(a._streams, i, n);
+		#endif
+		#if defined(FOUNDATION_SSE2)
+			i = normalize3_sse(a._streams, i, n);
+		#endif
+			for (; i<n; ++i)
+				set(a, i, vector3::normalize(get(a, i)));
+		}
+
+		void normalize(SoaArray<Vector4> &a)
+		{
+			normalize4(a);
+		}
+
+		void normalize(SoaArray<Quaternion> &a)
+		{
+			normalize4(a);
+		}
+
+		void rotate(const Quaternion &q, const SoaArray<Vector3> &in, SoaArray<Vector3> &out)
+		{
+			rotate_many(&q, 0, in, out);
+		}
+
+		void rotate(const SoaArray<Quaternion> &q, const SoaArray<Vector3> &in, SoaArray<Vector3> &out)
+		{
+			assert(q._size == in._size);
+			rotate_many(0, q._streams, in, out);
+		}
+	}
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "collection_types.h"
+#include "math_types.h"
+#include "memory.h"
+
+#include <string.h>
+
+namespace foundation {
+	namespace soa_array
+	{
+		/// The number of elements in the array.
+		template<typename T> uint32_t size(const SoaArray<T> &a);
+		/// Returns true if there are any elements in the array.
+		template<typename T> bool any(const SoaArray<T> &a);
+		/// Returns true if the array is empty.
+		template<typename T> bool empty(const SoaArray<T> &a);
+
+		/// Returns the streams of the x, y, z and w components. The streams are
+		/// aligned to 64 bytes and padded to a multiple of 16 floats. Vector3
+		/// arrays have no w stream.
+		template<typename T> float *x(SoaArray<T> &a);
+		template<typename T> const float *x(const SoaArray<T> &a);
+		template<typename T> float *y(SoaArray<T> &a);
+		template<typename T> const float *y(const SoaArray<T> &a);
+		template<typename T> float *z(SoaArray<T> &a);
+		template<typename T> const float *z(const SoaArray<T> &a);
+		template<typename T> float *w(SoaArray<T> &a);
+		template<typename T> const float *w(const SoaArray<T> &a);
+
+		/// Returns the element with index i, gathered from the streams.
+		template<typename T> T get(const SoaArray<T> &a, uint32_t i);
+		/// Sets the element with index i.
+		template<typename T> void set(SoaArray<T> &a, uint32_t i, const T &item);
+
+		/// Changes the size of the array (does not reallocate memory unless necessary).
+		template<typename T> void resize(SoaArray<T> &a, uint32_t new_size);
+		/// Removes all items in the array (does not free memory).
+		template<typename T> void clear(SoaArray<T> &a);
+		/// Reallocates the array to the specified capacity (rounded up to a
+		/// multiple of 16).
+		template<typename T> void set_capacity(SoaArray<T> &a, uint32_t new_capacity);
+		/// Makes sure that the array has at least the specified capacity.
+		template<typename T> void reserve(SoaArray<T> &a, uint32_t new_capacity);
+		/// Grows the array geometrically, to at least min_capacity.
+		template<typename T> void grow(SoaArray<T> &a, uint32_t min_capacity = 0);
+		/// Trims the array so that its capacity matches its size.
+		template<typename T> void trim(SoaArray<T> &a);
+
+		/// Pushes the item to the end of the array.
+		template<typename T> void push_back(SoaArray<T> &a, const T &item);
+		/// Pops the last item from the array. The array cannot be empty.
+		template<typename T> void pop_back(SoaArray<T> &a);
+
+		/// Replaces the content of the array with the n items (array-of-structs
+		/// to structure-of-arrays conversion).
+		template<typename T> void from_aos(SoaArray<T> &a, const T *items, uint32_t n);
+		/// Writes the size(a) elements of the array to out (structure-of-arrays
+		/// to array-of-structs conversion).
+		template<typename T> void to_aos(const SoaArray<T> &a, T *out);
+
+		/// Batch versions of the vector_math functions. They process 4, 8 or
+		/// 16 elements per instruction with SSE, AVX or AVX-512 (chosen at run
+		/// time) and give the same results as the single element functions.
+		/// The out array is resized to the size of in and may be the same
+		/// array as in.
+		void transform_points(const Matrix4x4 &m, const SoaArray<Vector3> &in, SoaArray<Vector3> &out);
+		void transform_vectors(const Matrix4x4 &m, const SoaArray<Vector3> &in, SoaArray<Vector3> &out);
+		void normalize(SoaArray<Vector3> &a);
+		void normalize(SoaArray<Vector4> &a);
+		void normalize(SoaArray<Quaternion> &a);
+		/// Rotates all the vectors in by q.
+		void rotate(const Quaternion &q, const SoaArray<Vector3> &in, SoaArray<Vector3> &out);
+		/// Rotates each vector in[i] by q[i]. q must have the same size as in.
+		void rotate(const SoaArray<Quaternion> &q, const SoaArray<Vector3> &in, SoaArray<Vector3> &out);
+	}
+
+	namespace soa_array_internal
+	{
+		const uint32_t ALIGNMENT = 64;
+		const uint32_t PADDING = 16;
+
+		/// The number of streams used for T.
+		template<typename T> struct Components;
+		template<> struct Components<Vector3> {enum {VALUE = 3};};
+		template<> struct Components<Vector4> {enum {VALUE = 4};};
+		template<> struct Components<Quaternion> {enum {VALUE = 4};};
+
+		/// Copies n elements with the specified number of components from
+		/// interleaved floats to streams and back.
+		void gather(const float *aos, uint32_t components, uint32_t n, float * const *streams);
+		void scatter(const float * const *streams, uint32_t components, uint32_t n, float *aos);
+	}
+
+	namespace soa_array
+	{
+		template<typename T> inline uint32_t size(const SoaArray<T> &a) 		{return a._size;}
+		template<typename T> inline bool any(const SoaArray<T> &a) 			{return a._size != 0;}
+		template<typename T> inline bool empty(const SoaArray<T> &a) 			{return a._size == 0;}
+
+		template<typename T> inline float *x(SoaArray<T> &a) 					{return a._streams[0];}
+		template<typename T> inline const float *x(const SoaArray<T> &a) 		{return a._streams[0];}
+		template<typename T> inline float *y(SoaArray<T> &a) 					{return a._streams[1];}
+		template<typename T> inline const float *y(const SoaArray<T> &a) 		{return a._streams[1];}
+		template<typename T> inline float *z(SoaArray<T> &a) 					{return a._streams[2];}
+		template<typename T> inline const float *z(const SoaArray<T> &a) 		{return a._streams[2];}
+		template<typename T> inline float *w(SoaArray<T> &a) 					{return a._streams[3];}
+		template<typename T> inline const float *w(const SoaArray<T> &a) 		{return a._streams[3];}
+
+		template<typename T> inline T get(const SoaArray<T> &a, uint32_t i)
+		{
+			T item;
+			float *f = &item.x;
+			for (uint32_t c=0; c<soa_array_internal::Components<T>::VALUE; ++c)
+				f[c] = a._streams[c][i];
+			return item;
+		}
+
+		template<typename T> inline void set(SoaArray<T> &a, uint32_t i, const T &item)
+		{
+			const float *f = &item.x;
+			for (uint32_t c=0; c<soa_array_internal::Components<T>::VALUE; ++c)
+				a._streams[c][i] = f[c];
+		}
+
+		template<typename T> inline void clear(SoaArray<T> &a) {resize(a, 0);}
+		template<typename T> inline void trim(SoaArray<T> &a) {set_capacity(a, a._size);}
+
+		template<typename T> void resize(SoaArray<T> &a, uint32_t new_size)
+		{
+			if (new_size > a._capacity)
+				grow(a, new_size);
+			a._size = new_size;
+		}
+
+		template<typename T> inline void reserve(SoaArray<T> &a, uint32_t new_capacity)
+		{
+			if (new_capacity > a._capacity)
+				set_capacity(a, new_capacity);
+		}
+
+		template<typename T> void set_capacity(SoaArray<T> &a, uint32_t new_capacity)
+		{
+			using namespace soa_array_internal;
+			const uint32_t components = Components<T>::VALUE;
+
+			new_capacity = (new_capacity + PADDING - 1) / PADDING * PADDING;
+			if (new_capacity == a._capacity)
+				return;
+
+			if (new_capacity < a._size)
+				resize(a, new_capacity);
+
+			// All the streams share one allocation. Since the capacity is a
+			// multiple of the padding, each stream starts at the alignment.
+			float *old_data = a._streams[0];
+			float *new_data = 0;
+			if (new_capacity > 0)
+				new_data = (float *)a._allocator->allocate(sizeof(float)*new_capacity*components, ALIGNMENT);
+			for (uint32_t c=0; c<components; ++c) {
+				float *stream = new_data ? new_data + c*new_capacity : 0;
+				if (a._size)
+					memcpy(stream, a._streams[c], sizeof(float)*a._size);
+				a._streams[c] = stream;
+			}
+			a._allocator->deallocate(old_data);
+			a._capacity = new_capacity;
+		}
+
+		template<typename T> void grow(SoaArray<T> &a, uint32_t min_capacity)
+		{
+			uint32_t new_capacity = a._capacity*2 + soa_array_internal::PADDING;
+			if (new_capacity < min_capacity)
+				new_capacity = min_capacity;
+			set_capacity(a, new_capacity);
+		}
+
+		template<typename T> inline void push_back(SoaArray<T> &a, const T &item)
+		{
+			if (a._size + 1 > a._capacity)
+				grow(a);
+			set(a, a._size++, item);
+		}
+
+		template<typename T> inline void pop_back(SoaArray<T> &a)
+		{
+			a._size--;
+		}
+
+		template<typename T> void from_aos(SoaArray<T> &a, const T *items, uint32_t n)
+		{
+			resize(a, n);
+			soa_array_internal::gather(&items->x, soa_array_internal::Components<T>::VALUE, n, a._streams);
+		}
+
+		template<typename T> void to_aos(const SoaArray<T> &a, T *out)
+		{
+			soa_array_internal::scatter(a._streams, soa_array_internal::Components<T>::VALUE, a._size, &out->x);
+		}
+	}
+
+	template<typename T>
+	inline SoaArray<T>::SoaArray(Allocator &allocator) : _allocator(&allocator), _size(0), _capacity(0)
+	{
+		_streams[0] = _streams[1] = _streams[2] = _streams[3] = 0;
+	}
+
+	template<typename T>
+	inline SoaArray<T>::~SoaArray()
+	{
+		_allocator->deallocate(_streams[0]);
+	}
+
+	template<typename T>
+	SoaArray<T>::SoaArray(const SoaArray<T> &other) : _allocator(other._allocator), _size(0), _capacity(0)
+	{
+		_streams[0] = _streams[1] = _streams[2] = _streams[3] = 0;
+		*this = other;
+	}
+
+	template<typename T>
+	SoaArray<T> &SoaArray<T>::operator=(const SoaArray<T> &other)
+	{
+		const uint32_t n = other._size;
+		soa_array::resize(*this, n);
+		for (uint32_t c=0; c<soa_array_internal::Components<T>::VALUE; ++c) {
+			if (n)
+				memcpy(_streams[c], other._streams[c], sizeof(float)*n);
+		}
+		return *this;
+	}
+}
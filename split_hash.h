@@ -0,0 +1,229 @@
+#pragma once
+
+#include "array.h"
+#include "collection_types.h"
+
+namespace foundation {
+
+	/// The split hash uses the same "list-in-an-array" as the regular hash, but
+	/// the entry fields are kept in three parallel arrays indexed by entry:
+	/// _keys, _next and _values. A probe chain only reads keys and links, and a
+	/// value is only loaded once its key has been found.
+	///
+	/// When items are removed, the last entry is moved into the hole, so all
+	/// three arrays stay tightly packed.
+
+	namespace hash
+	{
+		/// Returns true if the specified key exists in the hash.
+		template<typename T> bool has(const SplitHash<T> &h, uint64_t key);
+
+		/// Returns the value stored for the specified key, or deffault if the key
+		/// does not exist in the hash.
+		template<typename T> const T &get(const SplitHash<T> &h, uint64_t key, const T &deffault);
+
+		/// Sets the value for the key.
+		template<typename T> void set(SplitHash<T> &h, uint64_t key, const T &value);
+
+		/// Removes the key from the hash if it exists.
+		template<typename T> void remove(SplitHash<T> &h, uint64_t key);
+
+		/// Grows the hash lookup table to at least the specified size. It never
+		/// shrinks. (The table will grow automatically when 70 % full.)
+		template<typename T> void reserve(SplitHash<T> &h, uint32_t size);
+
+		/// Remove all elements from the hash.
+		template<typename T> void clear(SplitHash<T> &h);
+	}
+
+	namespace split_hash
+	{
+		/// Returns the number of entries in the hash.
+		template<typename T> uint32_t size(const SplitHash<T> &h);
+
+		/// Returns the keys and values of the entries. Both arrays have size()
+		/// elements in the same (random) order and can be used to efficiently
+		/// iterate over the hash.
+		template<typename T> const uint64_t *keys(const SplitHash<T> &h);
+		template<typename T> const T *values(const SplitHash<T> &h);
+	}
+
+	namespace split_hash_internal
+	{
+		const uint32_t END_OF_LIST = 0xffffffffu;
+
+		struct FindResult
+		{
+			uint32_t hash_i;
+			uint32_t data_prev;
+			uint32_t data_i;
+		};
+
+		template<typename T> FindResult find(const SplitHash<T> &h, uint64_t key)
+		{
+			FindResult fr;
+			fr.hash_i = END_OF_LIST;
+			fr.data_prev = END_OF_LIST;
+			fr.data_i = END_OF_LIST;
+
+			if (array::size(h._hash) == 0)
+				return fr;
+
+			fr.hash_i = key % array::size(h._hash);
+			fr.data_i = h._hash[fr.hash_i];
+			while (fr.data_i != END_OF_LIST) {
+				if (h._keys[fr.data_i] == key)
+					return fr;
+				fr.data_prev = fr.data_i;
+				fr.data_i = h._next[fr.data_i];
+			}
+			return fr;
+		}
+
+		/// Finds the links to the entry with index i.
+		template<typename T> FindResult find_index(const SplitHash<T> &h, uint32_t i)
+		{
+			FindResult fr;
+			fr.hash_i = h._keys[i] % array::size(h._hash);
+			fr.data_prev = END_OF_LIST;
+			fr.data_i = h._hash[fr.hash_i];
+			while (fr.data_i != i) {
+				fr.data_prev = fr.data_i;
+				fr.data_i = h._next[fr.data_i];
+			}
+			return fr;
+		}
+
+		template<typename T> void erase(SplitHash<T> &h, const FindResult &fr)
+		{
+			if (fr.data_prev == END_OF_LIST)
+				h._hash[fr.hash_i] = h._next[fr.data_i];
+			else
+				h._next[fr.data_prev] = h._next[fr.data_i];
+
+			const uint32_t last_i = array::size(h._keys) - 1;
+			if (fr.data_i != last_i) {
+				const FindResult last = find_index(h, last_i);
+				h._keys[fr.data_i] = h._keys[last_i];
+				h._next[fr.data_i] = h._next[last_i];
+				h._values[fr.data_i] = h._values[last_i];
+				if (last.data_prev != END_OF_LIST)
+					h._next[last.data_prev] = fr.data_i;
+				else
+					h._hash[last.hash_i] = fr.data_i;
+			}
+
+			array::pop_back(h._keys);
+			array::pop_back(h._next);
+			array::pop_back(h._values);
+		}
+
+		template<typename T> void rehash(SplitHash<T> &h, uint32_t new_size)
+		{
+			array::resize(h._hash, new_size);
+			for (uint32_t i=0; i<new_size; ++i)
+				h._hash[i] = END_OF_LIST;
+
+			// The entries don't move, only the links need to be rebuilt. Insert
+			// in reverse to keep the chains in entry order.
+			for (uint32_t i = array::size(h._keys); i-- > 0; ) {
+				const uint32_t hash_i = h._keys[i] % new_size;
+				h._next[i] = h._hash[hash_i];
+				h._hash[hash_i] = i;
+			}
+		}
+
+		template<typename T> bool full(const SplitHash<T> &h)
+		{
+			const float max_load_factor = 0.7f;
+			return array::size(h._keys) >= array::size(h._hash) * max_load_factor;
+		}
+
+		template<typename T> void grow(SplitHash<T> &h)
+		{
+			const uint32_t new_size = array::size(h._keys) * 2 + 10;
+			rehash(h, new_size);
+		}
+	}
+
+	namespace hash
+	{
+		template<typename T> bool has(const SplitHash<T> &h, uint64_t key)
+		{
+			return split_hash_internal::find(h, key).data_i != split_hash_internal::END_OF_LIST;
+		}
+
+		template<typename T> const T &get(const SplitHash<T> &h, uint64_t key, const T &deffault)
+		{
+			const uint32_t i = split_hash_internal::find(h, key).data_i;
+			return i == split_hash_internal::END_OF_LIST ? deffault : h._values[i];
+		}
+
+		template<typename T> void set(SplitHash<T> &h, uint64_t key, const T &value)
+		{
+			if (array::size(h._hash) == 0)
+				split_hash_internal::grow(h);
+
+			const split_hash_internal::FindResult fr = split_hash_internal::find(h, key);
+			if (fr.data_i != split_hash_internal::END_OF_LIST) {
+				h._values[fr.data_i] = value;
+				return;
+			}
+
+			const uint32_t i = array::size(h._keys);
+			array::push_back(h._keys, key);
+			array::push_back(h._next, split_hash_internal::END_OF_LIST);
+			array::push_back(h._values, value);
+			if (fr.data_prev == split_hash_internal::END_OF_LIST)
+				h._hash[fr.hash_i] = i;
+			else
+				h._next[fr.data_prev] = i;
+
+			if (split_hash_internal::full(h))
+				split_hash_internal::grow(h);
+		}
+
+		template<typename T> void remove(SplitHash<T> &h, uint64_t key)
+		{
+			const split_hash_internal::FindResult fr = split_hash_internal::find(h, key);
+			if (fr.data_i != split_hash_internal::END_OF_LIST)
+				split_hash_internal::erase(h, fr);
+		}
+
+		template<typename T> void reserve(SplitHash<T> &h, uint32_t size)
+		{
+			if (size > array::size(h._hash))
+				split_hash_internal::rehash(h, size);
+		}
+
+		template<typename T> void clear(SplitHash<T> &h)
+		{
+			array::clear(h._hash);
+			array::clear(h._keys);
+			array::clear(h._next);
+			array::clear(h._values);
+		}
+	}
+
+	namespace split_hash
+	{
+		template<typename T> inline uint32_t size(const SplitHash<T> &h)
+		{
+			return array::size(h._keys);
+		}
+
+		template<typename T> inline const uint64_t *keys(const SplitHash<T> &h)
+		{
+			return array::begin(h._keys);
+		}
+
+		template<typename T> inline const T *values(const SplitHash<T> &h)
+		{
+			return array::begin(h._values);
+		}
+	}
+
+	template <typename T> SplitHash<T>::SplitHash(Allocator &a) :
+		_hash(a), _keys(a), _next(a), _values(a)
+	{}
+}
@@ -0,0 +1,133 @@
+#include "string_pool.h"
+#include "array.h"
+#include "hash.h"
+#include "murmur_hash.h"
+
+#include <string.h>
+
+namespace foundation
+{
+	namespace
+	{
+		const uint32_t NOT_FOUND = 0xffffffffu;
+
+		/// Each chunk starts with a pointer to the previous chunk.
+		const uint32_t CHUNK_HEADER = sizeof(char *);
+
+		inline uint32_t string_length(const char *s)
+		{
+			return *(const uint32_t *)(s - sizeof(uint32_t));
+		}
+
+		/// Allocates room for a string of length len in the current chunk (or a
+		/// new one) and returns a pointer to where the characters should go.
+		char *allocate_string(StringPool &p, uint32_t len)
+		{
+			// Keep the length fields aligned.
+			const uint32_t size = (sizeof(uint32_t) + len + 1 + 3) & ~3u;
+			if (p._used + size > p._capacity) {
+				const uint32_t capacity = CHUNK_HEADER + size > p._chunk_size ? CHUNK_HEADER + size : p._chunk_size;
+				char *chunk = (char *)p._allocator->allocate(capacity, alignof(char *));
+				*(char **)chunk = p._chunks;
+				p._chunks = chunk;
+				p._used = CHUNK_HEADER;
+				p._capacity = capacity;
+				p._bytes += capacity;
+			}
+			char *record = p._chunks + p._used;
+			p._used += size;
+			*(uint32_t *)record = len;
+			return record + sizeof(uint32_t);
+		}
+
+		inline bool equal(const char *interned, const char *s, uint32_t len)
+		{
+			return string_length(interned) == len && memcmp(interned, s, len) == 0;
+		}
+	}
+
+	namespace string_pool
+	{
+		uint64_t intern(StringPool &p, const char *s, uint32_t len, bool *collision)
+		{
+			const uint64_t id = murmur_hash_64(s, len, 0);
+			const uint32_t i = hash::get(p._ids, id, NOT_FOUND);
+			if (collision)
+				*collision = false;
+			if (i != NOT_FOUND) {
+				if (!equal(p._strings[i], s, len)) {
+					++p._collisions;
+					if (collision)
+						*collision = true;
+				}
+				return id;
+			}
+
+			char *copy = allocate_string(p, len);
+			memcpy(copy, s, len);
+			copy[len] = 0;
+			hash::set(p._ids, id, array::size(p._strings));
+			array::push_back(p._strings, (const char *)copy);
+			return id;
+		}
+
+		uint64_t intern(StringPool &p, const char *s, bool *collision)
+		{
+			return intern(p, s, (uint32_t)strlen(s), collision);
+		}
+
+		bool lookup(const StringPool &p, const char *s, uint32_t len, uint64_t *id)
+		{
+			const uint64_t h = murmur_hash_64(s, len, 0);
+			const uint32_t i = hash::get(p._ids, h, NOT_FOUND);
+			if (i == NOT_FOUND || !equal(p._strings[i], s, len))
+				return false;
+			*id = h;
+			return true;
+		}
+
+		bool lookup(const StringPool &p, const char *s, uint64_t *id)
+		{
+			return lookup(p, s, (uint32_t)strlen(s), id);
+		}
+
+		const char *to_string(const StringPool &p, uint64_t id, uint32_t *len)
+		{
+			const uint32_t i = hash::get(p._ids, id, NOT_FOUND);
+			if (i == NOT_FOUND)
+				return 0;
+			if (len)
+				*len = string_length(p._strings[i]);
+			return p._strings[i];
+		}
+
+		uint32_t size(const StringPool &p)
+		{
+			return array::size(p._strings);
+		}
+
+		uint32_t collisions(const StringPool &p)
+		{
+			return p._collisions;
+		}
+
+		uint64_t bytes(const StringPool &p)
+		{
+			return p._bytes;
+		}
+	}
+
+	StringPool::StringPool(Allocator &a, uint32_t chunk_size) :
+		_allocator(&a), _chunk_size(chunk_size), _chunks(0), _used(0), _capacity(0),
+		_collisions(0), _bytes(0), _ids(a), _strings(a)
+	{}
+
+	StringPool::~StringPool()
+	{
+		while (_chunks) {
+			char *previous = *(char **)_chunks;
+			_allocator->deallocate(_chunks);
+			_chunks = previous;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "collection_types.h"
+
+namespace foundation
+{
+	/// The string pool interns strings and identifies them with the 64 bit
+	/// murmur_hash_64() of the string (with seed 0), i.e. the same ID that you
+	/// get by hashing the string yourself. The pool keeps the original strings,
+	/// so IDs can be turned back into strings for debug output, and it detects
+	/// when two different strings hash to the same ID.
+	///
+	/// Each string is stored as a uint32_t length followed by the characters
+	/// and a terminating zero, packed into chunks of chunk_size bytes (strings
+	/// that don't fit get a chunk of their own). A Hash<uint32_t> maps each ID
+	/// to the index of its string.
+	///
+	/// The functions that take a const StringPool don't modify the pool, so
+	/// once the pool has been built, any number of threads can call them
+	/// concurrently, as long as no thread interns new strings at the same time.
+	namespace string_pool
+	{
+		/// Interns the string of length len and returns its ID. If a different
+		/// string with the same ID has already been interned, the collision is
+		/// counted, *collision is set to true (if collision is not 0) and the
+		/// ID of the existing string is returned.
+		uint64_t intern(StringPool &p, const char *s, uint32_t len, bool *collision = 0);
+
+		/// Interns the zero-terminated string s.
+		uint64_t intern(StringPool &p, const char *s, bool *collision = 0);
+
+		/// Returns true and sets *id if the string has been interned.
+		bool lookup(const StringPool &p, const char *s, uint32_t len, uint64_t *id);
+		bool lookup(const StringPool &p, const char *s, uint64_t *id);
+
+		/// Returns the zero-terminated string with the specified ID, or 0 if no
+		/// string with the ID has been interned. If len is not 0, it is set to
+		/// the length of the string.
+		const char *to_string(const StringPool &p, uint64_t id, uint32_t *len = 0);
+
+		/// Returns the number of interned strings.
+		uint32_t size(const StringPool &p);
+
+		/// Returns the number of collisions detected by intern().
+		uint32_t collisions(const StringPool &p);
+
+		/// Returns the number of bytes of chunk memory used by the pool.
+		uint64_t bytes(const StringPool &p);
+	}
+}
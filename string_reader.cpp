@@ -0,0 +1,397 @@
+#include "string_reader.h"
+#include "simd.h"
+#include "string_stream.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(FOUNDATION_SSE2)
+	// The AVX2 path is only used in front of the SSE2 path.
+	#if defined(__GNUC__) && defined(__x86_64__)
+		#include <immintrin.h>
+		#define STRING_READER_AVX2
+	#endif
+#endif
+
+namespace foundation
+{
+	namespace
+	{
+		inline bool is_digit(char c)
+		{
+			return (unsigned char)(c - '0') < 10;
+		}
+
+		inline bool is_whitespace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		}
+
+
+	#if !defined(PLATFORM_BIG_ENDIAN)
+		/// Converts eight ASCII digits to a number with three multiplies, by
+		/// combining pairs of digits, then pairs of pairs, and so on.
+		inline uint32_t parse_eight_digits(const char *p)
+		{
+			uint64_t v;
+			memcpy(&v, p, 8);
+			v -= 0x3030303030303030ull;
+			v = (v * 10 + (v >> 8)) & 0x00ff00ff00ff00ffull;
+			v = (v * 100 + (v >> 16)) & 0x0000ffff0000ffffull;
+			v = (v * 10000 + (v >> 32)) & 0xffffffffull;
+			return (uint32_t)v;
+		}
+	#endif
+
+		/// Parses the unsigned number with the digits at p. first is the start of
+		/// the text, which is returned if there are no digits.
+		ParseResult parse_unsigned(const char *first, const char *p, const char *last, uint64_t max, uint64_t &value)
+		{
+			const char *start = p;
+			while (p != last && *p == '0')
+				++p;
+			const char *digits = p;
+			while (p != last && is_digit(*p))
+				++p;
+			if (p == start)
+				return ParseResult {first, PARSE_INVALID};
+
+			// Numbers with up to 19 digits fit in 64 bits, the 20th digit needs a
+			// check.
+			const uint32_t n = (uint32_t)(p - digits);
+			if (n > 20)
+				return ParseResult {p, PARSE_OUT_OF_RANGE};
+			const char *q = digits;
+			const char *safe_end = digits + (n < 19 ? n : 19);
+			uint64_t v = 0;
+		#if !defined(PLATFORM_BIG_ENDIAN)
+			for (; safe_end - q >= 8; q += 8)
+				v = v * 100000000 + parse_eight_digits(q);
+		#endif
+			for (; q != safe_end; ++q)
+				v = v * 10 + (uint32_t)(*q - '0');
+			if (n == 20) {
+				const uint32_t d = (uint32_t)(*q - '0');
+				if (v > (~(uint64_t)0 - d) / 10)
+					return ParseResult {p, PARSE_OUT_OF_RANGE};
+				v = v * 10 + d;
+			}
+			if (v > max)
+				return ParseResult {p, PARSE_OUT_OF_RANGE};
+			value = v;
+			return ParseResult {p, PARSE_OK};
+		}
+
+		template <typename T> ParseResult parse_signed(const char *first, const char *last, uint64_t max, T &value)
+		{
+			const bool negative = first != last && *first == '-';
+			uint64_t v;
+			ParseResult res = parse_unsigned(first, first + negative, last, max + negative, v);
+			if (res.error == PARSE_OK)
+				value = (T)(negative ? 0 - v : v);
+			return res;
+		}
+
+		/// A decimal number split up while parsing.
+		struct Decimal
+		{
+			bool negative;
+			/// The first 19 significant digits and their exponent.
+			uint64_t mantissa;
+			int32_t exponent;
+			/// True if there were more than 19 significant digits and some of
+			/// the dropped ones were not zero.
+			bool truncated;
+			/// The digits as written and the number of digits after the point.
+			const char *digits;
+			const char *digits_end;
+			int32_t fraction_digits;
+			int32_t explicit_exponent;
+		};
+
+		inline bool starts_with(const char *p, const char *last, const char *s, uint32_t n)
+		{
+			return (uint32_t)(last - p) >= n && memcmp(p, s, n) == 0;
+		}
+
+		/// Parses the syntax of a floating point number. Returns the end of the
+		/// number, first if it isn't a number.
+		const char *parse_decimal(const char *first, const char *last, Decimal &d)
+		{
+			const char *p = first;
+			d.negative = p != last && *p == '-';
+			p += d.negative;
+
+			d.mantissa = 0;
+			d.exponent = 0;
+			d.truncated = false;
+			d.digits = p;
+			d.fraction_digits = 0;
+			d.explicit_exponent = 0;
+
+			uint32_t significant = 0;
+			for (; p != last && is_digit(*p); ++p) {
+				const uint32_t digit = (uint32_t)(*p - '0');
+				if (significant < 19) {
+					d.mantissa = d.mantissa * 10 + digit;
+					significant += d.mantissa != 0;
+				} else {
+					d.truncated |= digit != 0;
+					++d.exponent;
+				}
+			}
+			const bool has_integer = p != d.digits;
+			if (p != last && *p == '.') {
+				const char *fraction = ++p;
+				for (; p != last && is_digit(*p); ++p) {
+					const uint32_t digit = (uint32_t)(*p - '0');
+					if (significant < 19) {
+						d.mantissa = d.mantissa * 10 + digit;
+						significant += d.mantissa != 0;
+						--d.exponent;
+					} else {
+						d.truncated |= digit != 0;
+					}
+				}
+				d.fraction_digits = (int32_t)(p - fraction);
+				if (!has_integer && d.fraction_digits == 0)
+					return first;
+			} else if (!has_integer) {
+				return first;
+			}
+			d.digits_end = p;
+
+			// The exponent is only part of the number if it has digits.
+			if (p != last && (*p == 'e' || *p == 'E')) {
+				const char *q = p + 1;
+				const bool negative_exponent = q != last && *q == '-';
+				q += (q != last && (*q == '-' || *q == '+'));
+				if (q != last && is_digit(*q)) {
+					int32_t e = 0;
+					for (; q != last && is_digit(*q); ++q)
+						e = e < 100000 ? e * 10 + (*q - '0') : e;
+					d.explicit_exponent = negative_exponent ? -e : e;
+					d.exponent += d.explicit_exponent;
+					p = q;
+				}
+			}
+			return p;
+		}
+
+		/// Writes the digits of the number as "<digits>e<exponent>" for strtod().
+		/// Without a decimal point, the result doesn't depend on the locale.
+		/// Only the first 780 significant digits are kept, which is more than
+		/// a double needs, plus a 1 if any of the dropped digits are not zero,
+		/// so the number still rounds correctly.
+		void write_scientific(const Decimal &d, char *s)
+		{
+			const uint32_t MAX_DIGITS = 780;
+			char *p = s;
+			uint32_t n = 0;
+			int32_t dropped = 0;
+			bool sticky = false;
+			for (const char *q = d.digits; q != d.digits_end; ++q) {
+				if (*q == '.' || (n == 0 && *q == '0'))
+					continue;
+				if (n < MAX_DIGITS) {
+					*p++ = *q;
+					++n;
+				} else {
+					sticky |= *q != '0';
+					++dropped;
+				}
+			}
+			int32_t exponent = d.explicit_exponent - d.fraction_digits + dropped;
+			if (sticky) {
+				*p++ = '1';
+				--exponent;
+			}
+			*p++ = 'e';
+			p += string_stream_internal::format_int32(p, exponent);
+			*p = 0;
+		}
+
+		const double DOUBLE_POWERS_OF_TEN[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const float FLOAT_POWERS_OF_TEN[] = {
+			1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+		};
+
+		/// Converts the decimal to T. If the mantissa and the power of ten are
+		/// both exactly representable in T, a single multiply or divide is
+		/// correctly rounded (Clinger's fast path). Other numbers are converted
+		/// with strtod().
+		template <typename T> ParseError convert(const Decimal &d, const T *powers, int32_t max_power, uint64_t max_mantissa, T &value)
+		{
+			T v;
+			if (d.mantissa == 0) {
+				v = 0;
+			} else if (!d.truncated && d.mantissa <= max_mantissa && d.exponent >= -max_power && d.exponent <= max_power) {
+				v = (T)d.mantissa;
+				v = d.exponent < 0 ? v / powers[-d.exponent] : v * powers[d.exponent];
+			} else {
+				char s[800];
+				write_scientific(d, s);
+				v = sizeof(T) == sizeof(float) ? (T)strtof(s, 0) : (T)strtod(s, 0);
+				if (v == 0 || isinf(v))
+					return PARSE_OUT_OF_RANGE;
+			}
+			value = d.negative ? -v : v;
+			return PARSE_OK;
+		}
+
+		template <typename T> ParseResult parse_float(const char *first, const char *last, const T *powers, int32_t max_power, uint64_t max_mantissa, T &value)
+		{
+			const char *p = first + (first != last && *first == '-');
+			if (starts_with(p, last, "inf", 3)) {
+				value = *first == '-' ? -(T)INFINITY : (T)INFINITY;
+				p += starts_with(p, last, "infinity", 8) ? 8 : 3;
+				return ParseResult {p, PARSE_OK};
+			}
+			if (starts_with(p, last, "nan", 3)) {
+				value = *first == '-' ? -(T)NAN : (T)NAN;
+				return ParseResult {p + 3, PARSE_OK};
+			}
+
+			Decimal d;
+			const char *end = parse_decimal(first, last, d);
+			if (end == first)
+				return ParseResult {first, PARSE_INVALID};
+			return ParseResult {end, convert(d, powers, max_power, max_mantissa, value)};
+		}
+	}
+
+	namespace
+	{
+	#if defined(STRING_READER_AVX2)
+		/// Skips 64 bytes at a time with AVX2 while none of them match. Returns
+		/// the block with the first match, or the last bytes that are less than
+		/// a block, for find() to search.
+		__attribute__((target("avx2"))) const char *skip_blocks_avx2(const char *p, const char *end, char c)
+		{
+			const __m256i needle = _mm256_set1_epi8(c);
+			for (; end - p >= 64; p += 64) {
+				const __m256i m0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), needle);
+				const __m256i m1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 32)), needle);
+				if (_mm256_movemask_epi8(_mm256_or_si256(m0, m1)))
+					break;
+			}
+			return p;
+		}
+
+		bool has_avx2()
+		{
+			return __builtin_cpu_supports("avx2");
+		}
+	#endif
+	}
+
+	namespace string_reader_internal
+	{
+		const char *find(const char *p, const char *end, char c)
+		{
+		#if defined(FOUNDATION_SSE2)
+			// Skip 64 bytes per iteration and only find the exact position in
+			// the block that matches.
+			if (end - p >= 64) {
+			#if defined(STRING_READER_AVX2)
+				static const bool avx2 = has_avx2();
+				if (avx2)
+					p = skip_blocks_avx2(p, end, c);
+				else
+			#endif
+				{
+					const __m128i needle = _mm_set1_epi8(c);
+					for (; end - p >= 64; p += 64) {
+						const __m128i m0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), needle);
+						const __m128i m1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 16)), needle);
+						const __m128i m2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 32)), needle);
+						const __m128i m3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 48)), needle);
+						if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(m0, m1), _mm_or_si128(m2, m3))))
+							break;
+					}
+				}
+			}
+			const __m128i needle = _mm_set1_epi8(c);
+			for (; end - p >= 16; p += 16) {
+				const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), needle));
+				if (mask)
+					return p + simd_internal::lowest_bit(mask);
+			}
+		#endif
+			for (; p != end; ++p) {
+				if (*p == c)
+					return p;
+			}
+			return end;
+		}
+	}
+
+	namespace string_reader
+	{
+		void skip_whitespace(StringReader &r)
+		{
+			while (r._p != r._end && is_whitespace(*r._p))
+				++r._p;
+		}
+
+		StringView read_token(StringReader &r)
+		{
+			skip_whitespace(r);
+			StringView v;
+			v.begin = r._p;
+			while (r._p != r._end && !is_whitespace(*r._p))
+				++r._p;
+			v.end = r._p;
+			return v;
+		}
+
+		ParseResult parse(const char *first, const char *last, int32_t &value)
+		{
+			return parse_signed(first, last, 0x7fffffff, value);
+		}
+
+		ParseResult parse(const char *first, const char *last, uint32_t &value)
+		{
+			uint64_t v;
+			const ParseResult res = parse_unsigned(first, first, last, 0xffffffffu, v);
+			if (res.error == PARSE_OK)
+				value = (uint32_t)v;
+			return res;
+		}
+
+		ParseResult parse(const char *first, const char *last, int64_t &value)
+		{
+			return parse_signed(first, last, 0x7fffffffffffffffull, value);
+		}
+
+		ParseResult parse(const char *first, const char *last, uint64_t &value)
+		{
+			return parse_unsigned(first, first, last, ~(uint64_t)0, value);
+		}
+
+		ParseResult parse(const char *first, const char *last, float &value)
+		{
+			return parse_float(first, last, FLOAT_POWERS_OF_TEN, 10, 1ull << 24, value);
+		}
+
+		ParseResult parse(const char *first, const char *last, double &value)
+		{
+			return parse_float(first, last, DOUBLE_POWERS_OF_TEN, 22, 1ull << 53, value);
+		}
+	}
+
+	namespace string_view
+	{
+		bool equals(const StringView &v, const char *s)
+		{
+			const size_t n = strlen(s);
+			return (size_t)(v.end - v.begin) == n && memcmp(v.begin, s, n) == 0;
+		}
+	}
+}
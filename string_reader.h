@@ -0,0 +1,131 @@
+#pragma once
+
+#include "collection_types.h"
+#include "array.h"
+
+namespace foundation
+{
+	/// Result of parsing a number, like std::from_chars(). If the text isn't a
+	/// number, error is PARSE_INVALID and end is the start of the text. If the
+	/// number doesn't fit in the type, error is PARSE_OUT_OF_RANGE and end is
+	/// past the number. The value is only written when error is PARSE_OK.
+	enum ParseError {PARSE_OK, PARSE_INVALID, PARSE_OUT_OF_RANGE};
+
+	struct ParseResult
+	{
+		const char *end;
+		ParseError error;
+	};
+
+	/// Functions for reading text with a StringReader. Lines and tokens are
+	/// returned as StringViews into the text, so nothing is copied.
+	///
+	/// Numbers are parsed without the C library, so they don't depend on the
+	/// locale. The accepted syntax is that of std::from_chars(): an optional
+	/// '-' (but no '+'), digits and for floating point numbers an optional
+	/// fraction and exponent, or inf and nan. Floating point numbers are
+	/// correctly rounded, so a float written with string_stream reads back as
+	/// the same value.
+	namespace string_reader
+	{
+		/// Returns true if all the text has been read.
+		bool at_end(const StringReader &r);
+
+		/// Returns the number of characters left to read.
+		uint64_t remaining(const StringReader &r);
+
+		/// Returns the position of the next character to read.
+		const char *position(const StringReader &r);
+
+		/// Reads up to the next newline and returns the line, without the "\n"
+		/// or "\r\n". The last line doesn't need a newline.
+		StringView read_line(StringReader &r);
+
+		/// Reads up to the next delimiter and returns the text before it. The
+		/// delimiter is skipped. If there is no delimiter, the rest of the text
+		/// is returned.
+		StringView read_until(StringReader &r, char delimiter);
+
+		/// Skips spaces, tabs and newlines.
+		void skip_whitespace(StringReader &r);
+
+		/// Skips whitespace and returns the next run of non-whitespace
+		/// characters. (Returns an empty view at the end of the text.)
+		StringView read_token(StringReader &r);
+
+		/// Parses a number at the position of the reader and moves past it.
+		ParseError read(StringReader &r, int32_t &value);
+		ParseError read(StringReader &r, uint32_t &value);
+		ParseError read(StringReader &r, int64_t &value);
+		ParseError read(StringReader &r, uint64_t &value);
+		ParseError read(StringReader &r, float &value);
+		ParseError read(StringReader &r, double &value);
+
+		/// Parses a number at the start of [first, last).
+		ParseResult parse(const char *first, const char *last, int32_t &value);
+		ParseResult parse(const char *first, const char *last, uint32_t &value);
+		ParseResult parse(const char *first, const char *last, int64_t &value);
+		ParseResult parse(const char *first, const char *last, uint64_t &value);
+		ParseResult parse(const char *first, const char *last, float &value);
+		ParseResult parse(const char *first, const char *last, double &value);
+	}
+
+	namespace string_view
+	{
+		/// Returns the number of characters in the view.
+		inline uint32_t size(const StringView &v) {return (uint32_t)(v.end - v.begin);}
+
+		/// Returns true if the view has the same characters as the C string.
+		bool equals(const StringView &v, const char *s);
+	}
+
+	namespace string_reader_internal
+	{
+		/// Returns the first occurrence of c in [p, end), or end.
+		const char *find(const char *p, const char *end, char c);
+
+		template <typename T> inline ParseError read(StringReader &r, T &value)
+		{
+			const ParseResult res = string_reader::parse(r._p, r._end, value);
+			r._p = res.end;
+			return res.error;
+		}
+	}
+
+	namespace string_reader
+	{
+		inline bool at_end(const StringReader &r) {return r._p == r._end;}
+		inline uint64_t remaining(const StringReader &r) {return (uint64_t)(r._end - r._p);}
+		inline const char *position(const StringReader &r) {return r._p;}
+
+		inline StringView read_line(StringReader &r)
+		{
+			StringView v;
+			v.begin = r._p;
+			v.end = string_reader_internal::find(r._p, r._end, '\n');
+			r._p = v.end == r._end ? r._end : v.end + 1;
+			if (v.end != v.begin && v.end[-1] == '\r')
+				--v.end;
+			return v;
+		}
+
+		inline StringView read_until(StringReader &r, char delimiter)
+		{
+			StringView v;
+			v.begin = r._p;
+			v.end = string_reader_internal::find(r._p, r._end, delimiter);
+			r._p = v.end == r._end ? r._end : v.end + 1;
+			return v;
+		}
+
+		inline ParseError read(StringReader &r, int32_t &value) {return string_reader_internal::read(r, value);}
+		inline ParseError read(StringReader &r, uint32_t &value) {return string_reader_internal::read(r, value);}
+		inline ParseError read(StringReader &r, int64_t &value) {return string_reader_internal::read(r, value);}
+		inline ParseError read(StringReader &r, uint64_t &value) {return string_reader_internal::read(r, value);}
+		inline ParseError read(StringReader &r, float &value) {return string_reader_internal::read(r, value);}
+		inline ParseError read(StringReader &r, double &value) {return string_reader_internal::read(r, value);}
+	}
+
+	inline StringReader::StringReader(const char *begin, const char *end) : _p(begin), _end(end) {}
+	inline StringReader::StringReader(const Array<char> &a) : _p(array::begin(a)), _end(array::end(a)) {}
+}
@@ -2,8 +2,365 @@
 
 #include <stdarg.h>
 
-namespace foundation 
+namespace foundation
 {
+	namespace
+	{
+		const char DIGIT_PAIRS[] =
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+
+		inline uint32_t decimal_length(uint32_t v)
+		{
+			if (v < 10) return 1;
+			if (v < 100) return 2;
+			if (v < 1000) return 3;
+			if (v < 10000) return 4;
+			if (v < 100000) return 5;
+			if (v < 1000000) return 6;
+			if (v < 10000000) return 7;
+			if (v < 100000000) return 8;
+			if (v < 1000000000) return 9;
+			return 10;
+		}
+
+		/// Writes the n digits of v to p, two digits at a time.
+		inline void write_digits(char *p, uint32_t v, uint32_t n)
+		{
+			char *q = p + n;
+			while (v >= 100) {
+				const uint32_t pair = (v % 100) * 2;
+				v /= 100;
+				q -= 2;
+				memcpy(q, DIGIT_PAIRS + pair, 2);
+			}
+			if (v >= 10) {
+				q -= 2;
+				memcpy(q, DIGIT_PAIRS + v * 2, 2);
+			} else
+				*--q = char('0' + v);
+		}
+
+		// Shortest round trip float to decimal conversion with the Ryu
+		// algorithm by Ulf Adams (https://github.com/ulfjack/ryu). The value
+		// and the halfway points to its neighbours are multiplied by a power of
+		// five (or its inverse) in fixed point, which is precise enough to find
+		// the shortest decimal inside the rounding interval of the float.
+
+		const int32_t FLOAT_MANTISSA_BITS = 23;
+		const int32_t FLOAT_BIAS = 127;
+		const int32_t FLOAT_POW5_INV_BITCOUNT = 59;
+		const int32_t FLOAT_POW5_BITCOUNT = 61;
+
+		/// FLOAT_POW5_INV_SPLIT[i] = 2^(bits(5^i) - 1 + 59) / 5^i + 1
+		const uint64_t FLOAT_POW5_INV_SPLIT[31] = {
+			0x0800000000000001ull, 0x0666666666666667ull, 0x051eb851eb851eb9ull, 0x04189374bc6a7efaull,
+			0x068db8bac710cb2aull, 0x053e2d6238da3c22ull, 0x0431bde82d7b634eull, 0x06b5fca6af2bd216ull,
+			0x055e63b88c230e78ull, 0x044b82fa09b5a52dull, 0x06df37f675ef6eaeull, 0x057f5ff85e592558ull,
+			0x0465e6604b7a8447ull, 0x0709709a125da071ull, 0x05a126e1a84ae6c1ull, 0x0480ebe7b9d58567ull,
+			0x0734aca5f6226f0bull, 0x05c3bd5191b525a3ull, 0x049c97747490eae9ull, 0x0760f253edb4ab0eull,
+			0x05e72843249088d8ull, 0x04b8ed0283a6d3e0ull, 0x078e480405d7b966ull, 0x060b6cd004ac9452ull,
+			0x04d5f0a66a23a9dbull, 0x07bcb43d769f762bull, 0x063090312bb2c4efull, 0x04f3a68dbc8f03f3ull,
+			0x07ec3daf94180651ull, 0x065697bfa9acd1daull, 0x051212ffbaf0a7e2ull,
+		};
+
+		/// FLOAT_POW5_SPLIT[i] = 5^i scaled to 61 bits
+		const uint64_t FLOAT_POW5_SPLIT[47] = {
+			0x1000000000000000ull, 0x1400000000000000ull, 0x1900000000000000ull, 0x1f40000000000000ull,
+			0x1388000000000000ull, 0x186a000000000000ull, 0x1e84800000000000ull, 0x1312d00000000000ull,
+			0x17d7840000000000ull, 0x1dcd650000000000ull, 0x12a05f2000000000ull, 0x174876e800000000ull,
+			0x1d1a94a200000000ull, 0x12309ce540000000ull, 0x16bcc41e90000000ull, 0x1c6bf52634000000ull,
+			0x11c37937e0800000ull, 0x16345785d8a00000ull, 0x1bc16d674ec80000ull, 0x1158e460913d0000ull,
+			0x15af1d78b58c4000ull, 0x1b1ae4d6e2ef5000ull, 0x10f0cf064dd59200ull, 0x152d02c7e14af680ull,
+			0x1a784379d99db420ull, 0x108b2a2c28029094ull, 0x14adf4b7320334b9ull, 0x19d971e4fe8401e7ull,
+			0x1027e72f1f128130ull, 0x1431e0fae6d7217cull, 0x193e5939a08ce9dbull, 0x1f8def8808b02452ull,
+			0x13b8b5b5056e16b3ull, 0x18a6e32246c99c60ull, 0x1ed09bead87c0378ull, 0x13426172c74d822bull,
+			0x1812f9cf7920e2b6ull, 0x1e17b84357691b64ull, 0x12ced32a16a1b11eull, 0x178287f49c4a1d66ull,
+			0x1d6329f1c35ca4bfull, 0x125dfa371a19e6f7ull, 0x16f578c4e0a060b5ull, 0x1cb2d6f618c878e3ull,
+			0x11efc659cf7d4b8dull, 0x166bb7f0435c9e71ull, 0x1c06a5ec5433c60dull,
+		};
+
+		/// Returns the number of bits of 5^e.
+		inline int32_t pow5_bits(int32_t e) {return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;}
+
+		/// Returns floor(log10(2^e)) and floor(log10(5^e)).
+		inline uint32_t log10_pow2(int32_t e) {return ((uint32_t)e * 78913) >> 18;}
+		inline uint32_t log10_pow5(int32_t e) {return ((uint32_t)e * 732923) >> 20;}
+
+		inline bool multiple_of_power_of_5(uint32_t v, uint32_t p)
+		{
+			uint32_t count = 0;
+			while (v % 5 == 0) {
+				v /= 5;
+				++count;
+			}
+			return count >= p;
+		}
+
+		inline bool multiple_of_power_of_2(uint32_t v, uint32_t p)
+		{
+			return (v & ((1u << p) - 1)) == 0;
+		}
+
+		inline uint32_t mul_shift(uint32_t m, uint64_t factor, int32_t shift)
+		{
+			const uint64_t bits0 = (uint64_t)m * (uint32_t)factor;
+			const uint64_t bits1 = (uint64_t)m * (uint32_t)(factor >> 32);
+			return (uint32_t)(((bits0 >> 32) + bits1) >> (shift - 32));
+		}
+
+		/// Converts a finite, non-zero float, given by its mantissa and exponent
+		/// bits, to the shortest digits * 10^exponent that reads back as the
+		/// same float.
+		void float_to_decimal(uint32_t ieee_mantissa, uint32_t ieee_exponent, uint32_t &digits, int32_t &exponent)
+		{
+			int32_t e2;
+			uint32_t m2;
+			if (ieee_exponent == 0) {
+				e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+				m2 = ieee_mantissa;
+			} else {
+				e2 = (int32_t)ieee_exponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+				m2 = (1u << FLOAT_MANTISSA_BITS) | ieee_mantissa;
+			}
+			const bool accept_bounds = (m2 & 1) == 0;
+
+			// The value and the halfway points to its neighbours, times four.
+			const uint32_t mv = 4 * m2;
+			const uint32_t mp = 4 * m2 + 2;
+			const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+			const uint32_t mm = 4 * m2 - 1 - mm_shift;
+
+			uint32_t vr, vp, vm;
+			int32_t e10;
+			bool vm_trailing_zeros = false, vr_trailing_zeros = false;
+			uint32_t last_removed_digit = 0;
+			if (e2 >= 0) {
+				const uint32_t q = log10_pow2(e2);
+				e10 = (int32_t)q;
+				const int32_t k = FLOAT_POW5_INV_BITCOUNT + pow5_bits((int32_t)q) - 1;
+				const int32_t i = -e2 + (int32_t)q + k;
+				vr = mul_shift(mv, FLOAT_POW5_INV_SPLIT[q], i);
+				vp = mul_shift(mp, FLOAT_POW5_INV_SPLIT[q], i);
+				vm = mul_shift(mm, FLOAT_POW5_INV_SPLIT[q], i);
+				if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+					// One removed digit is needed for rounding, even if the loop
+					// below doesn't remove any.
+					const int32_t l = FLOAT_POW5_INV_BITCOUNT + pow5_bits((int32_t)(q - 1)) - 1;
+					last_removed_digit = mul_shift(mv, FLOAT_POW5_INV_SPLIT[q - 1], -e2 + (int32_t)q - 1 + l) % 10;
+				}
+				if (q <= 9) {
+					// Only one of mp, mv and mm can be a multiple of 5, if any.
+					if (mv % 5 == 0)
+						vr_trailing_zeros = multiple_of_power_of_5(mv, q);
+					else if (accept_bounds)
+						vm_trailing_zeros = multiple_of_power_of_5(mm, q);
+					else
+						vp -= multiple_of_power_of_5(mp, q);
+				}
+			} else {
+				const uint32_t q = log10_pow5(-e2);
+				e10 = (int32_t)q + e2;
+				const int32_t i = -e2 - (int32_t)q;
+				const int32_t k = pow5_bits(i) - FLOAT_POW5_BITCOUNT;
+				int32_t j = (int32_t)q - k;
+				vr = mul_shift(mv, FLOAT_POW5_SPLIT[i], j);
+				vp = mul_shift(mp, FLOAT_POW5_SPLIT[i], j);
+				vm = mul_shift(mm, FLOAT_POW5_SPLIT[i], j);
+				if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+					j = (int32_t)q - 1 - (pow5_bits(i + 1) - FLOAT_POW5_BITCOUNT);
+					last_removed_digit = mul_shift(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10;
+				}
+				if (q <= 1) {
+					// mv has at least q trailing zero bits, so vr has at least q
+					// trailing zero digits.
+					vr_trailing_zeros = true;
+					if (accept_bounds)
+						vm_trailing_zeros = mm_shift == 1;
+					else
+						--vp;
+				} else if (q < 31)
+					vr_trailing_zeros = multiple_of_power_of_2(mv, q - 1);
+			}
+
+			// Remove digits while the interval [vm, vp] still contains a shorter
+			// number.
+			int32_t removed = 0;
+			if (vm_trailing_zeros || vr_trailing_zeros) {
+				while (vp / 10 > vm / 10) {
+					vm_trailing_zeros &= vm % 10 == 0;
+					vr_trailing_zeros &= last_removed_digit == 0;
+					last_removed_digit = vr % 10;
+					vr /= 10;
+					vp /= 10;
+					vm /= 10;
+					++removed;
+				}
+				if (vm_trailing_zeros) {
+					while (vm % 10 == 0) {
+						vr_trailing_zeros &= last_removed_digit == 0;
+						last_removed_digit = vr % 10;
+						vr /= 10;
+						vp /= 10;
+						vm /= 10;
+						++removed;
+					}
+				}
+				// Round exact halfway cases to even.
+				if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+					last_removed_digit = 4;
+				digits = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed_digit >= 5);
+			} else {
+				while (vp / 10 > vm / 10) {
+					last_removed_digit = vr % 10;
+					vr /= 10;
+					vp /= 10;
+					vm /= 10;
+					++removed;
+				}
+				digits = vr + (vr == vm || last_removed_digit >= 5);
+			}
+			exponent = e10 + removed;
+		}
+	}
+
+	namespace string_stream_internal
+	{
+		uint32_t format_uint32(char *p, uint32_t i)
+		{
+			const uint32_t n = decimal_length(i);
+			write_digits(p, i, n);
+			return n;
+		}
+
+		uint32_t format_int32(char *p, int32_t i)
+		{
+			if (i >= 0)
+				return format_uint32(p, (uint32_t)i);
+			*p = '-';
+			return 1 + format_uint32(p + 1, 0u - (uint32_t)i);
+		}
+
+		uint32_t format_hex64(char *p, uint64_t i)
+		{
+			const char *hex = "0123456789abcdef";
+			uint32_t n = 1;
+			for (uint64_t rest = i >> 4; rest; rest >>= 4)
+				++n;
+			for (uint32_t j = n; j-- > 0; ) {
+				p[j] = hex[i & 15];
+				i >>= 4;
+			}
+			return n;
+		}
+
+		uint32_t format_float(char *p, float f)
+		{
+			uint32_t bits;
+			memcpy(&bits, &f, sizeof(bits));
+			const uint32_t mantissa = bits & ((1u << FLOAT_MANTISSA_BITS) - 1);
+			const uint32_t exponent_bits = (bits >> FLOAT_MANTISSA_BITS) & 0xff;
+
+			char *start = p;
+			if (bits >> 31)
+				*p++ = '-';
+			if (exponent_bits == 0xff) {
+				memcpy(p, mantissa ? "nan" : "inf", 3);
+				return (uint32_t)(p - start) + 3;
+			}
+			if (exponent_bits == 0 && mantissa == 0) {
+				*p++ = '0';
+				return (uint32_t)(p - start);
+			}
+
+			uint32_t digits;
+			int32_t exponent;
+			float_to_decimal(mantissa, exponent_bits, digits, exponent);
+			const int32_t n = (int32_t)decimal_length(digits);
+
+			// The exponent in scientific notation, d.ddd * 10^e. Like %g, use
+			// scientific notation for small and large exponents.
+			const int32_t e = exponent + n - 1;
+			if (e >= -4 && e < 9) {
+				if (e >= n - 1) {
+					// An integer, pad with zeros.
+					write_digits(p, digits, n);
+					p += n;
+					for (int32_t i=n; i<=e; ++i)
+						*p++ = '0';
+				} else if (e >= 0) {
+					// The decimal point is within the digits.
+					write_digits(p + 1, digits, n);
+					memmove(p, p + 1, e + 1);
+					p[e + 1] = '.';
+					p += n + 1;
+				} else {
+					*p++ = '0';
+					*p++ = '.';
+					for (int32_t i=-1; i>e; --i)
+						*p++ = '0';
+					write_digits(p, digits, n);
+					p += n;
+				}
+			} else {
+				write_digits(p + 1, digits, n);
+				p[0] = p[1];
+				if (n > 1) {
+					p[1] = '.';
+					p += n + 1;
+				} else
+					p += 1;
+				*p++ = 'e';
+				*p++ = e < 0 ? '-' : '+';
+				memcpy(p, DIGIT_PAIRS + (e < 0 ? -e : e) * 2, 2);
+				p += 2;
+			}
+			return (uint32_t)(p - start);
+		}
+	}
+
+	namespace string_stream_internal
+	{
+		uint32_t format_length(uint32_t literal_length, const FormatArg *args, uint32_t num_args)
+		{
+			uint32_t n = literal_length;
+			for (uint32_t i=0; i<num_args; ++i)
+				n += args[i].length;
+			return n;
+		}
+
+		uint32_t write_format(char *p, const char *s, const FormatSegment *segments, uint32_t num_segments, const FormatArg *args)
+		{
+			char *start = p;
+			for (uint32_t i=0; i<num_segments; ++i) {
+				const FormatSegment &segment = segments[i];
+				if (segment.arg == FORMAT_LITERAL) {
+					memcpy(p, s + segment.offset, segment.length);
+					p += segment.length;
+					continue;
+				}
+				const FormatArg &a = args[segment.arg];
+				switch (a.type) {
+				case FormatArg::CHAR: *p++ = a.c; break;
+				case FormatArg::STRING: memcpy(p, a.s, a.length); p += a.length; break;
+				case FormatArg::FLOAT: p += format_float(p, a.f); break;
+				case FormatArg::INT32: p += format_int32(p, a.i); break;
+				case FormatArg::UINT32: p += format_uint32(p, a.u); break;
+				case FormatArg::UINT64: p += format_hex64(p, a.x); break;
+				}
+			}
+			return (uint32_t)(p - start);
+		}
+	}
+
 	namespace string_stream
 	{
 		Buffer & printf(Buffer &b, const char *format, ...)
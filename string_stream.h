@@ -16,7 +16,10 @@ namespace foundation
 	{
 		typedef Array<char> Buffer;
 
-		/// Dumps the item to the stream using a default formatting.
+		/// Dumps the item to the stream using a default formatting. Numbers are
+		/// formatted without going through printf: floats with the shortest
+		/// representation that reads back as the same value, integers in
+		/// decimal and uint64_t in hexadecimal.
 		Buffer & operator<<(Buffer &b, char c);
 		Buffer & operator<<(Buffer &b, const char *s);
 		Buffer & operator<<(Buffer &b, float f);
@@ -27,6 +30,18 @@ namespace foundation
 		/// Uses printf to print formatted data to the stream.
 		Buffer & printf(Buffer &b, const char *format, ...);
 
+		/// Writes the format string to the stream, replacing each {} with the
+		/// next argument, formatted like operator<< does. Use {{ and }} for
+		/// literal braces. The format string must be wrapped in FORMAT_STRING(),
+		/// which lets it be parsed at compile time, so a format string with the
+		/// wrong number of arguments or unmatched braces doesn't compile:
+		///
+		///     format(b, FORMAT_STRING("{} of {} done\n"), done, total);
+		///
+		/// The arguments can be char, const char *, float, int32_t, uint32_t and
+		/// uint64_t. The buffer is grown at most once per call.
+		template <typename F, typename... Args> Buffer & format(Buffer &b, F format_string, const Args &... args);
+
 		/// Pushes the raw data to the stream.
 		Buffer & push(Buffer &b, const char *data, uint32_t n);
 
@@ -48,15 +63,143 @@ namespace foundation
 	{
 		using namespace string_stream;
 
-		template <typename T>
-		inline Buffer &printf_small(Buffer &b, const char *fmt, const T &t)
+		/// Maximum number of characters written by the format functions.
+		const uint32_t MAX_NUMBER_LENGTH = 24;
+
+		/// Write the number to p without a terminating zero and return the
+		/// number of characters written. p must have room for
+		/// MAX_NUMBER_LENGTH characters.
+		///
+		/// format_float() writes the shortest decimal representation that reads
+		/// back as the same float. Like printf's %g it uses scientific notation
+		/// for very large and very small numbers.
+		uint32_t format_uint32(char *p, uint32_t i);
+		uint32_t format_int32(char *p, int32_t i);
+		uint32_t format_hex64(char *p, uint64_t i);
+		uint32_t format_float(char *p, float f);
+
+		/// Makes sure the buffer has room for n more characters and returns a
+		/// pointer to the end of the buffer.
+		inline char *reserve_tail(Buffer &b, uint32_t n)
+		{
+			if (b._size + n > b._capacity)
+				array::grow(b, b._size + n);
+			return b._data + b._size;
+		}
+
+		/// A part of a parsed format string: either length characters of the
+		/// format string at offset, or the argument with index arg.
+		struct FormatSegment
+		{
+			uint32_t offset;
+			uint32_t length;
+			uint32_t arg;
+		};
+
+		const uint32_t FORMAT_LITERAL = 0xffffffffu;
+
+		/// The result of parsing a format string. Only the first N segments are
+		/// stored, but all of them are counted, so a format string is parsed
+		/// once with N = 0 to find the number of segments and then again to
+		/// store them.
+		template <uint32_t N> struct FormatSegments
+		{
+			FormatSegment segments[N + 1];
+			uint32_t num_segments;
+			uint32_t num_args;
+			uint32_t literal_length;
+			bool valid;
+		};
+
+		template <uint32_t N> constexpr void add_segment(FormatSegments<N> &r, uint32_t offset, uint32_t length, uint32_t arg)
+		{
+			if (arg == FORMAT_LITERAL && length == 0)
+				return;
+			if (r.num_segments < N) {
+				r.segments[r.num_segments].offset = offset;
+				r.segments[r.num_segments].length = length;
+				r.segments[r.num_segments].arg = arg;
+			}
+			++r.num_segments;
+			if (arg == FORMAT_LITERAL)
+				r.literal_length += length;
+		}
+
+		template <uint32_t N> constexpr FormatSegments<N> parse_format(const char *s)
 		{
-			char s[32];
-			snprintf(s, 32, fmt, t);
-			return (b << s);
+			FormatSegments<N> r = {};
+			r.valid = true;
+			uint32_t start = 0, i = 0;
+			while (s[i]) {
+				if ((s[i] == '{' && s[i+1] == '{') || (s[i] == '}' && s[i+1] == '}')) {
+					add_segment(r, start, i + 1 - start, FORMAT_LITERAL);
+					i += 2;
+					start = i;
+				} else if (s[i] == '{' && s[i+1] == '}') {
+					add_segment(r, start, i - start, FORMAT_LITERAL);
+					add_segment(r, 0, 0, r.num_args++);
+					i += 2;
+					start = i;
+				} else {
+					if (s[i] == '{' || s[i] == '}')
+						r.valid = false;
+					++i;
+				}
+			}
+			add_segment(r, start, i - start, FORMAT_LITERAL);
+			return r;
 		}
+
+		/// A type erased format argument.
+		struct FormatArg
+		{
+			enum Type {CHAR, STRING, FLOAT, INT32, UINT32, UINT64};
+			Type type;
+			uint32_t length;
+			union {
+				char c;
+				const char *s;
+				float f;
+				int32_t i;
+				uint32_t u;
+				uint64_t x;
+			};
+		};
+
+		inline FormatArg format_arg(char c) {FormatArg a; a.type = FormatArg::CHAR; a.length = 1; a.c = c; return a;}
+		inline FormatArg format_arg(const char *s) {FormatArg a; a.type = FormatArg::STRING; a.length = (uint32_t)strlen(s); a.s = s; return a;}
+		inline FormatArg format_arg(float f) {FormatArg a; a.type = FormatArg::FLOAT; a.length = MAX_NUMBER_LENGTH; a.f = f; return a;}
+		inline FormatArg format_arg(int32_t i) {FormatArg a; a.type = FormatArg::INT32; a.length = MAX_NUMBER_LENGTH; a.i = i; return a;}
+		inline FormatArg format_arg(uint32_t u) {FormatArg a; a.type = FormatArg::UINT32; a.length = MAX_NUMBER_LENGTH; a.u = u; return a;}
+		inline FormatArg format_arg(uint64_t x) {FormatArg a; a.type = FormatArg::UINT64; a.length = MAX_NUMBER_LENGTH; a.x = x; return a;}
+
+		/// Parses the format string of F at compile time and checks it against
+		/// the number of arguments.
+		template <typename F, uint32_t NUM_ARGS> const auto &parsed_format()
+		{
+			static constexpr FormatSegments<0> counts = parse_format<0>(F::string());
+			static_assert(counts.valid, "unmatched { or } in format string, use {{ and }} for literal braces");
+			static_assert(counts.num_args == NUM_ARGS, "the number of arguments doesn't match the number of {} in the format string");
+			static constexpr FormatSegments<counts.num_segments> parsed = parse_format<counts.num_segments>(F::string());
+			return parsed;
+		}
+
+		/// Returns the maximum number of characters that write_format() can
+		/// write for the arguments.
+		uint32_t format_length(uint32_t literal_length, const FormatArg *args, uint32_t num_args);
+
+		/// Writes the segments of the format string s with the arguments to p
+		/// and returns the number of characters written.
+		uint32_t write_format(char *p, const char *s, const FormatSegment *segments, uint32_t num_segments, const FormatArg *args);
 	}
 
+	/// Wraps a string literal in a type whose string() function can be called
+	/// at compile time, for string_stream::format().
+	#define FORMAT_STRING(s) [] { \
+			struct FormatString { static constexpr const char *string() {return s;} }; \
+			return FormatString(); \
+		}()
+
 	namespace string_stream
 	{
 		inline Buffer & operator<<(Buffer &b, char c)
@@ -72,22 +215,40 @@ namespace foundation
 
 		inline Buffer & operator<<(Buffer &b, float f)
 		{
-			return string_stream_internal::printf_small(b, "%g", f);
+			using namespace string_stream_internal;
+			b._size += format_float(reserve_tail(b, MAX_NUMBER_LENGTH), f);
+			return b;
 		}
 
 		inline Buffer & operator<<(Buffer &b, int32_t i)
 		{
-			return string_stream_internal::printf_small(b, "%d", i);
+			using namespace string_stream_internal;
+			b._size += format_int32(reserve_tail(b, MAX_NUMBER_LENGTH), i);
+			return b;
 		}
 
 		inline Buffer & operator<<(Buffer &b, uint32_t i)
 		{
-			return string_stream_internal::printf_small(b, "%u", i);
+			using namespace string_stream_internal;
+			b._size += format_uint32(reserve_tail(b, MAX_NUMBER_LENGTH), i);
+			return b;
 		}
 
 		inline Buffer & operator<<(Buffer &b, uint64_t i)
 		{
-			return string_stream_internal::printf_small(b, "%01llx", i);
+			using namespace string_stream_internal;
+			b._size += format_hex64(reserve_tail(b, MAX_NUMBER_LENGTH), i);
+			return b;
+		}
+
+		template <typename F, typename... Args> Buffer & format(Buffer &b, F, const Args &... args)
+		{
+			using namespace string_stream_internal;
+			const auto &parsed = parsed_format<F, sizeof...(Args)>();
+			const FormatArg format_args[] = {format_arg(args)..., format_arg('\0')};
+			char *p = reserve_tail(b, format_length(parsed.literal_length, format_args, sizeof...(Args)));
+			b._size += write_format(p, F::string(), parsed.segments, parsed.num_segments, format_args);
+			return b;
 		}
 
 		inline Buffer & push(Buffer &b, const char *data, uint32_t n)
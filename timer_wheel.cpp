@@ -0,0 +1,188 @@
+#include "timer_wheel.h"
+#include "array.h"
+
+namespace {
+	using namespace foundation;
+
+	const uint32_t LEVEL_BITS = 6;
+	const uint32_t SLOTS = 1 << LEVEL_BITS;
+	const uint32_t SLOT_MASK = SLOTS - 1;
+	const uint32_t LEVELS = 4;
+
+	// Timers further than this in the future are parked in the last slot of the
+	// top level and rescheduled when that slot is cascaded.
+	const uint64_t MAX_DELTA = (uint64_t(1) << (LEVEL_BITS * LEVELS)) - 1;
+
+	const uint32_t END_OF_LIST = 0xffffffffu;
+
+	inline uint32_t handle_index(timer_wheel::Handle h) {return uint32_t(h & 0xffffffffu);}
+	inline uint32_t handle_generation(timer_wheel::Handle h) {return uint32_t(h >> 32);}
+
+	// Returns the slot that a timer expiring at the specified tick should be
+	// stored in.
+	uint32_t slot_for(const TimerWheel &w, uint64_t expires)
+	{
+		uint64_t delta = expires - w._now;
+		if (delta > MAX_DELTA) {
+			delta = MAX_DELTA;
+			expires = w._now + delta;
+		}
+
+		uint32_t level = 0;
+		while (level + 1 < LEVELS && delta >= (uint64_t(1) << (LEVEL_BITS * (level + 1))))
+			++level;
+		return level * SLOTS + (uint32_t(expires >> (LEVEL_BITS * level)) & SLOT_MASK);
+	}
+
+	void link(TimerWheel &w, uint32_t i)
+	{
+		TimerWheel::Timer &t = w._timers[i];
+		t.slot = slot_for(w, t.expires);
+		t.prev = END_OF_LIST;
+		t.next = w._slots[t.slot];
+		if (t.next != END_OF_LIST)
+			w._timers[t.next].prev = i;
+		w._slots[t.slot] = i;
+		if (t.slot < SLOTS)
+			++w._level0;
+	}
+
+	void unlink(TimerWheel &w, uint32_t i)
+	{
+		TimerWheel::Timer &t = w._timers[i];
+		if (t.prev != END_OF_LIST)
+			w._timers[t.prev].next = t.next;
+		else
+			w._slots[t.slot] = t.next;
+		if (t.next != END_OF_LIST)
+			w._timers[t.next].prev = t.prev;
+		if (t.slot < SLOTS)
+			--w._level0;
+	}
+
+	void release(TimerWheel &w, uint32_t i)
+	{
+		TimerWheel::Timer &t = w._timers[i];
+		++t.generation;
+		if (t.generation == 0)
+			t.generation = 1;
+		t.slot = END_OF_LIST;
+		t.next = w._free;
+		w._free = i;
+		--w._size;
+	}
+
+	// Moves all the timers in the slot down to lower levels of the wheel.
+	void cascade(TimerWheel &w, uint32_t slot)
+	{
+		uint32_t i = w._slots[slot];
+		w._slots[slot] = END_OF_LIST;
+		while (i != END_OF_LIST) {
+			const uint32_t next = w._timers[i].next;
+			link(w, i);
+			i = next;
+		}
+	}
+
+	void tick(TimerWheel &w, Array<uint64_t> &expired)
+	{
+		++w._now;
+
+		// Cascade the higher levels every time the level below wraps around.
+		for (uint32_t level = 1; level < LEVELS; ++level) {
+			if (w._now & ((uint64_t(1) << (LEVEL_BITS * level)) - 1))
+				break;
+			cascade(w, level * SLOTS + (uint32_t(w._now >> (LEVEL_BITS * level)) & SLOT_MASK));
+		}
+
+		const uint32_t slot = uint32_t(w._now) & SLOT_MASK;
+		uint32_t i = w._slots[slot];
+		w._slots[slot] = END_OF_LIST;
+		while (i != END_OF_LIST) {
+			const uint32_t next = w._timers[i].next;
+			array::push_back(expired, w._timers[i].data);
+			--w._level0;
+			release(w, i);
+			i = next;
+		}
+	}
+}
+
+namespace foundation
+{
+	namespace timer_wheel
+	{
+		Handle schedule(TimerWheel &w, uint64_t expires, uint64_t data)
+		{
+			uint32_t i = w._free;
+			if (i != END_OF_LIST)
+				w._free = w._timers[i].next;
+			else {
+				TimerWheel::Timer t;
+				t.generation = 1;
+				i = array::size(w._timers);
+				array::push_back(w._timers, t);
+			}
+
+			TimerWheel::Timer &t = w._timers[i];
+			t.expires = expires > w._now ? expires : w._now + 1;
+			t.data = data;
+			link(w, i);
+			++w._size;
+			return (uint64_t(t.generation) << 32) | i;
+		}
+
+		bool cancel(TimerWheel &w, Handle h)
+		{
+			if (!pending(w, h))
+				return false;
+			const uint32_t i = handle_index(h);
+			unlink(w, i);
+			release(w, i);
+			return true;
+		}
+
+		bool pending(const TimerWheel &w, Handle h)
+		{
+			const uint32_t i = handle_index(h);
+			return i < array::size(w._timers) && w._timers[i].generation == handle_generation(h)
+				&& w._timers[i].slot != END_OF_LIST;
+		}
+
+		void advance(TimerWheel &w, uint64_t now, Array<uint64_t> &expired)
+		{
+			while (w._now < now) {
+				// Nothing can expire, skip ahead.
+				if (w._size == 0) {
+					w._now = now;
+					break;
+				}
+
+				// Nothing happens until the level 0 wheel wraps around, skip
+				// ahead to the tick before that.
+				if (w._level0 == 0) {
+					const uint64_t wrap = ((w._now >> LEVEL_BITS) + 1) << LEVEL_BITS;
+					w._now = (wrap < now ? wrap : now) - 1;
+				}
+				tick(w, expired);
+			}
+		}
+
+		uint64_t now(const TimerWheel &w)
+		{
+			return w._now;
+		}
+
+		uint32_t size(const TimerWheel &w)
+		{
+			return w._size;
+		}
+	}
+
+	TimerWheel::TimerWheel(Allocator &a) : _now(0), _size(0), _level0(0), _free(END_OF_LIST), _slots(a), _timers(a)
+	{
+		array::resize(_slots, SLOTS * LEVELS);
+		for (uint32_t i=0; i<SLOTS * LEVELS; ++i)
+			_slots[i] = END_OF_LIST;
+	}
+}
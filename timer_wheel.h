@@ -0,0 +1,43 @@
+#pragma once
+
+#include "collection_types.h"
+
+namespace foundation
+{
+	/// The timer wheel keeps timers in a hierarchy of LEVELS wheels with SLOTS
+	/// slots each. Level 0 has one slot per tick, each slot at level n covers
+	/// SLOTS^n ticks. When the lower wheel wraps around, the timers in the next
+	/// slot of the level above are cascaded down.
+	///
+	/// Timers are stored in a "list-in-an-array" where indices are used instead
+	/// of pointers, so scheduling and cancelling timers doesn't allocate memory
+	/// once the timer array has grown to fit the peak number of timers.
+	namespace timer_wheel
+	{
+		/// Identifies a scheduled timer. Handles are never 0 and a handle is not
+		/// reused when the timer expires or is cancelled.
+		typedef uint64_t Handle;
+
+		/// Schedules a timer that expires at the specified tick. data is returned
+		/// by advance() when the timer expires. If expires is in the past, the timer
+		/// expires on the next tick.
+		Handle schedule(TimerWheel &w, uint64_t expires, uint64_t data);
+
+		/// Cancels the timer. Returns false if the timer has already expired or
+		/// been cancelled.
+		bool cancel(TimerWheel &w, Handle h);
+
+		/// Returns true if the timer is still scheduled.
+		bool pending(const TimerWheel &w, Handle h);
+
+		/// Advances the wheel to the specified tick and pushes the data of all
+		/// timers that expired to the expired array (in expiry order).
+		void advance(TimerWheel &w, uint64_t now, Array<uint64_t> &expired);
+
+		/// Returns the current tick of the wheel.
+		uint64_t now(const TimerWheel &w);
+
+		/// Returns the number of scheduled timers.
+		uint32_t size(const TimerWheel &w);
+	}
+}
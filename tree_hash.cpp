@@ -0,0 +1,152 @@
+#include "tree_hash.h"
+#include "array.h"
+#include "fast_hash.h"
+#include "memory.h"
+
+#include <assert.h>
+#include <atomic>
+#include <new>
+#include <thread>
+
+namespace foundation
+{
+	namespace
+	{
+		/// Leaves are handed out to the threads in batches of this many, so
+		/// the threads don't contend on the counter for small leaves.
+		const uint32_t LEAVES_PER_TASK = 4;
+
+		struct LeafJob
+		{
+			const TreeHash *t;
+			const char *data;
+			uint32_t first;
+			uint32_t last;
+			uint64_t *out;
+			std::atomic<uint32_t> next;
+		};
+
+		inline uint64_t hash_leaf(const TreeHash &t, const char *data, uint32_t i)
+		{
+			return wide_hash_64(data + tree_hash::leaf_offset(t, i), tree_hash::leaf_length(t, i), t._seed);
+		}
+
+		void run_leaf_job(LeafJob *job)
+		{
+			while (true) {
+				const uint32_t begin = job->first + job->next.fetch_add(LEAVES_PER_TASK);
+				if (begin >= job->last)
+					return;
+				const uint32_t end = job->last - begin < LEAVES_PER_TASK ? job->last : begin + LEAVES_PER_TASK;
+				for (uint32_t i=begin; i<end; ++i)
+					job->out[i - job->first] = hash_leaf(*job->t, job->data, i);
+			}
+		}
+
+		/// Hashes the leaves [first, last) to out[0 .. last - first).
+		void hash_leaves(const TreeHash &t, const char *data, uint32_t first, uint32_t last, uint64_t *out, uint32_t num_threads)
+		{
+			if (num_threads == 0)
+				num_threads = std::thread::hardware_concurrency();
+			const uint32_t tasks = (last - first + LEAVES_PER_TASK - 1) / LEAVES_PER_TASK;
+			num_threads = num_threads < tasks ? num_threads : tasks;
+
+			LeafJob job;
+			job.t = &t;
+			job.data = data;
+			job.first = first;
+			job.last = last;
+			job.out = out;
+			job.next = 0;
+
+			if (num_threads <= 1) {
+				run_leaf_job(&job);
+				return;
+			}
+
+			std::thread *threads = (std::thread *)t._leaves._allocator->allocate(sizeof(std::thread) * (num_threads - 1), alignof(std::thread));
+			for (uint32_t i=0; i<num_threads - 1; ++i)
+				new (threads + i) std::thread(run_leaf_job, &job);
+			run_leaf_job(&job);
+			for (uint32_t i=0; i<num_threads - 1; ++i) {
+				threads[i].join();
+				threads[i].~thread();
+			}
+			t._leaves._allocator->deallocate(threads);
+		}
+
+		uint64_t hash_root(TreeHash &t)
+		{
+			t._root = wide_hash_64(array::begin(t._leaves), array::size(t._leaves) * sizeof(uint64_t), t._seed ^ t._length);
+			return t._root;
+		}
+
+		/// Returns the range of leaves [first, last) that overlap the bytes
+		/// [offset, offset + size).
+		void leaf_range(const TreeHash &t, uint64_t offset, uint64_t size, uint32_t &first, uint32_t &last)
+		{
+			const uint64_t end = offset + size < t._length ? offset + size : t._length;
+			if (size == 0 || offset >= end) {
+				first = last = 0;
+				return;
+			}
+			first = (uint32_t)(offset / t._leaf_size);
+			last = (uint32_t)((end + t._leaf_size - 1) / t._leaf_size);
+		}
+	}
+
+	namespace tree_hash
+	{
+		uint64_t build(TreeHash &t, const void *data, uint64_t len, uint32_t num_threads)
+		{
+			const uint64_t n = (len + t._leaf_size - 1) / t._leaf_size;
+			assert(n < 0xffffffffu);
+			t._length = len;
+			array::resize(t._leaves, (uint32_t)n);
+			hash_leaves(t, (const char *)data, 0, (uint32_t)n, array::begin(t._leaves), num_threads);
+			return hash_root(t);
+		}
+
+		uint64_t update(TreeHash &t, const void *data, uint64_t offset, uint64_t size, uint32_t num_threads)
+		{
+			uint32_t first, last;
+			leaf_range(t, offset, size, first, last);
+			hash_leaves(t, (const char *)data, first, last, array::begin(t._leaves) + first, num_threads);
+			return hash_root(t);
+		}
+
+		bool verify(const TreeHash &t, const void *data, uint64_t offset, uint64_t size, Array<uint32_t> *mismatched, uint32_t num_threads)
+		{
+			uint32_t first, last;
+			leaf_range(t, offset, size, first, last);
+
+			Array<uint64_t> hashes(*t._leaves._allocator);
+			array::resize(hashes, last - first);
+			hash_leaves(t, (const char *)data, first, last, array::begin(hashes), num_threads);
+
+			bool ok = true;
+			for (uint32_t i=first; i<last; ++i) {
+				if (hashes[i - first] != t._leaves[i]) {
+					ok = false;
+					if (mismatched)
+						array::push_back(*mismatched, i);
+				}
+			}
+			return ok;
+		}
+
+		uint64_t root(const TreeHash &t) {return t._root;}
+		uint32_t num_leaves(const TreeHash &t) {return array::size(t._leaves);}
+		uint64_t leaf_offset(const TreeHash &t, uint32_t i) {return (uint64_t)i * t._leaf_size;}
+
+		uint32_t leaf_length(const TreeHash &t, uint32_t i)
+		{
+			const uint64_t offset = leaf_offset(t, i);
+			return t._length - offset < t._leaf_size ? (uint32_t)(t._length - offset) : t._leaf_size;
+		}
+	}
+
+	TreeHash::TreeHash(Allocator &a, uint32_t leaf_size, uint64_t seed) :
+		_leaf_size(leaf_size), _seed(seed), _length(0), _root(wide_hash_64(0, 0, seed)), _leaves(a)
+	{}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "collection_types.h"
+
+namespace foundation
+{
+	/// Tree hashing splits a buffer into leaves of leaf_size bytes (the last
+	/// leaf can be shorter), hashes the leaves with wide_hash_64() on several
+	/// threads and then hashes the array of leaf hashes, in leaf order, to get
+	/// the root hash. The leaves are hashed independently, so the root hash
+	/// only depends on the data, the leaf size and the seed, never on the
+	/// number of threads.
+	///
+	/// The root hash is not the same value as wide_hash_64() or
+	/// murmur_hash_64() of the whole buffer.
+	namespace tree_hash
+	{
+		/// Hashes len bytes of data, stores the leaf hashes in t and returns the
+		/// root hash. The work is split over num_threads threads (including the
+		/// calling thread). If num_threads is 0, one thread per hardware thread
+		/// is used.
+		uint64_t build(TreeHash &t, const void *data, uint64_t len, uint32_t num_threads = 0);
+
+		/// Updates t after the bytes [offset, offset + size) of the buffer have
+		/// changed. Only the leaves that overlap the changed bytes are hashed
+		/// again. The length of the buffer must be the same as in build().
+		/// Returns the new root hash.
+		uint64_t update(TreeHash &t, const void *data, uint64_t offset, uint64_t size, uint32_t num_threads = 0);
+
+		/// Hashes the leaves that overlap the bytes [offset, offset + size) and
+		/// compares them with the leaf hashes in t. Returns true if they all
+		/// match. If mismatched is not 0, the indices of the leaves that don't
+		/// match are pushed to it. Use offset 0 and the length of the buffer to
+		/// verify the whole buffer.
+		bool verify(const TreeHash &t, const void *data, uint64_t offset, uint64_t size, Array<uint32_t> *mismatched = 0, uint32_t num_threads = 0);
+
+		/// Returns the root hash computed by the last build() or update().
+		uint64_t root(const TreeHash &t);
+
+		/// Returns the number of leaves and the byte range of leaf i.
+		uint32_t num_leaves(const TreeHash &t);
+		uint64_t leaf_offset(const TreeHash &t, uint32_t i);
+		uint32_t leaf_length(const TreeHash &t, uint32_t i);
+	}
+}
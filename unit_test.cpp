@@ -1,7 +1,27 @@
 #include "queue.h"
+#include "priority_queue.h"
+#include "timer_wheel.h"
 #include "string_stream.h"
+#include "rope_buffer.h"
+#include "log_sink.h"
+#include "string_reader.h"
+#include "sjson.h"
+#include "vector_math.h"
+#include "soa_array.h"
+#include "string_pool.h"
 #include "murmur_hash.h"
+#include "fast_hash.h"
+#include "tree_hash.h"
 #include "hash.h"
+#include "flat_hash.h"
+#include "split_hash.h"
+#include "concurrent_hash.h"
+#include "frozen_hash.h"
+#include "grouped_hash.h"
+#include "hash_set.h"
+#include "key_hash.h"
+#include "lru_cache.h"
+#include "clock_cache.h"
 #include "temp_allocator.h"
 #include "array.h"
 #include "memory.h"
@@ -9,8 +29,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <assert.h>
+#include <locale.h>
 #include <algorithm>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
 
 #define ASSERT(x) assert(x)
 
@@ -119,6 +144,7 @@ namespace {
 				ASSERT(hash::get(h,i,0) == i*i);
 			hash::remove(h, 1000);
 			ASSERT(!hash::has(h, 1000));
+			ASSERT(hash::end(h) - hash::begin(h) == 100);
 			hash::remove(h, 2000);
 			ASSERT(hash::get(h,1000,0) == 0);
 			for (int i=0; i<100; ++i)
@@ -130,6 +156,360 @@ namespace {
 		memory_globals::shutdown();
 	}
 
+	void test_hash_incremental_rehash() {
+		memory_globals::init();
+		{
+			Allocator &a = memory_globals::default_allocator();
+			Hash<int> h(a);
+			hash::set_incremental_rehash(h, 4);
+
+			static char removed[10000];
+			bool migrated = false;
+			for (int i=0; i<10000; ++i) {
+				hash::set(h, i * 977, i);
+				migrated = migrated || hash_internal::migrating(h);
+				if (i % 3 == 0) {
+					hash::remove(h, (i / 2) * 977);
+					removed[i / 2] = 1;
+				}
+				ASSERT(hash::get(h, i * 977, -1) == (removed[i] ? -1 : i));
+			}
+			ASSERT(migrated);
+			for (int i=0; i<10000; ++i)
+				ASSERT(hash::get(h, i * 977, -1) == (removed[i] ? -1 : i));
+
+			multi_hash::insert(h, 1, 1);
+			for (int i=0; i<1000; ++i)
+				multi_hash::insert(h, 1000000 + i, i);
+			multi_hash::insert(h, 1, 2);
+			multi_hash::insert(h, 1, 3);
+			ASSERT(multi_hash::count(h, 1) == 3);
+			multi_hash::remove_all(h, 1);
+			ASSERT(!hash::has(h, 1));
+
+			hash::set_incremental_rehash(h, 0);
+			ASSERT(!hash_internal::migrating(h));
+			for (int i=0; i<1000; ++i)
+				ASSERT(hash::get(h, 1000000 + i, -1) == i);
+		}
+		memory_globals::shutdown();
+	}
+
+	struct IsMultipleOf {
+		uint64_t n;
+		bool operator()(uint64_t key, int) const {return key % n == 0;}
+	};
+
+	void test_hash_remove_if()
+	{
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			Hash<int> h(ta);
+			hash::set_incremental_rehash(h, 4);
+			for (int i=0; i<10000; ++i)
+				hash::set(h, i, i);
+			multi_hash::insert(h, 5, 50);
+			multi_hash::insert(h, 6, 60);
+
+			IsMultipleOf three = {3};
+			ASSERT(hash::remove_if(h, three) == 3334 + 1);
+			ASSERT(hash::end(h) - hash::begin(h) == 10002 - 3335);
+			for (int i=0; i<10000; ++i)
+				ASSERT(hash::get(h, i, -1) == (i % 3 ? i : -1));
+			ASSERT(multi_hash::count(h, 5) == 2);
+			ASSERT(multi_hash::find_first(h, 5)->value == 5);
+			ASSERT(hash::remove_if(h, three) == 0);
+
+			IsMultipleOf two = {2};
+			ASSERT(hash::retain(h, two) == 3333 + 1);
+			for (int i=0; i<10000; ++i)
+				ASSERT(hash::has(h, i) == (i % 6 != 0 && i % 2 == 0));
+
+			const uint32_t n = hash::end(h) - hash::begin(h);
+			hash::shrink_to_fit(h);
+			ASSERT(array::size(h._hash) < 2 * n);
+			ASSERT(h._data._capacity == n);
+			for (int i=0; i<10000; ++i)
+				ASSERT(hash::has(h, i) == (i % 6 != 0 && i % 2 == 0));
+			for (int i=0; i<100; ++i)
+				hash::set(h, 20000 + i, i);
+			ASSERT(hash::get(h, 20099, -1) == 99);
+			ASSERT(hash::get(h, 4, -1) == 4);
+
+			hash::clear(h);
+			hash::shrink_to_fit(h);
+			ASSERT(h._data._capacity == 0 && h._hash._capacity == 0);
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_hash_batch() {
+		memory_globals::init();
+		{
+			Allocator &a = memory_globals::default_allocator();
+			Hash<int> h(a);
+
+			uint64_t keys[1000];
+			int values[1000];
+			for (int i=0; i<1000; ++i) {
+				keys[i] = i * 7;
+				values[i] = i;
+			}
+			hash::set_many(h, keys, values, 500);
+			hash::set_many(h, keys + 250, values + 250, 750);
+
+			bool has[1000];
+			int got[1000];
+			hash::has_many(h, keys, 1000, has);
+			hash::get_many(h, keys, 1000, got, -1);
+			for (int i=0; i<1000; ++i) {
+				ASSERT(has[i]);
+				ASSERT(got[i] == i);
+				ASSERT(hash::get(h, keys[i], -1) == i);
+			}
+			ASSERT(hash::end(h) - hash::begin(h) == 1000);
+
+			for (int i=0; i<1000; ++i)
+				keys[i] = i * 7 + 1;
+			hash::has_many(h, keys, 1000, has);
+			hash::get_many(h, keys, 1000, got, -1);
+			for (int i=0; i<1000; ++i)
+				ASSERT(!has[i] && got[i] == -1);
+
+			// set_many() grows incrementally like set(), and the batched
+			// lookups find keys in both bucket arrays during the migration.
+			Hash<int> m(a);
+			hash::set_incremental_rehash(m, 1);
+			static uint64_t m_keys[4000];
+			static int m_values[4000];
+			for (int i=0; i<4000; ++i) {
+				m_keys[i] = i * 13;
+				m_values[i] = i;
+			}
+			hash::set_many(m, m_keys, m_values, 1000);
+			ASSERT(!hash_internal::migrating(m));
+			const uint32_t more = array::size(m._hash) - 1000;
+			hash::set_many(m, m_keys + 1000, m_values + 1000, more);
+			ASSERT(hash_internal::migrating(m));
+
+			static bool m_has[4000];
+			static int m_got[4000];
+			hash::has_many(m, m_keys, 4000, m_has);
+			hash::get_many(m, m_keys, 4000, m_got, -1);
+			for (uint32_t i=0; i<4000; ++i) {
+				ASSERT(m_has[i] == (i < 1000 + more));
+				ASSERT(m_got[i] == (i < 1000 + more ? (int)i : -1));
+			}
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_split_hash() {
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			SplitHash<int> h(ta);
+			ASSERT(hash::get(h,0,99) == 99);
+			ASSERT(!hash::has(h, 0));
+			hash::remove(h, 0);
+			hash::set(h, 1000, 123);
+			ASSERT(hash::get(h,1000,0) == 123);
+			ASSERT(hash::get(h,2000,99) == 99);
+
+			for (int i=0; i<100; ++i)
+				hash::set(h, i, i*i);
+			for (int i=0; i<100; ++i)
+				ASSERT(hash::get(h,i,0) == i*i);
+			hash::remove(h, 1000);
+			ASSERT(!hash::has(h, 1000));
+			ASSERT(split_hash::size(h) == 100);
+			for (int i=0; i<100; i += 2)
+				hash::remove(h, i);
+			ASSERT(split_hash::size(h) == 50);
+			for (int i=0; i<100; ++i)
+				ASSERT(hash::get(h,i,-1) == (i % 2 ? i*i : -1));
+			for (uint32_t i=0; i<split_hash::size(h); ++i)
+				ASSERT(split_hash::values(h)[i] == int(split_hash::keys(h)[i] * split_hash::keys(h)[i]));
+
+			// reserve() only grows the table.
+			hash::reserve(h, 0);
+			hash::reserve(h, 1000);
+			hash::set(h, 1000, 1);
+			for (int i=0; i<100; ++i)
+				ASSERT(hash::get(h,i,-1) == (i % 2 ? i*i : -1));
+			hash::clear(h);
+			for (int i=0; i<100; ++i)
+				ASSERT(!hash::has(h,i));
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_concurrent_hash() {
+		memory_globals::init();
+		{
+			Allocator &a = memory_globals::default_allocator();
+			ConcurrentHash<uint64_t> h(a, 8);
+			ASSERT(hash::get(h, 0, uint64_t(99)) == 99);
+			ASSERT(!hash::has(h, 0));
+			hash::remove(h, 0);
+			hash::set(h, 1000, uint64_t(123));
+			ASSERT(hash::get(h, 1000, uint64_t(0)) == 123);
+			hash::remove(h, 1000);
+			ASSERT(!hash::has(h, 1000));
+
+			// Writers insert and remove disjoint key ranges while readers check
+			// that they never see a torn value.
+			std::thread threads[4];
+			for (uint32_t t=0; t<4; ++t) {
+				threads[t] = std::thread([&h, t]() {
+					for (uint64_t i=0; i<20000; ++i) {
+						const uint64_t key = (i % 5000) * 4 + t;
+						if (t < 2) {
+							if (i % 3 == 2)
+								hash::remove(h, key);
+							else
+								hash::set(h, key, key * 3);
+						} else {
+							const uint64_t v = hash::get(h, key - 2, uint64_t(0));
+							ASSERT(v == 0 || v == (key - 2) * 3);
+						}
+					}
+				});
+			}
+			for (uint32_t t=0; t<4; ++t)
+				threads[t].join();
+
+			concurrent_hash::collect(h);
+			for (uint64_t i=0; i<5000; ++i) {
+				const uint64_t key = i * 4;
+				ASSERT(hash::get(h, key, uint64_t(0)) == 0 || hash::get(h, key, uint64_t(0)) == key * 3);
+			}
+			uint32_t n = 0;
+			for (uint64_t key=0; key<20000; ++key)
+				n += hash::has(h, key);
+			ASSERT(n == concurrent_hash::size(h));
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_frozen_hash() {
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			FrozenHash<int> empty(ta);
+			ASSERT(!hash::has(empty, 0));
+			ASSERT(hash::get(empty, 0, 99) == 99);
+			ASSERT(frozen_hash::build(empty, (const uint64_t *)0, (const int *)0, 0));
+			ASSERT(frozen_hash::size(empty) == 0);
+			ASSERT(!hash::has(empty, 0));
+
+			Hash<int> h(ta);
+			for (int i=0; i<10000; ++i)
+				hash::set(h, uint64_t(i) * 0x100000001ull, i);
+			FrozenHash<int> fh(ta);
+			ASSERT(frozen_hash::build(fh, h));
+			ASSERT(frozen_hash::size(fh) == 10000);
+			for (int i=0; i<10000; ++i) {
+				ASSERT(hash::get(fh, uint64_t(i) * 0x100000001ull, -1) == i);
+				ASSERT(!hash::has(fh, uint64_t(i) * 0x100000001ull + 1));
+			}
+
+			// The data block can be copied to a new address and attached.
+			const uint32_t size = frozen_hash::data_size(fh);
+			uint64_t *copy = (uint64_t *)ta.allocate(size, 8);
+			memcpy(copy, frozen_hash::data(fh), size);
+			FrozenHash<int> attached(ta);
+			ASSERT(frozen_hash::attach(attached, copy, size));
+			for (int i=0; i<10000; ++i)
+				ASSERT(hash::get(attached, uint64_t(i) * 0x100000001ull, -1) == i);
+			ASSERT(!frozen_hash::attach(attached, copy, size - 8));
+			FrozenHash<char> wrong_type(ta);
+			ASSERT(!frozen_hash::attach(wrong_type, copy, size));
+
+			// Corrupt headers and displacements are rejected.
+			{
+				using namespace frozen_hash_internal;
+				Header &header = *(Header *)copy;
+				const Header saved = header;
+				header.num_keys += 1;
+				ASSERT(!frozen_hash::attach(attached, copy, size));
+				header = saved;
+				header.num_buckets = header.entries_offset;
+				ASSERT(!frozen_hash::attach(attached, copy, size));
+				header = saved;
+				header.entries_offset = sizeof(Header);
+				ASSERT(!frozen_hash::attach(attached, copy, size));
+				header = saved;
+				header.total_size = size - 8;
+				ASSERT(!frozen_hash::attach(attached, copy, size));
+				header = saved;
+				uint32_t *d = (uint32_t *)((char *)copy + sizeof(Header));
+				uint32_t b = 0;
+				while (!(d[b] & DIRECT_SLOT))
+					++b;
+				const uint32_t saved_d = d[b];
+				d[b] = DIRECT_SLOT | header.num_keys;
+				ASSERT(!frozen_hash::attach(attached, copy, size));
+				d[b] = saved_d;
+				ASSERT(frozen_hash::attach(attached, copy, size));
+			}
+			ta.deallocate(copy);
+
+			// Duplicate keys can't be built.
+			multi_hash::insert(h, 5 * 0x100000001ull, 5);
+			ASSERT(!frozen_hash::build(fh, h));
+			ASSERT(hash::get(fh, 7 * 0x100000001ull, -1) == 7);
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_flat_hash() {
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			FlatHash<int> h(ta);
+			ASSERT(hash::get(h,0,99) == 99);
+			ASSERT(!hash::has(h, 0));
+			hash::remove(h, 0);
+			hash::set(h, 1000, 123);
+			ASSERT(hash::get(h,1000,0) == 123);
+			ASSERT(hash::get(h,2000,99) == 99);
+
+			for (int i=0; i<100; ++i)
+				hash::set(h, i, i*i);
+			for (int i=0; i<100; ++i)
+				ASSERT(hash::get(h,i,0) == i*i);
+			hash::remove(h, 1000);
+			ASSERT(!hash::has(h, 1000));
+			hash::remove(h, 2000);
+			ASSERT(hash::get(h,1000,0) == 0);
+			for (int i=0; i<100; ++i)
+				ASSERT(hash::get(h,i,0) == i*i);
+			hash::clear(h);
+			for (int i=0; i<100; ++i)
+				ASSERT(!hash::has(h,i));
+
+			// Churn with a reference hash, so tombstones are created and reclaimed.
+			Hash<int> ref(ta);
+			uint64_t x = 1;
+			for (int i=0; i<20000; ++i) {
+				x = x * 6364136223846793005ull + 1442695040888963407ull;
+				const uint64_t key = (x >> 33) % 500;
+				if (x & 1) {
+					hash::set(h, key << 40, i);
+					hash::set(ref, key << 40, i);
+				} else {
+					hash::remove(h, key << 40);
+					hash::remove(ref, key << 40);
+				}
+			}
+			for (uint64_t key=0; key<500; ++key)
+				ASSERT(hash::get(h, key << 40, -1) == hash::get(ref, key << 40, -1));
+		}
+		memory_globals::shutdown();
+	}
+
 	void test_multi_hash()
 	{
 		memory_globals::init();
@@ -157,6 +537,334 @@ namespace {
 		memory_globals::shutdown();
 	}
 
+	void test_hash_set()
+	{
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			HashSet s(ta);
+			ASSERT(!hash::has(s, 0));
+			hash::remove(s, 0);
+			ASSERT(hash_set::insert(s, 10));
+			ASSERT(!hash_set::insert(s, 10));
+			ASSERT(hash::has(s, 10));
+			ASSERT(hash_set::size(s) == 1);
+			hash::remove(s, 10);
+			ASSERT(!hash::has(s, 10));
+
+			for (uint64_t i=0; i<1000; ++i)
+				hash_set::insert(s, i * 7);
+			ASSERT(hash_set::size(s) == 1000);
+			for (uint64_t i=0; i<1000; i += 2)
+				hash::remove(s, i * 7);
+			ASSERT(hash_set::size(s) == 500);
+			for (uint64_t i=0; i<1000; ++i)
+				ASSERT(hash::has(s, i * 7) == (i % 2 == 1));
+
+			uint64_t sum = 0;
+			for (uint32_t i=0; i<hash_set::size(s); ++i)
+				sum += hash_set::keys(s)[i];
+			ASSERT(sum == 7 * 250000);
+
+			// reserve() only grows the table.
+			hash::reserve(s, 0);
+			hash::reserve(s, 5000);
+			hash_set::insert(s, 1);
+			for (uint64_t i=0; i<1000; ++i)
+				ASSERT(hash::has(s, i * 7) == (i % 2 == 1));
+			hash::clear(s);
+			ASSERT(hash_set::size(s) == 0 && !hash::has(s, 7));
+		}
+		memory_globals::shutdown();
+	}
+
+	struct Point {
+		int32_t x, y;
+	};
+
+	// A poor hash function, to make sure colliding keys are told apart.
+	struct PointHash {
+		uint64_t operator()(const Point &p) const {return uint64_t(p.x + p.y);}
+	};
+
+	void test_key_hash()
+	{
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			KeyHash<Point, int> h(ta);
+			Point p = {1, 2};
+			ASSERT(!hash::has(h, p));
+			ASSERT(hash::get(h, p, -1) == -1);
+			hash::set(h, p, 12);
+			ASSERT(hash::get(h, p, -1) == 12);
+
+			KeyHash<Point, int, PointHash> collide(ta);
+			for (int x=0; x<100; ++x) {
+				Point q = {x, 100 - x};
+				hash::set(collide, q, x);
+			}
+			for (int x=0; x<100; ++x) {
+				Point q = {x, 100 - x};
+				ASSERT(hash::get(collide, q, -1) == x);
+				Point r = {x, 99 - x};
+				ASSERT(!hash::has(collide, r));
+			}
+			for (int x=0; x<100; x += 2) {
+				Point q = {x, 100 - x};
+				hash::remove(collide, q);
+			}
+			ASSERT(hash::end(collide) - hash::begin(collide) == 50);
+
+			// reserve() only grows the table.
+			hash::reserve(collide, 0);
+			hash::reserve(collide, 500);
+			for (int x=0; x<100; ++x) {
+				Point q = {x, 100 - x};
+				ASSERT(hash::get(collide, q, -1) == (x % 2 ? x : -1));
+			}
+
+			KeyHash<const char *, int, CStringKeyHash, CStringEqual> names(ta);
+			char buffer[] = "two";
+			hash::set(names, "one", 1);
+			hash::set(names, "two", 2);
+			ASSERT(hash::get(names, (const char *)buffer, 0) == 2);
+			ASSERT(!hash::has(names, "three"));
+			hash::clear(names);
+			ASSERT(!hash::has(names, "one"));
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_grouped_hash()
+	{
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			GroupedHash<int> h(ta);
+			uint32_t n;
+			ASSERT(grouped_hash::get(h, 0, &n) == 0 && n == 0);
+			ASSERT(!hash::has(h, 0));
+
+			// Interleaved inserts, so spans have to be moved when they grow.
+			for (int i=0; i<1000; ++i)
+				for (int key=0; key<10; ++key)
+					grouped_hash::insert(h, key, key * 10000 + i);
+			int bulk[500];
+			for (int i=0; i<500; ++i)
+				bulk[i] = 3 * 10000 + 1000 + i;
+			grouped_hash::insert(h, 3, bulk, 500);
+			ASSERT(grouped_hash::size(h) == 10500);
+			ASSERT(grouped_hash::num_keys(h) == 10);
+			ASSERT(grouped_hash::count(h, 3) == 1500);
+
+			for (int key=0; key<10; ++key) {
+				const int *v = grouped_hash::get(h, key, &n);
+				ASSERT(n == (key == 3 ? 1500u : 1000u));
+				for (uint32_t i=0; i<n; ++i)
+					ASSERT(v[i] == key * 10000 + int(i));
+			}
+
+			// Removing keys creates garbage that is eventually compacted.
+			for (int key=0; key<10; key += 2)
+				grouped_hash::remove_all(h, key);
+			ASSERT(!hash::has(h, 4));
+			ASSERT(grouped_hash::count(h, 4) == 0);
+			ASSERT(grouped_hash::size(h) == 5500);
+			ASSERT(array::size(h._values) <= 2 * 5500 + 2048);
+			for (int key=1; key<10; key += 2) {
+				const int *v = grouped_hash::get(h, key, &n);
+				ASSERT(n == (key == 3 ? 1500u : 1000u));
+				for (uint32_t i=0; i<n; ++i)
+					ASSERT(v[i] == key * 10000 + int(i));
+			}
+
+			grouped_hash::remove(h, 1, 0);
+			ASSERT(grouped_hash::count(h, 1) == 999);
+			ASSERT(grouped_hash::get(h, 1, &n)[0] == 10999);
+			grouped_hash::insert(h, 100, 1);
+			grouped_hash::remove(h, 100, 0);
+			ASSERT(!hash::has(h, 100));
+
+			grouped_hash::compact(h);
+			ASSERT(array::size(h._values) == grouped_hash::size(h));
+			ASSERT(grouped_hash::get(h, 9, &n)[999] == 90999);
+			hash::clear(h);
+			ASSERT(grouped_hash::size(h) == 0 && !hash::has(h, 9));
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_lru_cache()
+	{
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			LruCache<int> c(ta, 3, 1000);
+			ASSERT(cache::get(c, 1) == 0);
+			cache::put(c, 1, 10);
+			cache::put(c, 2, 20);
+			cache::put(c, 3, 30);
+			ASSERT(*cache::get(c, 1) == 10);
+			Array<int> evicted(ta);
+			cache::put(c, 4, 40, sizeof(int), &evicted);
+			ASSERT(array::size(evicted) == 1 && evicted[0] == 20);
+			ASSERT(!cache::has(c, 2));
+			ASSERT(cache::size(c) == 3);
+			ASSERT(cache::hits(c) == 1 && cache::misses(c) == 1 && cache::evictions(c) == 1);
+
+			cache::put(c, 3, 33);
+			ASSERT(*cache::get(c, 3) == 33);
+			ASSERT(cache::remove(c, 1));
+			ASSERT(!cache::remove(c, 1));
+			ASSERT(cache::size(c) == 2);
+
+			// The byte budget evicts before the capacity is reached.
+			LruCache<int> b(ta, 100, 100);
+			cache::put(b, 1, 1, 60);
+			cache::put(b, 2, 2, 30);
+			cache::get(b, 1);
+			cache::put(b, 3, 3, 20);
+			ASSERT(cache::has(b, 1) && !cache::has(b, 2) && cache::has(b, 3));
+			ASSERT(cache::bytes(b) == 80);
+			cache::put(b, 4, 4, 200);
+			ASSERT(!cache::has(b, 4) && cache::bytes(b) == 80);
+			cache::clear(b);
+			ASSERT(cache::size(b) == 0 && cache::bytes(b) == 0);
+
+			// Replaced and oversized values are handed back as well.
+			array::clear(evicted);
+			cache::put(b, 1, 1, 10);
+			cache::put(b, 1, 11, 10, &evicted);
+			ASSERT(array::size(evicted) == 1 && evicted[0] == 1);
+			ASSERT(*cache::get(b, 1) == 11 && cache::size(b) == 1);
+			cache::put(b, 2, 2, 200, &evicted);
+			ASSERT(array::size(evicted) == 2 && evicted[1] == 2 && !cache::has(b, 2));
+
+			for (int i=0; i<1000; ++i) {
+				cache::put(c, i, i);
+				ASSERT(*cache::get(c, i) == i);
+			}
+			ASSERT(cache::size(c) == 3 && cache::has(c, 997) && cache::has(c, 999));
+
+			// Charging allocated_size() makes the budget track the memory of
+			// the cached objects.
+			Allocator &da = memory_globals::default_allocator();
+			const uint32_t before = da.total_allocated();
+			LruCache<void *> objects(ta, 100, 1000);
+			Array<void *> evicted_objects(ta);
+			for (uint32_t i=0; i<100; ++i) {
+				void *p = da.allocate(40 + i);
+				cache::put(objects, i, p, da.allocated_size(p), &evicted_objects);
+				for (uint32_t j=0; j<array::size(evicted_objects); ++j)
+					da.deallocate(evicted_objects[j]);
+				array::clear(evicted_objects);
+				ASSERT(cache::bytes(objects) <= 1000);
+				ASSERT(da.total_allocated() - before == cache::bytes(objects));
+			}
+			for (uint32_t i = objects._head; i != lru_cache_internal::END_OF_LIST; i = objects._entries[i].next)
+				da.deallocate(objects._entries[i].value);
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_clock_cache()
+	{
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			ClockCache<int> c(ta, 3, 1000);
+			ASSERT(cache::get(c, 1) == 0);
+			cache::put(c, 1, 10);
+			cache::put(c, 2, 20);
+			cache::put(c, 3, 30);
+			ASSERT(*cache::get(c, 1) == 10);
+			Array<int> evicted(ta);
+			cache::put(c, 4, 40, sizeof(int), &evicted);
+			ASSERT(array::size(evicted) == 1 && evicted[0] == 20);
+			ASSERT(cache::has(c, 1) && !cache::has(c, 2));
+			ASSERT(cache::size(c) == 3);
+			ASSERT(cache::hits(c) == 1 && cache::misses(c) == 1 && cache::evictions(c) == 1);
+
+			ASSERT(cache::remove(c, 1));
+			ASSERT(!cache::remove(c, 1));
+			ASSERT(cache::size(c) == 2);
+
+			ClockCache<int> b(ta, 100, 100);
+			cache::put(b, 1, 1, 60);
+			cache::put(b, 2, 2, 30);
+			cache::put(b, 3, 3, 20);
+			ASSERT(cache::bytes(b) <= 100 && cache::has(b, 3));
+			cache::clear(b);
+			ASSERT(cache::size(b) == 0 && cache::bytes(b) == 0);
+
+			// Replaced and oversized values are handed back as well.
+			array::clear(evicted);
+			cache::put(b, 1, 1, 10);
+			cache::put(b, 1, 11, 10, &evicted);
+			ASSERT(array::size(evicted) == 1 && evicted[0] == 1);
+			ASSERT(*cache::get(b, 1) == 11 && cache::size(b) == 1);
+			cache::put(b, 2, 2, 200, &evicted);
+			ASSERT(array::size(evicted) == 2 && evicted[1] == 2 && !cache::has(b, 2));
+
+			for (int i=0; i<1000; ++i) {
+				cache::put(c, i, i);
+				ASSERT(*cache::get(c, i) == i);
+			}
+			ASSERT(cache::size(c) == 3 && cache::has(c, 999));
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_string_pool()
+	{
+		memory_globals::init();
+		{
+			TempAllocator128 ta;
+			StringPool p(ta, 256);
+			uint64_t id;
+			ASSERT(!string_pool::lookup(p, "hello", &id));
+			ASSERT(string_pool::to_string(p, 1) == 0);
+
+			const uint64_t hello = string_pool::intern(p, "hello");
+			ASSERT(hello == murmur_hash_64("hello", 5, 0));
+			ASSERT(string_pool::intern(p, "hello") == hello);
+			ASSERT(string_pool::lookup(p, "hello", &id) && id == hello);
+			uint32_t len;
+			ASSERT(strcmp(string_pool::to_string(p, hello, &len), "hello") == 0 && len == 5);
+
+			// Strings with embedded zeros and strings larger than a chunk.
+			const uint64_t binary = string_pool::intern(p, "a\0b", 3);
+			ASSERT(memcmp(string_pool::to_string(p, binary), "a\0b", 4) == 0);
+			char big[1000];
+			memset(big, 'x', sizeof(big) - 1);
+			big[sizeof(big) - 1] = 0;
+			const uint64_t big_id = string_pool::intern(p, big);
+			ASSERT(strcmp(string_pool::to_string(p, big_id), big) == 0);
+
+			char name[32];
+			for (int i=0; i<1000; ++i) {
+				snprintf(name, sizeof(name), "name_%d", i);
+				string_pool::intern(p, name);
+			}
+			ASSERT(string_pool::size(p) == 1003);
+			for (int i=0; i<1000; ++i) {
+				snprintf(name, sizeof(name), "name_%d", i);
+				ASSERT(strcmp(string_pool::to_string(p, murmur_hash_64(name, strlen(name), 0)), name) == 0);
+			}
+			ASSERT(strcmp(string_pool::to_string(p, hello), "hello") == 0);
+
+			// Fake a collision by mapping the ID of "world" to "hello".
+			ASSERT(string_pool::collisions(p) == 0);
+			hash::set(p._ids, murmur_hash_64("world", 5, 0), 0u);
+			bool collision = false;
+			string_pool::intern(p, "world", &collision);
+			ASSERT(collision && string_pool::collisions(p) == 1);
+			ASSERT(!string_pool::lookup(p, "world", &id));
+		}
+		memory_globals::shutdown();
+	}
+
 	void test_murmur_hash()
 	{
 		const char *s = "test_string";
@@ -164,6 +872,231 @@ namespace {
 		ASSERT(h == 0xe604acc23b568f83ull);
 	}
 
+	void test_murmur_hash_stream()
+	{
+		char data[300];
+		for (uint32_t i=0; i<sizeof(data); ++i)
+			data[i] = char(i * 131 + 7);
+
+		const uint32_t chunk_sizes[] = {1, 2, 3, 7, 8, 9, 16, 100};
+		for (uint32_t len=0; len<sizeof(data); len += 7) {
+			for (uint32_t c=0; c<sizeof(chunk_sizes)/sizeof(chunk_sizes[0]); ++c) {
+				MurmurHash64State s;
+				murmur_hash::init(s, 99, len);
+				for (uint32_t i=0; i<len; i += chunk_sizes[c])
+					murmur_hash::update(s, data + i, len - i < chunk_sizes[c] ? len - i : chunk_sizes[c]);
+				ASSERT(murmur_hash::finish(s) == murmur_hash_64(data, len, 99));
+			}
+		}
+
+		// Chunks of varying size, including empty chunks.
+		MurmurHash64State s;
+		murmur_hash::init(s, 0, 11);
+		murmur_hash::update(s, "test", 4);
+		murmur_hash::update(s, "", 0);
+		murmur_hash::update(s, "_string", 7);
+		ASSERT(murmur_hash::finish(s) == 0xe604acc23b568f83ull);
+	}
+
+	struct MurmurTestCase {
+		const char *s;
+		uint32_t len;
+		uint64_t seed;
+		uint64_t hash;
+	};
+
+	#define MURMUR_TEST_CASE(s, seed) {s, sizeof(s) - 1, seed, murmur_hash_64_constexpr(s, sizeof(s) - 1, seed)}
+
+	void test_murmur_hash_constexpr()
+	{
+		// The hashes in the table are computed at compile time. Covers all
+		// tail lengths, multiple words, bytes with the high bit set and seeds.
+		constexpr MurmurTestCase cases[] = {
+			MURMUR_TEST_CASE("", 0),
+			MURMUR_TEST_CASE("", 1234),
+			MURMUR_TEST_CASE("a", 0),
+			MURMUR_TEST_CASE("ab", 0),
+			MURMUR_TEST_CASE("abc", 0),
+			MURMUR_TEST_CASE("abcd", 0),
+			MURMUR_TEST_CASE("abcde", 0),
+			MURMUR_TEST_CASE("abcdef", 0),
+			MURMUR_TEST_CASE("abcdefg", 0),
+			MURMUR_TEST_CASE("abcdefgh", 0),
+			MURMUR_TEST_CASE("abcdefghi", 0),
+			MURMUR_TEST_CASE("test_string", 0),
+			MURMUR_TEST_CASE("test_string", 0xffffffffffffffffull),
+			MURMUR_TEST_CASE("units/player/player.unit", 0),
+			MURMUR_TEST_CASE("\xff\x80\x7f\x01\xfe\xc3\xa5\x00\xe2\x82\xac", 0),
+			MURMUR_TEST_CASE("0123456789abcdef0123456789abcdef!", 42),
+		};
+		for (uint32_t i=0; i<sizeof(cases)/sizeof(cases[0]); ++i)
+			ASSERT(cases[i].hash == murmur_hash_64(cases[i].s, cases[i].len, cases[i].seed));
+
+		constexpr IdString64 id("test_string");
+		static_assert(id.id == 0xe604acc23b568f83ull, "compile time hash");
+		static_assert(IdString64("test_string") == IdString64(0xe604acc23b568f83ull), "compile time hash");
+		const char *runtime = "test_string";
+		ASSERT(IdString64(runtime, strlen(runtime)) == id);
+		ASSERT(IdString64("test") != id);
+		ASSERT(IdString64().id == 0);
+
+		// Arrays are hashed up to the first NUL. Non-const arrays and
+		// implicit conversions are rejected.
+		static constexpr char padded[32] = "test_string";
+		static_assert(IdString64(padded) == id, "hashed up to the NUL");
+		static_assert(!std::is_constructible<IdString64, char (&)[32]>::value, "non-const array");
+		static_assert(!std::is_convertible<const char (&)[12], IdString64>::value, "implicit conversion");
+	}
+
+	void test_murmur_hash_batch()
+	{
+		char data[600];
+		for (uint32_t i=0; i<sizeof(data); ++i)
+			data[i] = char(i * 131 + 7);
+
+		// Keys of different lengths in the same group of four, and a count that
+		// isn't a multiple of four.
+		const uint32_t n = 103;
+		const void *keys[n];
+		uint32_t lens[n];
+		uint64_t seeds[n], out[n];
+		for (uint32_t i=0; i<n; ++i) {
+			keys[i] = data + i;
+			lens[i] = (i * 37) % 83;
+			seeds[i] = i * 1000003;
+		}
+		lens[5] = 400;
+
+		murmur_hash_64_batch(keys, lens, seeds, out, n);
+		for (uint32_t i=0; i<n; ++i)
+			ASSERT(out[i] == murmur_hash_64(keys[i], lens[i], seeds[i]));
+
+		murmur_hash_64_batch(keys, lens, 0, out, n);
+		for (uint32_t i=0; i<n; ++i)
+			ASSERT(out[i] == murmur_hash_64(keys[i], lens[i], 0));
+
+		murmur_hash_64_batch(keys, lens, 0, out, 0);
+
+		// Keys shorter than a word, and an empty null key, in groups with
+		// longer keys. The keys are allocated with malloc() at their exact size,
+		// so that reads past their ends show up in memory checkers.
+		const uint32_t short_n = 20;
+		const void *short_keys[short_n];
+		uint32_t short_lens[short_n];
+		uint64_t short_out[short_n];
+		for (uint32_t i=0; i<short_n; ++i) {
+			const uint32_t k = i % 10;
+			short_lens[i] = k == 0 ? 40 : k == 8 ? 0 : k == 9 ? 24 : k;
+			char *key = short_lens[i] ? (char *)malloc(short_lens[i]) : 0;
+			for (uint32_t j=0; j<short_lens[i]; ++j)
+				key[j] = char(i * 7 + j);
+			short_keys[i] = key;
+		}
+		murmur_hash_64_batch(short_keys, short_lens, 0, short_out, short_n);
+		for (uint32_t i=0; i<short_n; ++i) {
+			ASSERT(short_out[i] == murmur_hash_64(short_keys[i], short_lens[i], 0));
+			free((void *)short_keys[i]);
+		}
+	}
+
+	void test_fast_hash()
+	{
+		using namespace fast_hash_internal;
+
+		static char data[5000];
+		for (uint32_t i=0; i<sizeof(data); ++i)
+			data[i] = char(i * 131 + 7);
+
+		for (uint32_t len=0; len<300; ++len) {
+			ASSERT(wy_hash_64(data, len, 1) == wy_hash_64(data, len, 1));
+			ASSERT(wy_hash_64(data, len, 1) != wy_hash_64(data, len, 2));
+			ASSERT(wide_hash_64(data, len, 1) != wide_hash_64(data, len, 2));
+			if (len > 0)
+				ASSERT(wy_hash_64(data, len, 1) != wy_hash_64(data, len - 1, 1));
+		}
+		ASSERT(wide_hash_64(data, 100, 3) == wy_hash_64(data, 100, 3));
+
+		// All implementations of the wide hash agree, for unaligned data and for
+		// lengths around the stripe and block sizes.
+		const uint32_t lengths[] = {256, 257, 319, 320, 321, 1023, 1024, 1025, 1087, 1088, 2047, 2048, 4000};
+		for (uint32_t i=0; i<sizeof(lengths)/sizeof(lengths[0]); ++i) {
+			for (uint32_t offset=0; offset<4; ++offset) {
+				const uint64_t h = wide_hash_64_scalar(data + offset, lengths[i], 7);
+				ASSERT(wide_hash_64_sse2(data + offset, lengths[i], 7) == h);
+				ASSERT(wide_hash_64_avx2(data + offset, lengths[i], 7) == h);
+				ASSERT(wide_hash_64(data + offset, lengths[i], 7) == h);
+			}
+		}
+
+		// Every input byte affects the result.
+		const uint64_t h = wide_hash_64(data, 2000, 0);
+		for (uint32_t i=0; i<2000; i += 13) {
+			data[i] ^= 1;
+			ASSERT(wide_hash_64(data, 2000, 0) != h);
+			data[i] ^= 1;
+		}
+	}
+
+	void test_tree_hash()
+	{
+		memory_globals::init();
+		Allocator &a = memory_globals::default_allocator();
+		{
+			const uint32_t len = 10000;
+			char *data = (char *)a.allocate(len);
+			for (uint32_t i=0; i<len; ++i)
+				data[i] = char(i * 131 + 7);
+
+			// The root doesn't depend on the number of threads.
+			TreeHash t(a, 256);
+			const uint64_t root = tree_hash::build(t, data, len, 1);
+			ASSERT(tree_hash::num_leaves(t) == 40);
+			ASSERT(tree_hash::leaf_length(t, 39) == 16);
+			for (uint32_t threads=0; threads<=5; ++threads) {
+				TreeHash t2(a, 256);
+				ASSERT(tree_hash::build(t2, data, len, threads) == root);
+			}
+
+			// The leaf size and the seed change the root.
+			{
+				TreeHash t2(a, 512);
+				ASSERT(tree_hash::build(t2, data, len, 2) != root);
+				TreeHash t3(a, 256, 1);
+				ASSERT(tree_hash::build(t3, data, len, 2) != root);
+			}
+
+			ASSERT(tree_hash::verify(t, data, 0, len));
+
+			// Changes are found by verify() and update() only rehashes the leaves
+			// that changed.
+			data[1000] ^= 1;
+			data[5000] ^= 1;
+			Array<uint32_t> mismatched(a);
+			ASSERT(!tree_hash::verify(t, data, 0, len, &mismatched, 3));
+			ASSERT(array::size(mismatched) == 2 && mismatched[0] == 3 && mismatched[1] == 19);
+			ASSERT(tree_hash::verify(t, data, 1024, 3000));
+
+			tree_hash::update(t, data, 1000, 1);
+			ASSERT(tree_hash::update(t, data, 5000, 1) != root);
+			ASSERT(tree_hash::verify(t, data, 0, len));
+			{
+				TreeHash t2(a, 256);
+				ASSERT(tree_hash::build(t2, data, len) == tree_hash::root(t));
+			}
+
+			data[1000] ^= 1;
+			data[5000] ^= 1;
+			ASSERT(tree_hash::update(t, data, 0, len) == root);
+
+			TreeHash empty(a);
+			ASSERT(tree_hash::build(empty, data, 0) == tree_hash::root(empty));
+			ASSERT(tree_hash::num_leaves(empty) == 0);
+
+			a.deallocate(data);
+		}
+		memory_globals::shutdown();
+	}
+
 	void test_pointer_arithmetic()
 	{
 		const char check = (char)0xfe;
@@ -208,6 +1141,728 @@ namespace {
 		memory_globals::shutdown();
 	}
 
+	void test_string_stream_numbers()
+	{
+		memory_globals::init();
+		{
+			using namespace string_stream;
+
+			TempAllocator1024 ta;
+			Buffer ss(ta);
+
+			ss << 0u << ' ' << 7u << ' ' << 42u << ' ' << 100u << ' ' << 4294967295u;
+			ASSERT(0 == strcmp(c_str(ss), "0 7 42 100 4294967295"));
+			array::clear(ss);
+
+			ss << 0 << ' ' << -1 << ' ' << 12345 << ' ' << (int32_t)0x7fffffff << ' ' << (int32_t)0x80000000;
+			ASSERT(0 == strcmp(c_str(ss), "0 -1 12345 2147483647 -2147483648"));
+			array::clear(ss);
+
+			ss << (uint64_t)0 << ' ' << (uint64_t)0xabc << ' ' << ~(uint64_t)0;
+			ASSERT(0 == strcmp(c_str(ss), "0 abc ffffffffffffffff"));
+			array::clear(ss);
+
+			// Floats use the shortest representation that reads back as the
+			// same float.
+			ss << 0.0f << ' ' << -0.0f << ' ' << 1.0f << ' ' << 0.1f << ' ' << 3.14159265f << ' ' << -2.5f;
+			ASSERT(0 == strcmp(c_str(ss), "0 -0 1 0.1 3.1415927 -2.5"));
+			array::clear(ss);
+
+			ss << 100.0f << ' ' << 123456789.0f << ' ' << 1e9f << ' ' << 0.0001f << ' ' << 1.5e-7f << ' ' << 3.4028235e38f << ' ' << 1e-45f;
+			ASSERT(0 == strcmp(c_str(ss), "100 123456790 1e+09 0.0001 1.5e-07 3.4028235e+38 1e-45"));
+			array::clear(ss);
+
+			const float inf = 1e38f * 10.0f;
+			ss << inf << ' ' << -inf << ' ' << (inf - inf);
+			ASSERT(0 == strncmp(c_str(ss), "inf -inf ", 9));
+			ASSERT(strstr(c_str(ss) + 9, "nan") != 0);
+
+			uint32_t bits = 1;
+			for (uint32_t i=0; i<10000; ++i) {
+				bits ^= bits << 13;
+				bits ^= bits >> 17;
+				bits ^= bits << 5;
+				float f;
+				memcpy(&f, &bits, sizeof(f));
+				if (f != f || f == inf || f == -inf)
+					continue;
+				array::clear(ss);
+				ss << f;
+				const float g = strtof(c_str(ss), 0);
+				ASSERT(memcmp(&f, &g, sizeof(f)) == 0);
+			}
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_string_stream_format()
+	{
+		memory_globals::init();
+		{
+			using namespace string_stream;
+
+			TempAllocator256 ta;
+			Buffer ss(ta);
+
+			format(ss, FORMAT_STRING("{} of {} done"), 3, 10u);
+			ASSERT(0 == strcmp(c_str(ss), "3 of 10 done"));
+			array::clear(ss);
+
+			format(ss, FORMAT_STRING("{}{} '{}' {{{}}} {}"), 'x', -1, "name", 1.5f, (uint64_t)0xff);
+			ASSERT(0 == strcmp(c_str(ss), "x-1 'name' {1.5} ff"));
+			array::clear(ss);
+
+			format(ss, FORMAT_STRING("no arguments"));
+			format(ss, FORMAT_STRING(""));
+			format(ss, FORMAT_STRING("{}"), "");
+			ASSERT(0 == strcmp(c_str(ss), "no arguments"));
+
+			// The output is appended to the buffer.
+			format(ss, FORMAT_STRING(", {}"), 42);
+			ASSERT(0 == strcmp(c_str(ss), "no arguments, 42"));
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_rope_buffer()
+	{
+		memory_globals::init();
+		{
+			Allocator &a = memory_globals::default_allocator();
+
+			// Write the same text to a rope with tiny chunks and to a
+			// string_stream and compare.
+			RopeBuffer r(a, 16);
+			string_stream::Buffer ss(a);
+			for (int i=0; i<100; ++i) {
+				{
+					using namespace rope_buffer;
+					r << "line " << i << ':';
+					tab(r, 12);
+					r << 1.25f << ' ' << (uint32_t)i << ' ' << (uint64_t)0xabcdef;
+					printf(r, " %s %d", "printf", i * 1000);
+					format(r, FORMAT_STRING(" [{}]"), "a long argument that is longer than a chunk");
+					repeat(r, i % 40, '-');
+					r << '\n';
+				}
+				{
+					using namespace string_stream;
+					ss << "line " << i << ':';
+					tab(ss, 12);
+					ss << 1.25f << ' ' << (uint32_t)i << ' ' << (uint64_t)0xabcdef;
+					printf(ss, " %s %d", "printf", i * 1000);
+					format(ss, FORMAT_STRING(" [{}]"), "a long argument that is longer than a chunk");
+					repeat(ss, i % 40, '-');
+					ss << '\n';
+				}
+			}
+			ASSERT(rope_buffer::size(r) == array::size(ss));
+			ASSERT(rope_buffer::num_chunks(r) > 100);
+
+			Array<char> flat(a);
+			rope_buffer::copy(r, flat);
+			ASSERT(array::size(flat) == array::size(ss));
+			ASSERT(0 == memcmp(array::begin(flat), array::begin(ss), array::size(ss)));
+
+			// Write to a file and read it back.
+			FILE *f = tmpfile();
+			ASSERT(f);
+			ASSERT(rope_buffer::flush(r, fileno(f)));
+			ASSERT(rope_buffer::size(r) == 0);
+			ASSERT(rope_buffer::num_chunks(r) == 1);
+			rewind(f);
+			Array<char> read(a);
+			array::resize(read, array::size(ss) + 1);
+			ASSERT(fread(array::begin(read), 1, array::size(read), f) == array::size(ss));
+			ASSERT(0 == memcmp(array::begin(read), array::begin(ss), array::size(ss)));
+			fclose(f);
+
+			// The rope can be reused after a flush.
+			{
+				using namespace rope_buffer;
+				r << "again";
+				tab(r, 8);
+				r << '|';
+			}
+			array::clear(flat);
+			rope_buffer::copy(r, flat);
+			array::push_back(flat, '\0');
+			ASSERT(0 == strcmp(array::begin(flat), "again   |"));
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_log_sink()
+	{
+		memory_globals::init();
+		{
+			Allocator &a = memory_globals::default_allocator();
+			const uint32_t THREADS = 4;
+			const uint32_t LINES = 2000;
+
+			// Small buffers and a short queue, so writers have to wait for the
+			// background thread.
+			FILE *f = tmpfile();
+			ASSERT(f);
+			{
+				LogSink sink(a, fileno(f), 256, 2);
+				std::thread threads[THREADS];
+				for (uint32_t t=0; t<THREADS; ++t) {
+					threads[t] = std::thread([&sink, t] {
+						LogWriter w(sink);
+						for (uint32_t i=0; i<LINES; ++i) {
+							string_stream::format(log_writer::buffer(w), FORMAT_STRING("{} {}\n"), t, i);
+							log_writer::commit(w);
+						}
+					});
+				}
+				for (uint32_t t=0; t<THREADS; ++t)
+					threads[t].join();
+				log_sink::flush(sink);
+				const LogSinkStats stats = log_sink::stats(sink);
+				ASSERT(stats.queued_bytes == stats.written_bytes);
+				ASSERT(stats.dropped_bytes == 0);
+				ASSERT(stats.written_bytes == (uint64_t)ftell(f));
+			}
+
+			// Each thread's lines are written in order.
+			rewind(f);
+			uint32_t next[THREADS] = {0};
+			uint32_t t, i;
+			while (fscanf(f, "%u %u", &t, &i) == 2) {
+				ASSERT(t < THREADS);
+				ASSERT(i == next[t]);
+				++next[t];
+			}
+			for (uint32_t j=0; j<THREADS; ++j)
+				ASSERT(next[j] == LINES);
+			fclose(f);
+
+			// With the DROP policy, buffers are dropped while the background
+			// thread is stuck on a full pipe.
+			int fds[2];
+			ASSERT(pipe(fds) == 0);
+			uint64_t committed = 0;
+			uint64_t read_bytes = 0;
+			LogSinkStats stats;
+			{
+				LogSink sink(a, fds[1], 4096, 1, LogSink::DROP);
+				{
+					LogWriter w(sink);
+					for (uint32_t i=0; i<100000; ++i) {
+						const uint32_t before = array::size(log_writer::buffer(w));
+						string_stream::format(log_writer::buffer(w), FORMAT_STRING("line {}\n"), i);
+						committed += array::size(log_writer::buffer(w)) - before;
+						log_writer::commit(w);
+					}
+				}
+				std::thread reader([&fds, &read_bytes] {
+					char data[4096];
+					ssize_t n;
+					while ((n = read(fds[0], data, sizeof(data))) > 0)
+						read_bytes += n;
+				});
+				log_sink::flush(sink);
+				stats = log_sink::stats(sink);
+				close(fds[1]);
+				reader.join();
+			}
+			close(fds[0]);
+			ASSERT(stats.dropped_bytes > 0);
+			ASSERT(stats.written_bytes == read_bytes);
+			ASSERT(stats.written_bytes + stats.dropped_bytes == committed);
+
+			// Failed writes are counted as dropped.
+			{
+				LogSink sink(a, -1);
+				LogWriter w(sink);
+				string_stream::format(log_writer::buffer(w), FORMAT_STRING("lost\n"));
+				log_writer::flush(w);
+				log_sink::flush(sink);
+				ASSERT(log_sink::stats(sink).dropped_bytes == 5);
+			}
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_string_reader()
+	{
+		memory_globals::init();
+		{
+			using namespace string_reader;
+
+			const char *text = "id,value,name\r\n1,-2.5,first\n\n2,1e3,a field that is longer than sixty-four characters so it is scanned in blocks\nlast";
+			StringReader r(text, text + strlen(text));
+			ASSERT(string_view::equals(read_line(r), "id,value,name"));
+
+			StringView line = read_line(r);
+			StringReader fields(line.begin, line.end);
+			uint32_t id;
+			ASSERT(read(fields, id) == PARSE_OK && id == 1);
+			ASSERT(string_view::size(read_until(fields, ',')) == 0);
+			double d;
+			ASSERT(read(fields, d) == PARSE_OK && d == -2.5);
+			ASSERT(string_view::size(read_until(fields, ',')) == 0);
+			ASSERT(string_view::equals(read_until(fields, ','), "first"));
+			ASSERT(at_end(fields));
+
+			ASSERT(string_view::size(read_line(r)) == 0);
+			line = read_line(r);
+			fields = StringReader(line.begin, line.end);
+			ASSERT(string_view::equals(read_until(fields, ','), "2"));
+			ASSERT(read(fields, d) == PARSE_OK && d == 1000.0);
+			ASSERT(string_view::size(read_until(fields, ',')) == 0);
+			ASSERT(string_view::size(read_until(fields, ',')) == 76);
+			ASSERT(string_view::equals(read_line(r), "last"));
+			ASSERT(at_end(r));
+			ASSERT(string_view::size(read_line(r)) == 0);
+
+			// Tokens and numbers.
+			Array<char> a(memory_globals::default_allocator());
+			string_stream::printf(a, "  key 42\t-17 0.1 1e-3 -0 inf 99999999999999999999 4294967296 x");
+			r = StringReader(a);
+			ASSERT(string_view::equals(read_token(r), "key"));
+			int32_t i;
+			skip_whitespace(r);
+			ASSERT(read(r, i) == PARSE_OK && i == 42);
+			skip_whitespace(r);
+			ASSERT(read(r, i) == PARSE_OK && i == -17);
+			float f;
+			skip_whitespace(r);
+			ASSERT(read(r, f) == PARSE_OK && f == 0.1f);
+			skip_whitespace(r);
+			ASSERT(read(r, d) == PARSE_OK && d == 1e-3);
+			skip_whitespace(r);
+			ASSERT(read(r, f) == PARSE_OK && f == 0.0f && signbit(f));
+			skip_whitespace(r);
+			ASSERT(read(r, d) == PARSE_OK && isinf(d));
+			uint64_t u;
+			skip_whitespace(r);
+			ASSERT(read(r, u) == PARSE_OUT_OF_RANGE);
+			skip_whitespace(r);
+			ASSERT(read(r, id) == PARSE_OUT_OF_RANGE);
+			skip_whitespace(r);
+			const char *before = position(r);
+			ASSERT(read(r, i) == PARSE_INVALID && position(r) == before);
+			ASSERT(remaining(r) == 1);
+
+			// Edge cases of the number syntax.
+			const char *s = "-9223372036854775808";
+			int64_t i64;
+			ASSERT(parse(s, s + strlen(s), i64).error == PARSE_OK && i64 == -(int64_t)(~0ull >> 1) - 1);
+			s = "18446744073709551615";
+			ASSERT(parse(s, s + strlen(s), u).error == PARSE_OK && u == ~(uint64_t)0);
+			s = "+1";
+			ASSERT(parse(s, s + 2, i).error == PARSE_INVALID);
+			s = "-";
+			ASSERT(parse(s, s + 1, d).error == PARSE_INVALID);
+			s = "1.5e";
+			ParseResult res = parse(s, s + 4, d);
+			ASSERT(res.error == PARSE_OK && d == 1.5 && res.end == s + 3);
+			s = "1e400";
+			ASSERT(parse(s, s + 5, d).error == PARSE_OUT_OF_RANGE);
+			s = "1e-50";
+			ASSERT(parse(s, s + 5, f).error == PARSE_OUT_OF_RANGE);
+			s = "0.30000000000000000000000000000000000000001";
+			ASSERT(parse(s, s + strlen(s), d).error == PARSE_OK && d == 0.3);
+
+			// Floats written by string_stream read back as the same value.
+			uint32_t x = 12345;
+			for (uint32_t n=0; n<100000; ++n) {
+				x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+				float v;
+				memcpy(&v, &x, sizeof(v));
+				if (isnan(v))
+					continue;
+				array::clear(a);
+				string_stream::operator<<(a, v);
+				float back;
+				ASSERT(parse(array::begin(a), array::end(a), back).error == PARSE_OK);
+				ASSERT(memcmp(&v, &back, sizeof(v)) == 0);
+			}
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_sjson()
+	{
+		memory_globals::init();
+		{
+			using namespace sjson;
+			Allocator &a = memory_globals::default_allocator();
+
+			const char *text =
+				"// A comment\n"
+				"name = \"box\"\n"
+				"size = [1, 2.5 -3e2]\n"
+				"visible = true, hidden: false\n"
+				"/* A block\n comment */\n"
+				"material = {\n"
+				"\tcolor = [0 0.5 1]\n"
+				"\t\"quoted key\" = \"tab\\there \\u00e9 \\ud83d\\ude00\"\n"
+				"\tnone = null\n"
+				"\tempty = {}\n"
+				"}\n"
+				"script = \"\"\"raw \\n \"string\" \"\"\"\n";
+			SjsonDocument d(a);
+			ASSERT(parse(d, text, (uint32_t)strlen(text)));
+			ASSERT(error(d) == 0);
+
+			const uint32_t r = root(d);
+			ASSERT(type(d, r) == SjsonNode::OBJECT);
+			ASSERT(size(d, r) == 6);
+			ASSERT(0 == strcmp(get_string(d, r, "name", ""), "box"));
+			ASSERT(get_bool(d, r, "visible", false));
+			ASSERT(!get_bool(d, r, "hidden", true));
+			ASSERT(get_number(d, r, "missing", 7.0) == 7.0);
+			ASSERT(get(d, r, "color") == NOT_FOUND);
+
+			const uint32_t sz = get(d, r, "size");
+			ASSERT(type(d, sz) == SjsonNode::ARRAY && size(d, sz) == 3);
+			const double expected[] = {1, 2.5, -300};
+			uint32_t n = 0;
+			for (uint32_t c = first_child(d, sz); c != end(d, sz); c = next(d, c))
+				ASSERT(number(d, c) == expected[n++]);
+			ASSERT(n == 3);
+
+			constexpr IdString64 material("material");
+			const uint32_t m = get(d, r, material);
+			ASSERT(type(d, m) == SjsonNode::OBJECT && size(d, m) == 4);
+			ASSERT(0 == strcmp(key(d, m), "material"));
+			ASSERT(number(d, first_child(d, get(d, m, "color")) + 2) == 1.0);
+			const uint32_t q = get(d, m, "quoted key");
+			ASSERT(0 == strcmp(string(d, q), "tab\there \xc3\xa9 \xf0\x9f\x98\x80"));
+			ASSERT(string_length(d, q) == 16);
+			ASSERT(type(d, get(d, m, "none")) == SjsonNode::NIL);
+			ASSERT(size(d, get(d, m, "empty")) == 0);
+			ASSERT(next(d, m) == get(d, r, "script"));
+			ASSERT(0 == strcmp(get_string(d, r, "script", ""), "raw \\n \"string\" "));
+
+			// Errors report the line.
+			const char *bad = "a = 1\nb = [1, 2\nc = {\n";
+			ASSERT(!parse(d, bad, (uint32_t)strlen(bad)));
+			ASSERT(error(d) != 0 && error_line(d) == 3);
+			bad = "a = 1\nb = 1x\n";
+			ASSERT(!parse(d, bad, (uint32_t)strlen(bad)) && error_line(d) == 2);
+			bad = "a = \"open";
+			ASSERT(!parse(d, bad, (uint32_t)strlen(bad)));
+
+			// Large objects are looked up through the hash.
+			Array<char> big(a);
+			for (uint32_t i=0; i<100; ++i)
+				string_stream::printf(big, "key_%u = %u\n", i, i * 10);
+			string_stream::printf(big, "key_7 = 1\n");
+			ASSERT(parse(d, array::begin(big), array::size(big)));
+			ASSERT(size(d, root(d)) == 101);
+			for (uint32_t i=0; i<100; ++i) {
+				char k[16];
+				snprintf(k, sizeof(k), "key_%u", i);
+				ASSERT(get_number(d, root(d), k, -1) == (i == 7 ? 1 : i * 10));
+			}
+			ASSERT(get(d, root(d), "key_100") == NOT_FOUND);
+
+			// JSON documents.
+			const char *json = "{\"a\": [{\"b\": 1}, {\"b\": 2}], \"c\": \"x\"}";
+			ASSERT(parse(d, json, (uint32_t)strlen(json)));
+			const uint32_t arr = get(d, root(d), "a");
+			ASSERT(number(d, get(d, next(d, first_child(d, arr)), "b")) == 2.0);
+			ASSERT(0 == strcmp(get_string(d, root(d), "c", ""), "x"));
+
+			// Written documents read back.
+			for (uint32_t json_mode = 0; json_mode < 2; ++json_mode) {
+				Array<char> b(a);
+				SjsonWriter w(b, json_mode != 0);
+				sjson_writer::write(w, "name", "quote \" and\nnewline");
+				sjson_writer::write(w, "needs quotes", 1.5f);
+				sjson_writer::begin_array(w, "values");
+				sjson_writer::write(w, 0, (int32_t)-4);
+				sjson_writer::write(w, 0, 0.1);
+				sjson_writer::write(w, 0, 3.0);
+				sjson_writer::begin_object(w, 0);
+				sjson_writer::write(w, "flag", true);
+				sjson_writer::write_null(w, "nothing");
+				sjson_writer::end_object(w);
+				sjson_writer::begin_array(w, 0);
+				sjson_writer::end_array(w);
+				sjson_writer::end_array(w);
+				sjson_writer::write(w, "count", (uint32_t)4000000000u);
+				sjson_writer::finish(w);
+
+				ASSERT(parse(d, array::begin(b), array::size(b)));
+				ASSERT(0 == strcmp(get_string(d, root(d), "name", ""), "quote \" and\nnewline"));
+				ASSERT(get_number(d, root(d), "needs quotes", 0) == 1.5);
+				ASSERT(get_number(d, root(d), "count", 0) == 4000000000.0);
+				const uint32_t v = get(d, root(d), "values");
+				ASSERT(size(d, v) == 5);
+				uint32_t c = first_child(d, v);
+				ASSERT(number(d, c) == -4.0);
+				c = next(d, c);
+				ASSERT(number(d, c) == 0.1);
+				c = next(d, c);
+				ASSERT(number(d, c) == 3.0);
+				c = next(d, c);
+				ASSERT(get_bool(d, c, "flag", false));
+				ASSERT(type(d, get(d, c, "nothing")) == SjsonNode::NIL);
+				c = next(d, c);
+				ASSERT(type(d, c) == SjsonNode::ARRAY && size(d, c) == 0);
+			}
+
+			// NUL characters are errors, also in the root object.
+			const char nul[] = "a = 1\0 garbage { [";
+			ASSERT(!parse(d, nul, sizeof(nul) - 1) && error_line(d) == 1);
+
+			// Surrogates.
+			const char *escaped = "a = \"\\uD83D\\uDE00\" b = \"\\uD800x\" c = \"\\uDC00\\uD800\\u0041\"";
+			ASSERT(parse(d, escaped, (uint32_t)strlen(escaped)));
+			ASSERT(0 == strcmp(get_string(d, root(d), "a", ""), "\xf0\x9f\x98\x80"));
+			ASSERT(0 == strcmp(get_string(d, root(d), "b", ""), "\xef\xbf\xbdx"));
+			ASSERT(0 == strcmp(get_string(d, root(d), "c", ""), "\xef\xbf\xbd\xef\xbf\xbd" "A"));
+			bad = "a = \"\\uD800\\uDC0G\"";
+			ASSERT(!parse(d, bad, (uint32_t)strlen(bad)));
+
+			// Numbers that underflow read as zero, numbers that overflow are
+			// errors.
+			const char *tiny = "a = 1e-400 b = -0.00001e-320 c = 4.9e-324 d = 100e-309";
+			ASSERT(parse(d, tiny, (uint32_t)strlen(tiny)));
+			ASSERT(get_number(d, root(d), "a", 1) == 0.0);
+			ASSERT(get_number(d, root(d), "b", 1) == 0.0 && signbit(get_number(d, root(d), "b", 1)));
+			ASSERT(get_number(d, root(d), "c", 0) > 0.0);
+			ASSERT(get_number(d, root(d), "d", 0) == 1e-307);
+			const char *large = "a = 0.001e310";
+			ASSERT(parse(d, large, (uint32_t)strlen(large)) && get_number(d, root(d), "a", 0) == 1e307);
+			bad = "a = 10000e305";
+			ASSERT(!parse(d, bad, (uint32_t)strlen(bad)));
+
+			// Doubles are written without the locale's decimal point, with
+			// the fewest digits that read back. JSON has no inf and nan.
+			setlocale(LC_NUMERIC, "de_DE.UTF-8");
+			const double doubles[] = {1.5e-5, -0.1, 1234567.25, 0.30000000000000004, 1e21, -2.5e-300, 5e-324, 1.7976931348623157e308};
+			const char *written[] = {"1.5e-05", "-0.1", "1234567.25", "0.30000000000000004", "1e+21", "-2.5e-300", "4.94065645841247e-324", "1.7976931348623157e+308"};
+			for (uint32_t json_mode = 0; json_mode < 2; ++json_mode) {
+				Array<char> b(a);
+				SjsonWriter w(b, json_mode != 0);
+				sjson_writer::begin_array(w, "a");
+				for (uint32_t i=0; i<sizeof(doubles)/sizeof(doubles[0]); ++i)
+					sjson_writer::write(w, 0, doubles[i]);
+				sjson_writer::write(w, 0, (double)INFINITY);
+				sjson_writer::write(w, 0, (float)NAN);
+				sjson_writer::end_array(w);
+				sjson_writer::finish(w);
+				array::push_back(b, '\0');
+				for (uint32_t i=0; i<sizeof(written)/sizeof(written[0]); ++i)
+					ASSERT(strstr(array::begin(b), written[i]));
+				ASSERT(strstr(array::begin(b), json_mode ? "null,\n\t\tnull" : "inf\n\tnan"));
+
+				ASSERT(parse(d, array::begin(b), array::size(b) - 1));
+				uint32_t c = first_child(d, get(d, root(d), "a"));
+				for (uint32_t i=0; i<sizeof(doubles)/sizeof(doubles[0]); ++i, c = next(d, c))
+					ASSERT(number(d, c) == doubles[i]);
+				ASSERT(json_mode ? type(d, c) == SjsonNode::NIL : isinf(number(d, c)));
+			}
+			setlocale(LC_NUMERIC, "C");
+		}
+		memory_globals::shutdown();
+	}
+
+	bool near(float a, float b, float eps = 1e-4f)
+	{
+		return fabsf(a - b) <= eps * (1.0f + fabsf(a) + fabsf(b));
+	}
+
+	bool near(const Vector3 &a, const Vector3 &b)
+	{
+		return near(a.x, b.x) && near(a.y, b.y) && near(a.z, b.z);
+	}
+
+	bool near(const Quaternion &a, const Quaternion &b)
+	{
+		return near(a.x, b.x) && near(a.y, b.y) && near(a.z, b.z) && near(a.w, b.w);
+	}
+
+	void test_vector_math()
+	{
+		const Vector3 x = {1, 0, 0};
+		const Vector3 y = {0, 1, 0};
+		const Vector3 z = {0, 0, 1};
+		ASSERT(vector3::dot(x, y) == 0);
+		ASSERT(near(vector3::cross(x, y), z));
+		const Vector3 v = {3, 4, 12};
+		ASSERT(vector3::length(v) == 13);
+		ASSERT(near(vector3::length(vector3::normalize(v)), 1));
+		const Vector4 v4 = {1, 2, 3, 4};
+		ASSERT(vector4::dot(v4, v4) == 30);
+		ASSERT(near(vector4::length(vector4::normalize(v4)), 1));
+
+		// Quaternions.
+		const float pi = 3.14159265f;
+		const Quaternion qz = quaternion::from_axis_angle(z, pi / 2);
+		ASSERT(near(quaternion::rotate(qz, x), y));
+		const Quaternion qx = quaternion::from_axis_angle(x, pi / 2);
+		const Quaternion q = quaternion::multiply(qz, qx);
+		// The product first applies qx, then qz.
+		ASSERT(near(quaternion::rotate(q, y), quaternion::rotate(qz, quaternion::rotate(qx, y))));
+		const Quaternion expected = {
+			qz.w * qx.x + qz.x * qx.w + qz.y * qx.z - qz.z * qx.y,
+			qz.w * qx.y - qz.x * qx.z + qz.y * qx.w + qz.z * qx.x,
+			qz.w * qx.z + qz.x * qx.y - qz.y * qx.x + qz.z * qx.w,
+			qz.w * qx.w - qz.x * qx.x - qz.y * qx.y - qz.z * qx.z};
+		ASSERT(near(q, expected));
+		ASSERT(near(quaternion::multiply(q, quaternion::conjugate(q)), quaternion::identity()));
+
+		const Quaternion id = quaternion::identity();
+		ASSERT(near(quaternion::slerp(id, qz, 0), id));
+		ASSERT(near(quaternion::slerp(id, qz, 1), qz));
+		ASSERT(near(quaternion::slerp(id, qz, 0.5f), quaternion::from_axis_angle(z, pi / 4)));
+		const Quaternion neg_qz = {-qz.x, -qz.y, -qz.z, -qz.w};
+		ASSERT(near(quaternion::rotate(quaternion::slerp(id, neg_qz, 0.5f), x), quaternion::rotate(quaternion::from_axis_angle(z, pi / 4), x)));
+		ASSERT(near(quaternion::slerp(qz, qz, 0.3f), qz));
+
+		// Matrices.
+		uint32_t seed = 1;
+		Matrix4x4 m[8], n[8], out[8];
+		for (uint32_t i=0; i<8; ++i) {
+			float *f = &m[i].x.x;
+			for (uint32_t j=0; j<16; ++j) {
+				seed = seed * 1664525u + 1013904223u;
+				f[j] = (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f + (j % 5 == 0 ? 4.0f : 0.0f);
+			}
+			n[i] = matrix4x4::inverse(m[i]);
+			const Matrix4x4 p = matrix4x4::multiply(m[i], n[i]);
+			const Matrix4x4 ident = matrix4x4::identity();
+			for (uint32_t j=0; j<16; ++j)
+				ASSERT(fabsf((&p.x.x)[j] - (&ident.x.x)[j]) < 1e-4f);
+		}
+		matrix4x4::multiply(m, n, out, 8);
+		for (uint32_t i=0; i<8; ++i) {
+			const Matrix4x4 p = matrix4x4::multiply(m[i], n[i]);
+			ASSERT(memcmp(&p, &out[i], sizeof(p)) == 0);
+		}
+
+		Matrix4x4 t = matrix4x4::multiply(
+			matrix4x4::identity(), matrix4x4::identity());
+		t.t.x = 10;
+		t = matrix4x4::multiply(t, m[0]);
+		Vector3 points[11];
+		Vector3 transformed[11];
+		for (uint32_t i=0; i<11; ++i) {
+			points[i].x = (float)i;
+			points[i].y = (float)i * 2 - 5;
+			points[i].z = 1.0f / (float)(i + 1);
+		}
+		matrix4x4::transform_points(t, points, transformed, 11);
+		for (uint32_t i=0; i<11; ++i) {
+			const Vector3 p = matrix4x4::transform_point(t, points[i]);
+			ASSERT(memcmp(&p, &transformed[i], sizeof(p)) == 0);
+			const Vector3 shifted = {points[i].x + 10, points[i].y, points[i].z};
+			ASSERT(near(p, matrix4x4::transform_vector(m[0], shifted) + matrix4x4::transform_point(m[0], Vector3())));
+		}
+		matrix4x4::transform_vectors(t, points, points, 11);
+		for (uint32_t i=0; i<11; ++i)
+			ASSERT(near(points[i], transformed[i] - matrix4x4::transform_point(t, Vector3())));
+	}
+
+	bool equal(const Vector3 &a, const Vector3 &b) {return a.x == b.x && a.y == b.y && a.z == b.z;}
+	bool equal(const Vector4 &a, const Vector4 &b) {return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;}
+	bool equal(const Quaternion &a, const Quaternion &b) {return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;}
+
+	void test_soa_array()
+	{
+		memory_globals::init();
+		Allocator &a = memory_globals::default_allocator();
+		{
+			// 37 elements exercise all the kernel widths and the scalar tail.
+			const uint32_t n = 37;
+			Vector3 points[n];
+			Vector4 vectors[n];
+			Quaternion rotations[n];
+			for (uint32_t i=0; i<n; ++i) {
+				const float f = (float)i;
+				const Vector3 p = {f * 0.5f - 3.0f, 1.0f + f * f * 0.01f, 2.0f - f * 0.25f};
+				const Vector4 v = {p.x, p.y, p.z, f * 0.1f - 1.0f};
+				points[i] = p;
+				vectors[i] = v;
+				rotations[i] = quaternion::from_axis_angle(vector3::normalize(p), f * 0.3f);
+			}
+
+			SoaArray<Vector3> soa(a);
+			ASSERT(soa_array::empty(soa));
+			for (uint32_t i=0; i<n; ++i)
+				soa_array::push_back(soa, points[i]);
+			ASSERT(soa_array::size(soa) == n);
+			ASSERT(soa._capacity % 16 == 0);
+			ASSERT((uintptr_t)soa_array::x(soa) % 64 == 0);
+			ASSERT((uintptr_t)soa_array::y(soa) % 64 == 0);
+			ASSERT((uintptr_t)soa_array::z(soa) % 64 == 0);
+			for (uint32_t i=0; i<n; ++i)
+				ASSERT(equal(soa_array::get(soa, i), points[i]));
+
+			SoaArray<Vector3> converted(a);
+			soa_array::from_aos(converted, points, n);
+			Vector3 back[n];
+			soa_array::to_aos(converted, back);
+			for (uint32_t i=0; i<n; ++i) {
+				ASSERT(soa_array::x(converted)[i] == points[i].x);
+				ASSERT(soa_array::z(converted)[i] == points[i].z);
+				ASSERT(equal(back[i], points[i]));
+			}
+
+			SoaArray<Quaternion> qs(a);
+			soa_array::from_aos(qs, rotations, n);
+			Quaternion qs_back[n];
+			soa_array::to_aos(qs, qs_back);
+			for (uint32_t i=0; i<n; ++i) {
+				ASSERT(soa_array::w(qs)[i] == rotations[i].w);
+				ASSERT(equal(qs_back[i], rotations[i]));
+			}
+
+			Matrix4x4 m = matrix4x4::multiply(matrix4x4::identity(), matrix4x4::identity());
+			m.x.y = 0.5f;
+			m.z.x = -0.25f;
+			m.t.x = 10.0f;
+			m.t.z = -3.0f;
+			SoaArray<Vector3> out(a);
+			soa_array::transform_points(m, soa, out);
+			ASSERT(soa_array::size(out) == n);
+			for (uint32_t i=0; i<n; ++i)
+				ASSERT(equal(soa_array::get(out, i), matrix4x4::transform_point(m, points[i])));
+			soa_array::transform_vectors(m, soa, out);
+			for (uint32_t i=0; i<n; ++i)
+				ASSERT(equal(soa_array::get(out, i), matrix4x4::transform_vector(m, points[i])));
+
+			soa_array::rotate(rotations[5], soa, out);
+			for (uint32_t i=0; i<n; ++i)
+				ASSERT(equal(soa_array::get(out, i), quaternion::rotate(rotations[5], points[i])));
+			soa_array::rotate(qs, soa, out);
+			for (uint32_t i=0; i<n; ++i)
+				ASSERT(equal(soa_array::get(out, i), quaternion::rotate(rotations[i], points[i])));
+
+			SoaArray<Vector3> copy(soa);
+			soa_array::transform_points(m, copy, copy);
+			soa_array::normalize(copy);
+			for (uint32_t i=0; i<n; ++i)
+				ASSERT(equal(soa_array::get(copy, i), vector3::normalize(matrix4x4::transform_point(m, points[i]))));
+			ASSERT(equal(soa_array::get(soa, 3), points[3]));
+
+			SoaArray<Vector4> v4(a);
+			soa_array::from_aos(v4, vectors, n);
+			soa_array::normalize(v4);
+			soa_array::normalize(qs);
+			for (uint32_t i=0; i<n; ++i) {
+				ASSERT(equal(soa_array::get(v4, i), vector4::normalize(vectors[i])));
+				ASSERT(equal(soa_array::get(qs, i), quaternion::normalize(rotations[i])));
+			}
+
+			soa_array::pop_back(soa);
+			soa_array::trim(soa);
+			ASSERT(soa_array::size(soa) == n - 1);
+			ASSERT(equal(soa_array::get(soa, n - 2), points[n - 2]));
+			soa_array::clear(soa);
+			soa_array::trim(soa);
+			ASSERT(soa._capacity == 0);
+		}
+		memory_globals::shutdown();
+	}
+
 	void test_queue()
 	{
 		memory_globals::init();
@@ -234,6 +1889,96 @@ namespace {
 			ASSERT(queue::size(q) == 0);
 		}
 	}
+
+	void test_priority_queue()
+	{
+		memory_globals::init();
+		{
+			TempAllocator1024 ta;
+			PriorityQueue<int> q(ta);
+
+			ASSERT(priority_queue::empty(q));
+			priority_queue::push(q, 5);
+			priority_queue::push(q, 3);
+			priority_queue::push(q, 8);
+			ASSERT(priority_queue::size(q) == 3);
+			ASSERT(priority_queue::top(q) == 3);
+			priority_queue::pop(q);
+			ASSERT(priority_queue::top(q) == 5);
+
+			int items[100];
+			for (int i=0; i<100; ++i)
+				items[i] = (i * 37) % 100;
+			priority_queue::push(q, items, 100);
+			priority_queue::push(q, items, 3);
+			ASSERT(priority_queue::size(q) == 105);
+			int last = -1;
+			while (!priority_queue::empty(q)) {
+				ASSERT(priority_queue::top(q) >= last);
+				last = priority_queue::top(q);
+				priority_queue::pop(q);
+			}
+
+			priority_queue::heapify(q, items, 100);
+			for (int i=0; i<100; ++i) {
+				ASSERT(priority_queue::top(q) == i);
+				priority_queue::pop(q);
+			}
+		}
+		memory_globals::shutdown();
+	}
+
+	void test_timer_wheel()
+	{
+		memory_globals::init();
+		{
+			Allocator &a = memory_globals::default_allocator();
+			TimerWheel w(a);
+			Array<uint64_t> expired(a);
+
+			timer_wheel::Handle h = timer_wheel::schedule(w, 10, 10);
+			ASSERT(timer_wheel::pending(w, h));
+			timer_wheel::advance(w, 9, expired);
+			ASSERT(array::empty(expired));
+			timer_wheel::advance(w, 10, expired);
+			ASSERT(array::size(expired) == 1 && expired[0] == 10);
+			ASSERT(!timer_wheel::pending(w, h));
+			ASSERT(!timer_wheel::cancel(w, h));
+
+			// Timers at all levels of the wheel, every third one cancelled.
+			array::clear(expired);
+			Array<timer_wheel::Handle> handles(a);
+			for (uint64_t i=0; i<1000; ++i) {
+				const uint64_t t = 10 + (i * i * 7919) % 20000000;
+				array::push_back(handles, timer_wheel::schedule(w, t, t));
+			}
+			ASSERT(timer_wheel::size(w) == 1000);
+			uint32_t cancelled = 0;
+			for (uint32_t i=0; i<1000; i += 3) {
+				ASSERT(timer_wheel::cancel(w, handles[i]));
+				++cancelled;
+			}
+			for (uint64_t now = 0; now < 20000100; now += 99991) {
+				const uint32_t n = array::size(expired);
+				timer_wheel::advance(w, now, expired);
+				for (uint32_t i=n; i<array::size(expired); ++i) {
+					ASSERT(expired[i] <= now && expired[i] > now - 99991);
+					ASSERT(i == 0 || expired[i-1] <= expired[i]);
+				}
+			}
+			ASSERT(array::size(expired) == 1000 - cancelled);
+			ASSERT(timer_wheel::size(w) == 0);
+
+			// Timers beyond the range of the wheel.
+			array::clear(expired);
+			timer_wheel::schedule(w, timer_wheel::now(w) + (1ull << 30), 1);
+			timer_wheel::advance(w, timer_wheel::now(w) + (1ull << 30) - 1, expired);
+			ASSERT(array::empty(expired));
+			timer_wheel::advance(w, timer_wheel::now(w) + 1, expired);
+			ASSERT(array::size(expired) == 1);
+		}
+		memory_globals::shutdown();
+	}
 }
 
 int main(int, char **)
@@ -243,10 +1988,38 @@ int main(int, char **)
 	test_scratch();
 	test_temp_allocator();
 	test_hash();
+	test_hash_incremental_rehash();
+	test_hash_batch();
+	test_hash_remove_if();
+	test_split_hash();
+	test_concurrent_hash();
+	test_flat_hash();
+	test_frozen_hash();
 	test_multi_hash();
+	test_grouped_hash();
+	test_hash_set();
+	test_key_hash();
+	test_lru_cache();
+	test_clock_cache();
 	test_murmur_hash();
+	test_murmur_hash_constexpr();
+	test_murmur_hash_stream();
+	test_murmur_hash_batch();
+	test_fast_hash();
+	test_tree_hash();
 	test_pointer_arithmetic();
 	test_string_stream();
+	test_string_stream_numbers();
+	test_string_stream_format();
+	test_rope_buffer();
+	test_log_sink();
+	test_string_reader();
+	test_sjson();
+	test_vector_math();
+	test_soa_array();
+	test_string_pool();
 	test_queue();
+	test_priority_queue();
+	test_timer_wheel();
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "vector_math.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+	#include <immintrin.h>
+	#define VECTOR_MATH_AVX
+#endif
+
+namespace foundation
+{
+	namespace quaternion
+	{
+		Quaternion slerp(const Quaternion &a, const Quaternion &b, float t)
+		{
+			float cos_angle = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+
+			// q and -q are the same rotation, take the shorter way around.
+			const float sign = cos_angle < 0 ? -1.0f : 1.0f;
+			cos_angle *= sign;
+
+			float wa, wb;
+			if (cos_angle > 0.9995f) {
+				// The quaternions are almost the same and sin(angle) is close to
+				// zero, so interpolate linearly and normalize.
+				wa = 1.0f - t;
+				wb = t * sign;
+				Quaternion r = {wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z, wa * a.w + wb * b.w};
+				return normalize(r);
+			}
+
+			const float angle = acosf(cos_angle);
+			const float inv_sin = 1.0f / sinf(angle);
+			wa = sinf((1.0f - t) * angle) * inv_sin;
+			wb = sinf(t * angle) * inv_sin * sign;
+			Quaternion r;
+		#if defined(FOUNDATION_SSE2)
+			using namespace vector_math_internal;
+			store(r, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(wa), load(a)), _mm_mul_ps(_mm_set1_ps(wb), load(b))));
+		#else
+			r.x = wa * a.x + wb * b.x;
+			r.y = wa * a.y + wb * b.y;
+			r.z = wa * a.z + wb * b.z;
+			r.w = wa * a.w + wb * b.w;
+		#endif
+			return r;
+		}
+	}
+
+	namespace
+	{
+	#if defined(FOUNDATION_SSE2)
+		#define VECTOR_MATH_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+		#define VECTOR_MATH_SWIZZLE(a, x, y, z, w) _mm_shuffle_ps(a, a, _MM_SHUFFLE(w, z, y, x))
+
+		// The inverse is computed from the 2x2 blocks of the matrix,
+		//
+		//     | A B |
+		//     | C D |
+		//
+		// with each 2x2 block stored row by row in one register.
+
+		/// Returns the 2x2 product a * b.
+		inline __m128 mat2_mul(__m128 a, __m128 b)
+		{
+			return _mm_add_ps(_mm_mul_ps(a, VECTOR_MATH_SWIZZLE(b, 0, 3, 0, 3)),
+				_mm_mul_ps(VECTOR_MATH_SWIZZLE(a, 1, 0, 3, 2), VECTOR_MATH_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+
+		/// Returns the 2x2 product adj(a) * b.
+		inline __m128 mat2_adj_mul(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(VECTOR_MATH_SWIZZLE(a, 3, 3, 0, 0), b),
+				_mm_mul_ps(VECTOR_MATH_SWIZZLE(a, 1, 1, 2, 2), VECTOR_MATH_SWIZZLE(b, 2, 3, 0, 1)));
+		}
+
+		/// Returns the 2x2 product a * adj(b).
+		inline __m128 mat2_mul_adj(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(a, VECTOR_MATH_SWIZZLE(b, 3, 0, 3, 0)),
+				_mm_mul_ps(VECTOR_MATH_SWIZZLE(a, 1, 0, 3, 2), VECTOR_MATH_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+
+		/// Transforms four points stored as x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3.
+		/// The points are transposed to xxxx yyyy zzzz, transformed with one
+		/// multiply per matrix element and transposed back.
+		inline void transform_four(const __m128 *rows, const float *in, float *out, bool translate)
+		{
+			const __m128 a = _mm_loadu_ps(in);
+			const __m128 b = _mm_loadu_ps(in + 4);
+			const __m128 c = _mm_loadu_ps(in + 8);
+
+			// x0 x1 x2 x3, y0 y1 y2 y3, z0 z1 z2 z3
+			const __m128 x01_y01 = VECTOR_MATH_SHUFFLE(a, b, 0, 3, 0, 1);   // x0 x1 y1 z1
+			const __m128 x23 = VECTOR_MATH_SHUFFLE(b, c, 2, 3, 1, 2);       // x2 y2 x3 y3
+			const __m128 x = VECTOR_MATH_SHUFFLE(x01_y01, x23, 0, 1, 0, 2);
+			const __m128 y0_y1 = VECTOR_MATH_SHUFFLE(a, b, 1, 1, 0, 0);     // y0 y0 y1 y1
+			const __m128 y = VECTOR_MATH_SHUFFLE(y0_y1, x23, 0, 2, 1, 3);
+			const __m128 z0_z1 = VECTOR_MATH_SHUFFLE(a, b, 2, 2, 1, 1);     // z0 z0 z1 z1
+			const __m128 z23 = VECTOR_MATH_SHUFFLE(c, c, 0, 0, 3, 3);       // z2 z2 z3 z3
+			const __m128 z = VECTOR_MATH_SHUFFLE(z0_z1, z23, 0, 2, 0, 2);
+
+			__m128 o[3];
+			for (uint32_t i=0; i<3; ++i) {
+				// rows[j] holds element i of row j in all four components.
+				__m128 r = _mm_add_ps(_mm_mul_ps(x, rows[i * 4 + 0]), _mm_mul_ps(y, rows[i * 4 + 1]));
+				r = _mm_add_ps(r, _mm_mul_ps(z, rows[i * 4 + 2]));
+				o[i] = translate ? _mm_add_ps(r, rows[i * 4 + 3]) : r;
+			}
+
+			// Back to x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3.
+			const __m128 xy01 = _mm_unpacklo_ps(o[0], o[1]);                // x0 y0 x1 y1
+			const __m128 xy23 = _mm_unpackhi_ps(o[0], o[1]);                // x2 y2 x3 y3
+			const __m128 z01 = VECTOR_MATH_SHUFFLE(o[2], xy01, 0, 1, 2, 3); // z0 z1 x1 y1
+			_mm_storeu_ps(out, VECTOR_MATH_SHUFFLE(xy01, z01, 0, 1, 0, 2));
+			const __m128 y1z1 = VECTOR_MATH_SHUFFLE(z01, o[2], 3, 1, 1, 1); // y1 z1 z1 z1
+			_mm_storeu_ps(out + 4, VECTOR_MATH_SHUFFLE(y1z1, xy23, 0, 1, 0, 1));
+			const __m128 z23_o = VECTOR_MATH_SHUFFLE(o[2], xy23, 2, 3, 2, 3); // z2 z3 x3 y3
+			_mm_storeu_ps(out + 8, VECTOR_MATH_SHUFFLE(z23_o, z23_o, 0, 2, 3, 1));
+		}
+
+		void transform_many(const Matrix4x4 &m, const Vector3 *in, Vector3 *out, uint32_t n, bool translate)
+		{
+			const float *mf = &m.x.x;
+			__m128 rows[12];
+			for (uint32_t i=0; i<3; ++i) {
+				for (uint32_t j=0; j<4; ++j)
+					rows[i * 4 + j] = _mm_set1_ps(mf[j * 4 + i]);
+			}
+			uint32_t i = 0;
+			for (; i + 4 <= n; i += 4)
+				transform_four(rows, &in[i].x, &out[i].x, translate);
+			for (; i < n; ++i)
+				out[i] = translate ? matrix4x4::transform_point(m, in[i]) : matrix4x4::transform_vector(m, in[i]);
+		}
+	#else
+		void transform_many(const Matrix4x4 &m, const Vector3 *in, Vector3 *out, uint32_t n, bool translate)
+		{
+			for (uint32_t i=0; i<n; ++i)
+				out[i] = translate ? matrix4x4::transform_point(m, in[i]) : matrix4x4::transform_vector(m, in[i]);
+		}
+	#endif
+
+	#if defined(VECTOR_MATH_AVX)
+		/// Multiplies the matrices two rows at a time, with each pair of rows
+		/// in one AVX register. The products are added in the same order as
+		/// in multiply(), so the results are the same.
+		__attribute__((target("avx"))) uint32_t multiply_avx(const Matrix4x4 *a, const Matrix4x4 *b, Matrix4x4 *out, uint32_t n)
+		{
+			for (uint32_t i=0; i<n; ++i) {
+				const __m256 b0 = _mm256_broadcast_ps((const __m128 *)&b[i].x);
+				const __m256 b1 = _mm256_broadcast_ps((const __m128 *)&b[i].y);
+				const __m256 b2 = _mm256_broadcast_ps((const __m128 *)&b[i].z);
+				const __m256 b3 = _mm256_broadcast_ps((const __m128 *)&b[i].t);
+				const __m256 a01 = _mm256_loadu_ps(&a[i].x.x);
+				const __m256 a23 = _mm256_loadu_ps(&a[i].z.x);
+
+				__m256 r01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), b0);
+				r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), b1));
+				r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xaa), b2));
+				r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xff), b3));
+				__m256 r23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), b0);
+				r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), b1));
+				r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xaa), b2));
+				r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xff), b3));
+
+				_mm256_storeu_ps(&out[i].x.x, r01);
+				_mm256_storeu_ps(&out[i].z.x, r23);
+			}
+			return n;
+		}
+
+		bool has_avx()
+		{
+			return __builtin_cpu_supports("avx");
+		}
+	#endif
+	}
+
+	namespace matrix4x4
+	{
+		void multiply(const Matrix4x4 *a, const Matrix4x4 *b, Matrix4x4 *out, uint32_t n)
+		{
+		#if defined(VECTOR_MATH_AVX)
+			static const bool avx = has_avx();
+			if (avx) {
+				multiply_avx(a, b, out, n);
+				return;
+			}
+		#endif
+			for (uint32_t i=0; i<n; ++i)
+				out[i] = multiply(a[i], b[i]);
+		}
+
+		Matrix4x4 inverse(const Matrix4x4 &m)
+		{
+			Matrix4x4 r;
+		#if defined(FOUNDATION_SSE2)
+			using namespace vector_math_internal;
+			const __m128 r0 = load(m.x);
+			const __m128 r1 = load(m.y);
+			const __m128 r2 = load(m.z);
+			const __m128 r3 = load(m.t);
+
+			const __m128 A = _mm_movelh_ps(r0, r1);
+			const __m128 B = _mm_movehl_ps(r1, r0);
+			const __m128 C = _mm_movelh_ps(r2, r3);
+			const __m128 D = _mm_movehl_ps(r3, r2);
+
+			// The determinants of A, B, C and D.
+			const __m128 det_sub = _mm_sub_ps(
+				_mm_mul_ps(VECTOR_MATH_SHUFFLE(r0, r2, 0, 2, 0, 2), VECTOR_MATH_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+				_mm_mul_ps(VECTOR_MATH_SHUFFLE(r0, r2, 1, 3, 1, 3), VECTOR_MATH_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+			const __m128 det_a = VECTOR_MATH_SWIZZLE(det_sub, 0, 0, 0, 0);
+			const __m128 det_b = VECTOR_MATH_SWIZZLE(det_sub, 1, 1, 1, 1);
+			const __m128 det_c = VECTOR_MATH_SWIZZLE(det_sub, 2, 2, 2, 2);
+			const __m128 det_d = VECTOR_MATH_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+			const __m128 d_c = mat2_adj_mul(D, C);
+			const __m128 a_b = mat2_adj_mul(A, B);
+			__m128 x = _mm_sub_ps(_mm_mul_ps(det_d, A), mat2_mul(B, d_c));
+			__m128 w = _mm_sub_ps(_mm_mul_ps(det_a, D), mat2_mul(C, a_b));
+			__m128 y = _mm_sub_ps(_mm_mul_ps(det_b, C), mat2_mul_adj(D, a_b));
+			__m128 z = _mm_sub_ps(_mm_mul_ps(det_c, B), mat2_mul_adj(A, d_c));
+
+			// det(M) = det(A) det(D) + det(B) det(C) - tr(adj(A) B adj(D) C)
+			__m128 det_m = _mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c));
+			__m128 tr = _mm_mul_ps(a_b, VECTOR_MATH_SWIZZLE(d_c, 0, 2, 1, 3));
+			tr = _mm_add_ps(tr, VECTOR_MATH_SWIZZLE(tr, 1, 0, 3, 2));
+			tr = _mm_add_ps(tr, VECTOR_MATH_SWIZZLE(tr, 2, 3, 0, 1));
+			det_m = _mm_sub_ps(det_m, tr);
+
+			const __m128 inv_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det_m);
+			x = _mm_mul_ps(x, inv_det);
+			y = _mm_mul_ps(y, inv_det);
+			z = _mm_mul_ps(z, inv_det);
+			w = _mm_mul_ps(w, inv_det);
+
+			store(r.x, VECTOR_MATH_SHUFFLE(x, y, 3, 1, 3, 1));
+			store(r.y, VECTOR_MATH_SHUFFLE(x, y, 2, 0, 2, 0));
+			store(r.z, VECTOR_MATH_SHUFFLE(z, w, 3, 1, 3, 1));
+			store(r.t, VECTOR_MATH_SHUFFLE(z, w, 2, 0, 2, 0));
+		#else
+			// The inverse is the transposed cofactor matrix divided by the
+			// determinant. The cofactors are computed from the 2x2 minors of
+			// the first two and the last two rows.
+			const float *a = &m.x.x;
+			const float s0 = a[0] * a[5] - a[4] * a[1];
+			const float s1 = a[0] * a[6] - a[4] * a[2];
+			const float s2 = a[0] * a[7] - a[4] * a[3];
+			const float s3 = a[1] * a[6] - a[5] * a[2];
+			const float s4 = a[1] * a[7] - a[5] * a[3];
+			const float s5 = a[2] * a[7] - a[6] * a[3];
+			const float c5 = a[10] * a[15] - a[14] * a[11];
+			const float c4 = a[9] * a[15] - a[13] * a[11];
+			const float c3 = a[9] * a[14] - a[13] * a[10];
+			const float c2 = a[8] * a[15] - a[12] * a[11];
+			const float c1 = a[8] * a[14] - a[12] * a[10];
+			const float c0 = a[8] * a[13] - a[12] * a[9];
+			const float inv_det = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+			float *o = &r.x.x;
+			o[0] = ( a[5] * c5 - a[6] * c4 + a[7] * c3) * inv_det;
+			o[1] = (-a[1] * c5 + a[2] * c4 - a[3] * c3) * inv_det;
+			o[2] = ( a[13] * s5 - a[14] * s4 + a[15] * s3) * inv_det;
+			o[3] = (-a[9] * s5 + a[10] * s4 - a[11] * s3) * inv_det;
+			o[4] = (-a[4] * c5 + a[6] * c2 - a[7] * c1) * inv_det;
+			o[5] = ( a[0] * c5 - a[2] * c2 + a[3] * c1) * inv_det;
+			o[6] = (-a[12] * s5 + a[14] * s2 - a[15] * s1) * inv_det;
+			o[7] = ( a[8] * s5 - a[10] * s2 + a[11] * s1) * inv_det;
+			o[8] = ( a[4] * c4 - a[5] * c2 + a[7] * c0) * inv_det;
+			o[9] = (-a[0] * c4 + a[1] * c2 - a[3] * c0) * inv_det;
+			o[10] = ( a[12] * s4 - a[13] * s2 + a[15] * s0) * inv_det;
+			o[11] = (-a[8] * s4 + a[9] * s2 - a[11] * s0) * inv_det;
+			o[12] = (-a[4] * c3 + a[5] * c1 - a[6] * c0) * inv_det;
+			o[13] = ( a[0] * c3 - a[1] * c1 + a[2] * c0) * inv_det;
+			o[14] = (-a[12] * s3 + a[13] * s1 - a[14] * s0) * inv_det;
+			o[15] = ( a[8] * s3 - a[9] * s1 + a[10] * s0) * inv_det;
+		#endif
+			return r;
+		}
+
+		void transform_points(const Matrix4x4 &m, const Vector3 *in, Vector3 *out, uint32_t n)
+		{
+			transform_many(m, in, out, n, true);
+		}
+
+		void transform_vectors(const Matrix4x4 &m, const Vector3 *in, Vector3 *out, uint32_t n)
+		{
+			transform_many(m, in, out, n, false);
+		}
+	}
+}
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "math_types.h"
+#include "simd.h"
+
+#include <math.h>
+
+namespace foundation
+{
+	/// Vector, quaternion and matrix operations on the types in math_types.h.
+	///
+	/// Vectors are row vectors, so points are transformed as p * m, with m.t
+	/// as the translation, and multiply(a, b) is the transform that first
+	/// applies a and then b.
+	///
+	/// Operations on Matrix4x4, Vector4 and Quaternion use SSE, with all four
+	/// components of a row in one register. Vector3 operations are plain
+	/// scalar code, since loading and storing the three floats of a Vector3
+	/// costs more than SSE saves. Use the functions that work on arrays of
+	/// points, such as matrix4x4::transform_points(), for vectorized Vector3
+	/// code.
+
+	inline Vector3 operator+(const Vector3 &a, const Vector3 &b) {Vector3 r = {a.x + b.x, a.y + b.y, a.z + b.z}; return r;}
+	inline Vector3 operator-(const Vector3 &a, const Vector3 &b) {Vector3 r = {a.x - b.x, a.y - b.y, a.z - b.z}; return r;}
+	inline Vector3 operator-(const Vector3 &a) {Vector3 r = {-a.x, -a.y, -a.z}; return r;}
+	inline Vector3 operator*(const Vector3 &a, float s) {Vector3 r = {a.x * s, a.y * s, a.z * s}; return r;}
+	inline Vector3 operator*(float s, const Vector3 &a) {return a * s;}
+
+	namespace vector3
+	{
+		float dot(const Vector3 &a, const Vector3 &b);
+		Vector3 cross(const Vector3 &a, const Vector3 &b);
+		float length(const Vector3 &a);
+		float length_squared(const Vector3 &a);
+
+		/// Returns a in unit length. a must not be zero.
+		Vector3 normalize(const Vector3 &a);
+	}
+
+	namespace vector4
+	{
+		float dot(const Vector4 &a, const Vector4 &b);
+		float length(const Vector4 &a);
+
+		/// Returns a in unit length. a must not be zero.
+		Vector4 normalize(const Vector4 &a);
+	}
+
+	namespace quaternion
+	{
+		Quaternion identity();
+
+		/// Returns the rotation around the unit axis by the angle in radians.
+		Quaternion from_axis_angle(const Vector3 &axis, float angle);
+
+		/// Returns the rotation that first applies b and then a (the Hamilton
+		/// product a * b).
+		Quaternion multiply(const Quaternion &a, const Quaternion &b);
+
+		Quaternion conjugate(const Quaternion &q);
+		Quaternion normalize(const Quaternion &q);
+
+		/// Rotates the vector with the unit quaternion.
+		Vector3 rotate(const Quaternion &q, const Vector3 &v);
+
+		/// Spherical linear interpolation between the unit quaternions a and b,
+		/// along the shortest path. Falls back to normalized linear
+		/// interpolation when a and b are almost the same.
+		Quaternion slerp(const Quaternion &a, const Quaternion &b, float t);
+	}
+
+	namespace matrix4x4
+	{
+		Matrix4x4 identity();
+
+		/// Returns the transform that first applies a and then b (the matrix
+		/// product a * b).
+		Matrix4x4 multiply(const Matrix4x4 &a, const Matrix4x4 &b);
+
+		/// Computes out[i] = multiply(a[i], b[i]) for n matrices, using AVX
+		/// (chosen at run time) when available. out may be the same as a or b.
+		void multiply(const Matrix4x4 *a, const Matrix4x4 *b, Matrix4x4 *out, uint32_t n);
+
+		/// Returns the inverse of the matrix. The matrix must be invertible.
+		Matrix4x4 inverse(const Matrix4x4 &m);
+
+		/// Transforms a point, including the translation (p * m with p.w = 1).
+		Vector3 transform_point(const Matrix4x4 &m, const Vector3 &p);
+
+		/// Transforms a direction, without the translation (v * m with v.w = 0).
+		Vector3 transform_vector(const Matrix4x4 &m, const Vector3 &v);
+
+		/// Transforms n points or vectors at once. Four points are transposed
+		/// into SSE registers at a time, so they are transformed without
+		/// reloading the matrix rows. out may be the same as in.
+		void transform_points(const Matrix4x4 &m, const Vector3 *in, Vector3 *out, uint32_t n);
+		void transform_vectors(const Matrix4x4 &m, const Vector3 *in, Vector3 *out, uint32_t n);
+	}
+
+#if defined(FOUNDATION_SSE2)
+	namespace vector_math_internal
+	{
+		inline __m128 load(const Vector4 &v) {return _mm_loadu_ps(&v.x);}
+		inline __m128 load(const Quaternion &q) {return _mm_loadu_ps(&q.x);}
+		inline void store(Vector4 &v, __m128 r) {_mm_storeu_ps(&v.x, r);}
+		inline void store(Quaternion &q, __m128 r) {_mm_storeu_ps(&q.x, r);}
+
+		inline Vector3 to_vector3(__m128 r)
+		{
+			float f[4];
+			_mm_storeu_ps(f, r);
+			Vector3 v = {f[0], f[1], f[2]};
+			return v;
+		}
+
+		/// Returns the dot product of a and b in all four components.
+		inline __m128 dot4(__m128 a, __m128 b)
+		{
+			__m128 r = _mm_mul_ps(a, b);
+			r = _mm_add_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_add_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)));
+		}
+
+		/// Returns the row vector v * m.
+		inline __m128 transform(__m128 v, const Matrix4x4 &m)
+		{
+			__m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), load(m.x));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), load(m.y)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), load(m.z)));
+			return _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), load(m.t)));
+		}
+	}
+#endif
+
+	namespace vector3
+	{
+		inline float dot(const Vector3 &a, const Vector3 &b)
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		inline Vector3 cross(const Vector3 &a, const Vector3 &b)
+		{
+			Vector3 r = {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+			return r;
+		}
+
+		inline float length_squared(const Vector3 &a) {return dot(a, a);}
+		inline float length(const Vector3 &a) {return sqrtf(dot(a, a));}
+		inline Vector3 normalize(const Vector3 &a) {return a * (1.0f / length(a));}
+	}
+
+	namespace vector4
+	{
+		inline float dot(const Vector4 &a, const Vector4 &b)
+		{
+		#if defined(FOUNDATION_SSE2)
+			using namespace vector_math_internal;
+			return _mm_cvtss_f32(dot4(load(a), load(b)));
+		#else
+			return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+		#endif
+		}
+
+		inline float length(const Vector4 &a) {return sqrtf(dot(a, a));}
+
+		inline Vector4 normalize(const Vector4 &a)
+		{
+		#if defined(FOUNDATION_SSE2)
+			using namespace vector_math_internal;
+			const __m128 v = load(a);
+			Vector4 r;
+			store(r, _mm_div_ps(v, _mm_sqrt_ps(dot4(v, v))));
+			return r;
+		#else
+			const float s = 1.0f / length(a);
+			Vector4 r = {a.x * s, a.y * s, a.z * s, a.w * s};
+			return r;
+		#endif
+		}
+	}
+
+	namespace quaternion
+	{
+		inline Quaternion identity()
+		{
+			Quaternion q = {0, 0, 0, 1};
+			return q;
+		}
+
+		inline Quaternion from_axis_angle(const Vector3 &axis, float angle)
+		{
+			const float s = sinf(angle * 0.5f);
+			Quaternion q = {axis.x * s, axis.y * s, axis.z * s, cosf(angle * 0.5f)};
+			return q;
+		}
+
+		inline Quaternion multiply(const Quaternion &a, const Quaternion &b)
+		{
+			Quaternion q;
+		#if defined(FOUNDATION_SSE2)
+			// Each component of a multiplies a permutation of b with some of
+			// the signs flipped.
+			using namespace vector_math_internal;
+			const __m128 av = load(a);
+			const __m128 bv = load(b);
+			const __m128 ax = _mm_shuffle_ps(av, av, _MM_SHUFFLE(0, 0, 0, 0));
+			const __m128 ay = _mm_shuffle_ps(av, av, _MM_SHUFFLE(1, 1, 1, 1));
+			const __m128 az = _mm_shuffle_ps(av, av, _MM_SHUFFLE(2, 2, 2, 2));
+			const __m128 aw = _mm_shuffle_ps(av, av, _MM_SHUFFLE(3, 3, 3, 3));
+			const __m128 sign_x = _mm_castsi128_ps(_mm_setr_epi32(0, (int)0x80000000, 0, (int)0x80000000));
+			const __m128 sign_y = _mm_castsi128_ps(_mm_setr_epi32(0, 0, (int)0x80000000, (int)0x80000000));
+			const __m128 sign_z = _mm_castsi128_ps(_mm_setr_epi32((int)0x80000000, 0, 0, (int)0x80000000));
+			__m128 r = _mm_mul_ps(aw, bv);
+			r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(ax, _mm_shuffle_ps(bv, bv, _MM_SHUFFLE(0, 1, 2, 3))), sign_x));
+			r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(ay, _mm_shuffle_ps(bv, bv, _MM_SHUFFLE(1, 0, 3, 2))), sign_y));
+			r = _mm_add_ps(r, _mm_xor_ps(_mm_mul_ps(az, _mm_shuffle_ps(bv, bv, _MM_SHUFFLE(2, 3, 0, 1))), sign_z));
+			store(q, r);
+		#else
+			q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+			q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+			q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+			q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+		#endif
+			return q;
+		}
+
+		inline Quaternion conjugate(const Quaternion &q)
+		{
+			Quaternion r = {-q.x, -q.y, -q.z, q.w};
+			return r;
+		}
+
+		inline Quaternion normalize(const Quaternion &q)
+		{
+			Quaternion r;
+		#if defined(FOUNDATION_SSE2)
+			using namespace vector_math_internal;
+			const __m128 v = load(q);
+			store(r, _mm_div_ps(v, _mm_sqrt_ps(dot4(v, v))));
+		#else
+			const float s = 1.0f / sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+			r.x = q.x * s;
+			r.y = q.y * s;
+			r.z = q.z * s;
+			r.w = q.w * s;
+		#endif
+			return r;
+		}
+
+		inline Vector3 rotate(const Quaternion &q, const Vector3 &v)
+		{
+			// v + 2w (u x v) + 2 u x (u x v), with u the vector part of q.
+			const Vector3 u = {q.x, q.y, q.z};
+			const Vector3 t = vector3::cross(u, v) * 2.0f;
+			return v + t * q.w + vector3::cross(u, t);
+		}
+	}
+
+	namespace matrix4x4
+	{
+		inline Matrix4x4 identity()
+		{
+			Matrix4x4 m = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}};
+			return m;
+		}
+
+		inline Matrix4x4 multiply(const Matrix4x4 &a, const Matrix4x4 &b)
+		{
+			Matrix4x4 m;
+		#if defined(FOUNDATION_SSE2)
+			using namespace vector_math_internal;
+			store(m.x, transform(load(a.x), b));
+			store(m.y, transform(load(a.y), b));
+			store(m.z, transform(load(a.z), b));
+			store(m.t, transform(load(a.t), b));
+		#else
+			const Vector4 *ar = &a.x;
+			const Vector4 *br = &b.x;
+			Vector4 *mr = &m.x;
+			for (uint32_t i=0; i<4; ++i) {
+				mr[i].x = ar[i].x * br[0].x + ar[i].y * br[1].x + ar[i].z * br[2].x + ar[i].w * br[3].x;
+				mr[i].y = ar[i].x * br[0].y + ar[i].y * br[1].y + ar[i].z * br[2].y + ar[i].w * br[3].y;
+				mr[i].z = ar[i].x * br[0].z + ar[i].y * br[1].z + ar[i].z * br[2].z + ar[i].w * br[3].z;
+				mr[i].w = ar[i].x * br[0].w + ar[i].y * br[1].w + ar[i].z * br[2].w + ar[i].w * br[3].w;
+			}
+		#endif
+			return m;
+		}
+
+		inline Vector3 transform_point(const Matrix4x4 &m, const Vector3 &p)
+		{
+		#if defined(FOUNDATION_SSE2)
+			using namespace vector_math_internal;
+			__m128 r = _mm_mul_ps(_mm_set1_ps(p.x), load(m.x));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(p.y), load(m.y)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(p.z), load(m.z)));
+			return to_vector3(_mm_add_ps(r, load(m.t)));
+		#else
+			Vector3 r = {
+				p.x * m.x.x + p.y * m.y.x + p.z * m.z.x + m.t.x,
+				p.x * m.x.y + p.y * m.y.y + p.z * m.z.y + m.t.y,
+				p.x * m.x.z + p.y * m.y.z + p.z * m.z.z + m.t.z
+			};
+			return r;
+		#endif
+		}
+
+		inline Vector3 transform_vector(const Matrix4x4 &m, const Vector3 &v)
+		{
+		#if defined(FOUNDATION_SSE2)
+			using namespace vector_math_internal;
+			__m128 r = _mm_mul_ps(_mm_set1_ps(v.x), load(m.x));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.y), load(m.y)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.z), load(m.z)));
+			return to_vector3(r);
+		#else
+			Vector3 r = {
+				v.x * m.x.x + v.y * m.y.x + v.z * m.z.x,
+				v.x * m.x.y + v.y * m.y.y + v.z * m.z.y,
+				v.x * m.x.z + v.y * m.y.z + v.z * m.z.z
+			};
+			return r;
+		#endif
+		}
+	}
+}